@@ -58,8 +58,7 @@ public:
 
 	uint8_t* blocking_receive() {
 		assert(m_bRcvAlive);
-		while(m_qRcvedBlocks->empty())
-			m_eRcved->Wait();
+		m_qRcvedBlocks->wait(m_eRcved);
 		uint8_t* ret_block = m_qRcvedBlocks->front();
 		m_qRcvedBlocks->pop();
 
@@ -105,7 +104,7 @@ private:
 	CEvent* m_eRcved;
 	CEvent* m_eFin;
 	uint16_t m_bChannelID;
-	queue<uint8_t*>* m_qRcvedBlocks;
+	rcv_queue* m_qRcvedBlocks;
 	bool m_bSndAlive;
 	bool m_bRcvAlive;
 };
@@ -13,9 +13,96 @@
 #include "socket.h"
 #include "thread.h"
 
+#include <atomic>
+
+//Received blocks pr. segment of a rcv_queue
+#define RCV_SEGMENT_SIZE 32
+
+//Unbounded single-producer/single-consumer queue of received blocks. The receive thread pushes and the channel owning the listener pops, neither takes a lock. Blocks are stored in linked segments, so only one allocation is made pr. RCV_SEGMENT_SIZE blocks. It is deliberately not bounded: a single receive thread serves all channels, and with the Multiplexer it is the receive thread of the whole link, so blocking it on one full queue would stall every other channel, including the one the consumer may be waiting on.
+class rcv_queue {
+public:
+	rcv_queue() {
+		head = tail = new segment;
+		head->next.store(NULL, std::memory_order_relaxed);
+		head_idx = tail_idx = 0;
+		pushed.store(0, std::memory_order_relaxed);
+		popped = 0;
+		waiting.store(false, std::memory_order_relaxed);
+	}
+
+	~rcv_queue() {
+		while(head != NULL) {
+			segment* next = head->next.load(std::memory_order_relaxed);
+			delete head;
+			head = next;
+		}
+	}
+
+	//Producer side. Returns true if the consumer is waiting and needs to be woken up
+	bool push(uint8_t* buf) {
+		tail->bufs[tail_idx] = buf;
+		if(++tail_idx == RCV_SEGMENT_SIZE) {
+			segment* seg = new segment;
+			seg->next.store(NULL, std::memory_order_relaxed);
+			tail->next.store(seg, std::memory_order_release);
+			tail = seg;
+			tail_idx = 0;
+		}
+		pushed.fetch_add(1, std::memory_order_release);
+
+		//Pairs with the fence in wait, so either the consumer sees the block or we see that it waits
+		std::atomic_thread_fence(std::memory_order_seq_cst);
+		return waiting.load(std::memory_order_relaxed);
+	}
+
+	//Consumer side
+	bool empty() {
+		return popped == pushed.load(std::memory_order_acquire);
+	}
+
+	uint8_t* front() {
+		return head->bufs[head_idx];
+	}
+
+	void pop() {
+		if(++head_idx == RCV_SEGMENT_SIZE) {
+			segment* next = head->next.load(std::memory_order_acquire);
+			delete head;
+			head = next;
+			head_idx = 0;
+		}
+		popped++;
+	}
+
+	//Blocks on rcv_event until the queue is non-empty. The producer only sets the event when the consumer is waiting
+	void wait(CEvent* rcv_event) {
+		while(empty()) {
+			waiting.store(true, std::memory_order_relaxed);
+			std::atomic_thread_fence(std::memory_order_seq_cst);
+			if(empty())
+				rcv_event->Wait();
+			waiting.store(false, std::memory_order_relaxed);
+		}
+	}
+
+private:
+	struct segment {
+		uint8_t* bufs[RCV_SEGMENT_SIZE];
+		std::atomic<segment*> next;
+	};
+
+	segment* head; //Only touched by the consumer
+	uint32_t head_idx;
+	uint64_t popped;
+	segment* tail; //Only touched by the producer
+	uint32_t tail_idx;
+	std::atomic<uint64_t> pushed;
+	std::atomic<bool> waiting;
+};
+
 //A receive task listens to a particular id and writes incoming data on that id into rcv_buf and triggers event
 struct rcv_task {
-	std::queue<uint8_t*> *rcv_buf;
+	rcv_queue *rcv_buf;
 	CEvent* rcv_event;
 	CEvent* fin_event;
 	BOOL inuse;
@@ -30,13 +117,18 @@ public:
 		rcvlock = new CLock();
 		listeners = (rcv_task*) calloc(MAX_NUM_COMM_CHANNELS, sizeof(rcv_task));
 		for(uint32_t i = 0; i < MAX_NUM_COMM_CHANNELS; i++) {
-			listeners[i].rcv_buf = new queue<uint8_t*>;
+			listeners[i].rcv_buf = new rcv_queue;
 		}
 		listeners[ADMIN_CHANNEL].inuse = true;
 	}
 	;
 	~RcvThread() {
 		this->Kill();
+		//Blocks nobody read are still owned by the queues
+		for(uint32_t i = 0; i < MAX_NUM_COMM_CHANNELS; i++) {
+			flush_queue(i);
+			delete listeners[i].rcv_buf;
+		}
 		delete rcvlock;
 		free(listeners);
 	}
@@ -65,7 +157,7 @@ public:
 		rcvlock->Unlock();
 
 	}
-	queue<uint8_t*>* add_listener(uint16_t channelid, CEvent* rcv_event, CEvent* fin_event) {
+	rcv_queue* add_listener(uint16_t channelid, CEvent* rcv_event, CEvent* fin_event) {
 		rcvlock->Lock();
 #ifdef DEBUG_RECEIVE_THREAD
 		cout << "Registering listener on channel " << (uint32_t) channelid << endl;
@@ -95,6 +187,26 @@ public:
 	}
 
 
+	//Hands a received message to the listener of channelid, which takes ownership of buf. Can also be called by a transport that receives on behalf of this thread, in which case the thread is never started. Returns FALSE when the other side has shut down.
+	BOOL deliver(uint16_t channelid, uint8_t* buf, uint64_t rcvbytelen) {
+		if(channelid == ADMIN_CHANNEL) {
+			//TODO: Right now finish, can be used for other maintenance tasks
+			free(buf);
+#ifdef DEBUG_RECEIVE_THREAD
+			cout << "Receiver thread is being killed" << endl;
+#endif
+			return FALSE;
+		}
+
+		if(rcvbytelen == 0) {
+			remove_listener(channelid);
+		} else {
+			if(listeners[channelid].rcv_buf->push(buf) && listeners[channelid].inuse)
+				listeners[channelid].rcv_event->Set();
+		}
+		return TRUE;
+	}
+
 	void ThreadMain() {
 		uint16_t channelid;
 		uint64_t rcvbytelen;
@@ -112,29 +224,15 @@ public:
 						" bytes length (" << rcv_len << ")" << endl;
 #endif
 
-				if(channelid == ADMIN_CHANNEL) {
+				tmprcvbuf = NULL;
+				if(rcvbytelen > 0) {
 					tmprcvbuf = (uint8_t*) malloc(rcvbytelen);
 					mysock->Receive(tmprcvbuf, rcvbytelen);
-
-					//TODO: Right now finish, can be used for other maintenance tasks
-					free(tmprcvbuf);
-					//cout << "Got message on Admin channel, shutting down" << endl;
-#ifdef DEBUG_RECEIVE_THREAD
-					cout << "Receiver thread is being killed" << endl;
-#endif
-					m_bRunning = false;
-					return;//continue;
 				}
 
-				if(rcvbytelen == 0) {
-					remove_listener(channelid);
-				} else {
-					tmprcvbuf = (uint8_t*) malloc(rcvbytelen);
-					mysock->Receive(tmprcvbuf, rcvbytelen);
-
-					listeners[channelid].rcv_buf->push(tmprcvbuf);
-					if(listeners[channelid].inuse)
-						listeners[channelid].rcv_event->Set();
+				if(!deliver(channelid, tmprcvbuf, rcvbytelen)) {
+					m_bRunning = false;
+					return;
 				}
 			}
 
@@ -13,6 +13,8 @@
 #include "socket.h"
 #include "thread.h"
 
+#include <queue>
+
 struct snd_task {
 	uint16_t channelid;
 	uint64_t bytelen;
@@ -28,44 +30,33 @@ public:
 		send = new CEvent();
 	}
 	;
-	~SndThread() {
+	virtual ~SndThread() {
 		kill_task();
+		//ThreadMain returns after writing out the kill task, so whatever is still queued afterwards, or everything if the thread was never started, is freed here
+		Wait();
+		while(!send_tasks.empty()) {
+			free(send_tasks.front()->snd_buf);
+			free(send_tasks.front());
+			send_tasks.pop();
+		}
 		delete sndlock;
 		delete send;
 	}
 	;
 
 	void add_snd_task_start_len(uint16_t channelid, uint64_t sndbytes, uint8_t* sndbuf, uint64_t startid, uint64_t len) {
-		snd_task* task = (snd_task*) malloc(sizeof(snd_task));
+		uint64_t prefix[2] = {startid, len};
 		assert(channelid != ADMIN_CHANNEL);
-		task->channelid = channelid;
-		task->bytelen = sndbytes + 2 * sizeof(uint64_t);
-		task->snd_buf = (uint8_t*) malloc(task->bytelen);
-		memcpy(task->snd_buf, &startid, sizeof(uint64_t));
-		memcpy(task->snd_buf+sizeof(uint64_t), &len, sizeof(uint64_t));
-		memcpy(task->snd_buf+2*sizeof(uint64_t), sndbuf, sndbytes);
 
-		//cout << "Adding a new task that is supposed to send " << task->bytelen << " bytes on channel " << (uint32_t) channelid  << endl;
+		//cout << "Adding a new task that is supposed to send " << sndbytes + sizeof(prefix) << " bytes on channel " << (uint32_t) channelid  << endl;
 
-		sndlock->Lock();
-		send_tasks.push(task);
-		sndlock->Unlock();
-		send->Set();
+		push_task(channelid, (uint8_t*) prefix, sizeof(prefix), sndbuf, sndbytes);
 	}
 
 
 	void add_snd_task(uint16_t channelid, uint64_t sndbytes, uint8_t* sndbuf) {
-		snd_task* task = (snd_task*) malloc(sizeof(snd_task));
 		assert(channelid != ADMIN_CHANNEL);
-		task->channelid = channelid;
-		task->bytelen = sndbytes;
-		task->snd_buf = (uint8_t*) malloc(sndbytes);
-		memcpy(task->snd_buf, sndbuf, task->bytelen);
-
-		sndlock->Lock();
-		send_tasks.push(task);
-		sndlock->Unlock();
-		send->Set();
+		push_task(channelid, NULL, 0, sndbuf, sndbytes);
 		//cout << "Event set" << endl;
 
 	}
@@ -77,37 +68,51 @@ public:
 	}
 
 	void kill_task() {
+		uint8_t dummy_val = 0;
+		push_task(ADMIN_CHANNEL, NULL, 0, &dummy_val, 1);
+#ifdef DEBUG_SEND_THREAD
+		cout << "Killing channel " << (uint32_t) ADMIN_CHANNEL << endl;
+#endif
+	}
+
+	//Queues prefix followed by sndbuf for the send thread. Subclasses that transmit tasks directly override this and never start the thread
+	virtual void push_task(uint16_t channelid, uint8_t* prefix, uint64_t prefixlen, uint8_t* sndbuf, uint64_t sndbytes) {
 		snd_task* task = (snd_task*) malloc(sizeof(snd_task));
-		task->channelid = ADMIN_CHANNEL;
-		task->bytelen = 1;
-		task->snd_buf = (uint8_t*) malloc(1);
+		task->channelid = channelid;
+		task->bytelen = prefixlen + sndbytes;
+		task->snd_buf = (uint8_t*) malloc(task->bytelen);
+		if(prefixlen > 0)
+			memcpy(task->snd_buf, prefix, prefixlen);
+		memcpy(task->snd_buf + prefixlen, sndbuf, sndbytes);
 
 		sndlock->Lock();
 		send_tasks.push(task);
 		sndlock->Unlock();
 		send->Set();
-#ifdef DEBUG_SEND_THREAD
-		cout << "Killing channel " << (uint32_t) task->channelid << endl;
-#endif
 	}
 
 	void ThreadMain() {
 		uint16_t channelid;
-		uint32_t iters;
 		snd_task* task;
 		while(true) {
 			//cout << "Starting to send" << endl;
-			if(send_tasks.empty())
-				send->Wait();
-			//cout << "Awoken" << endl;
-
 			sndlock->Lock();
-			iters = send_tasks.size();
+			bool empty = send_tasks.empty();
 			sndlock->Unlock();
+			if(empty)
+				send->Wait();
+			//cout << "Awoken" << endl;
 
-			while(iters--) {
+			while(true) {
+				sndlock->Lock();
+				if(send_tasks.empty()) {
+					sndlock->Unlock();
+					break;
+				}
 				task = send_tasks.front();
 				send_tasks.pop();
+				sndlock->Unlock();
+
 				channelid = task->channelid;
 				mysock->Send(&channelid, sizeof(uint16_t));
 				mysock->Send(&task->bytelen, sizeof(uint64_t));
@@ -123,7 +128,7 @@ public:
 				free(task);
 
 				if(channelid == ADMIN_CHANNEL)
-					continue;
+					return;
 			}
 		}
 	}
@@ -18,29 +18,23 @@ bool CommitReceiver::Commit() {
 void CommitReceiver::ExpandAndTranspose() {
 
   //We first initialize num_blocks + 1 blocks to hold the share values. The +1 is due to our matrix transposition not being in-place, so we need a "scratch-pad" block. It is initially the 0 block that is used for this.
+  //See CommitSender::ExpandAndTranspose for the padding rows
   for (int j = 0; j < num_blocks + 1; ++j) {
-    matrices.emplace_back(std::make_unique<uint8_t[]>(transpose_matrix_size));
+    matrices.emplace_back(MakeLarge<uint8_t>(transpose_matrix_size));
+    std::fill(matrices[j].get() + CODEWORD_BITS * col_dim_bytes, matrices[j].get() + transpose_matrix_size, 0);
   }
 
-  //Increment counter appropriately based on exec_id and expand seeds using PRNG
-  PRNG rnd;
+  //Each exec uses the row seeds incremented by its offset. Any (row, block) of these streams can be generated directly, so we expand block by block and transpose each block while it is still in cache.
   int increase_counter_pr_block = CEIL_DIVIDE(col_dim_bytes, AES_BYTES * PIPELINES);
-  for (int i = 0; i < CODEWORD_BITS; ++i) {
-    //First we increment the seeds to the current block.
-    uint128_t seeds0 = uint8_tTOuint128_t(seeds + i * CSEC_BYTES);
-    seeds0 += increase_counter_pr_block * num_blocks * params.exec_id;
-
-    // Set seed
-    rnd.SetSeed((uint8_t*) &seeds0);
-
-    //Fill up the i'th row of all blocks. Notice the 0'th block is not filled up.
-    for (int j = 0; j < num_blocks; ++j) {
-      rnd.GenRnd(matrices[j + 1].get() + i * col_dim_bytes, col_dim_bytes);
-    }
-  }
+  uint128_t seed_offset = (uint128_t) increase_counter_pr_block * num_blocks * params.exec_id;
+  SeekablePRNG rnd(seeds, CODEWORD_BITS, seed_offset);
+  uint64_t row_blocks = col_dim_bytes / AES_BYTES;
 
-  // Transpose the j+1 block and store in the j'th block. Results in block 0,...,num_blocks-1 contain the transposed matrices. Then point expanded data into the share arrays for easy access
+  //Fill up the j+1 block, transpose it and store in the j'th block. Results in block 0,...,num_blocks-1 contain the transposed matrices. Then point expanded data into the share arrays for easy access
   for (int j = 0; j < num_blocks; ++j) {
+    for (int i = 0; i < CODEWORD_BITS; ++i) {
+      rnd.GenRndBlocks(matrices[j + 1].get() + i * col_dim_bytes, i, j * row_blocks, row_blocks);
+    }
     transpose_320_128(matrices[j + 1].get(), matrices[j].get(), col_blocks);
     for (int i = 0; i < col_dim; ++i) {
       if (j * col_dim + i < num_commits_produced) { //last block might not be filled up
@@ -12,35 +12,27 @@ void CommitSender::Commit() {
 void CommitSender::ExpandAndTranspose() {
 
   //We first initialize num_blocks + 1 blocks to hold the share values. The +1 is due to our matrix transposition not being in-place, so we need a "scratch-pad" block. It is initially the 0 block that is used for this.
+  //Only the first CODEWORD_BITS rows of a block are expanded below, so the padding rows up to row_dim are zeroed here and the rest is left uninitialized
   for (int j = 0; j < num_blocks + 1; ++j) {
-    matrices0.emplace_back(std::make_unique<uint8_t[]>(transpose_matrix_size));
-    matrices1.emplace_back(std::make_unique<uint8_t[]>(transpose_matrix_size));
+    matrices0.emplace_back(MakeLarge<uint8_t>(transpose_matrix_size));
+    matrices1.emplace_back(MakeLarge<uint8_t>(transpose_matrix_size));
+    std::fill(matrices0[j].get() + CODEWORD_BITS * col_dim_bytes, matrices0[j].get() + transpose_matrix_size, 0);
+    std::fill(matrices1[j].get() + CODEWORD_BITS * col_dim_bytes, matrices1[j].get() + transpose_matrix_size, 0);
   }
 
-  //Increment counter appropriately based on exec_id and expand seeds using PRNGs
-  PRNG rnd0;
-  PRNG rnd1;
+  //Each exec uses the row seeds incremented by its offset. Any (row, block) of these streams can be generated directly, so we expand block by block and transpose each block while it is still in cache.
   int increase_counter_pr_block = CEIL_DIVIDE(col_dim_bytes, AES_BYTES * PIPELINES);
-  for (int i = 0; i < CODEWORD_BITS; ++i) {
-    //First we increment the seeds to the current block.
-    uint128_t seed0 = uint8_tTOuint128_t(seeds0 + i * CSEC_BYTES);
-    uint128_t seed1 = uint8_tTOuint128_t(seeds1 + i * CSEC_BYTES);
-    seed0 += increase_counter_pr_block * num_blocks * params.exec_id;
-    seed1 += increase_counter_pr_block * num_blocks * params.exec_id;
-
-    // Set seed
-    rnd0.SetSeed((uint8_t*)&seed0);
-    rnd1.SetSeed((uint8_t*)&seed1);
-
-    //Fill up the i'th row of all blocks. Notice the 0'th block is not filled up.
-    for (int j = 0; j < num_blocks; ++j) {
-      rnd0.GenRnd(matrices0[j + 1].get() + i * col_dim_bytes, col_dim_bytes);
-      rnd1.GenRnd(matrices1[j + 1].get() + i * col_dim_bytes, col_dim_bytes);
-    }
-  }
+  uint128_t seed_offset = (uint128_t) increase_counter_pr_block * num_blocks * params.exec_id;
+  SeekablePRNG rnd0(seeds0, CODEWORD_BITS, seed_offset);
+  SeekablePRNG rnd1(seeds1, CODEWORD_BITS, seed_offset);
+  uint64_t row_blocks = col_dim_bytes / AES_BYTES;
 
-  // Transpose the j+1 block and store in the j'th block. Results in block 0,...,num_blocks-1 contain the transposed matrices. Then point expanded data into the shares arrays for easy access
+  //Fill up the j+1 block, transpose it and store in the j'th block. Results in block 0,...,num_blocks-1 contain the transposed matrices. Then point expanded data into the shares arrays for easy access
   for (int j = 0; j < num_blocks; ++j) {
+    for (int i = 0; i < CODEWORD_BITS; ++i) {
+      rnd0.GenRndBlocks(matrices0[j + 1].get() + i * col_dim_bytes, i, j * row_blocks, row_blocks);
+      rnd1.GenRndBlocks(matrices1[j + 1].get() + i * col_dim_bytes, i, j * row_blocks, row_blocks);
+    }
     transpose_320_128(matrices0[j + 1].get(), matrices0[j].get(), col_blocks);
     transpose_320_128(matrices1[j + 1].get(), matrices1[j].get(), col_blocks);
     for (int i = 0; i < col_dim; ++i) {
@@ -66,7 +58,7 @@ void CommitSender::CheckbitCorrection() {
     XOR_CheckBits(checkbit_corrections_buf.get() + j * BCH_BYTES, values_buffer + CSEC_BYTES);
   }
   //Needs to be SendBlocking, else code hangs. Cannot explain why as everywhere else Send works fine.
-  params.chan.SendBlocking(checkbit_corrections_buf.get(), num_commits_produced * BCH_BYTES);
+  params.chan.SendBlocking(std::move(checkbit_corrections_buf), num_commits_produced * BCH_BYTES);
 }
 
 void CommitSender::ConsistencyCheck() {
@@ -259,5 +251,5 @@ void CommitSender::ChosenCommit(uint8_t values[], std::vector<uint64_t> idxs, in
     XOR_128(tmp_values.get() + i * CSEC_BYTES, commit_shares1[idxs[i]]);
   }
 
-  params.chan.Send(tmp_values.get(), num_values * CSEC_BYTES);
+  params.chan.Send(std::move(tmp_values), num_values * CSEC_BYTES);
 }
\ No newline at end of file
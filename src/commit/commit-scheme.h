@@ -3,6 +3,8 @@
 
 #include "tiny/params.h"
 #include "commit/ecc.h"
+#include "prg/seekable-prng.h"
+#include "util/large-buffer.h"
 
 class CommitScheme {
 public:
@@ -4,7 +4,7 @@ ALSZDOTExtRec::ALSZDOTExtRec(Params& params) :
 ALSZDOTExt(params),
 choices_outer(std::make_unique<uint8_t[]>(BITS_TO_BYTES(params.num_OT))), 
 response_outer(std::make_unique<uint8_t[]>(params.num_OT * CSEC_BYTES)),
-receiver((crypto*)&params.crypt, net.rcvthread, net.sndthread, num_seed_OT, num_check_OT) {
+receiver((crypto*)&params.crypt, net.rcvthread.get(), net.sndthread.get(), num_seed_OT, num_check_OT) {
 }
 
 void ALSZDOTExtRec::InitOTReceiver() {
@@ -52,9 +52,11 @@ void ALSZDOTExtRec::Receive() {
 }
 
 void ALSZDOTExtRec::PrivacyAmplification(uint8_t response_inner[]) {
-  //First receive the random seed from the constructor.
-  std::unique_ptr<uint8_t[]> priv_amp_seed(std::make_unique<uint8_t[]>(CSEC_BYTES));
-  params.chan.ReceiveBlocking(priv_amp_seed.get(), CSEC_BYTES);
+  //The random seed is received from the constructor with the first batch and reused for all later ones
+  if (!priv_amp_seed) {
+    priv_amp_seed = std::make_unique<uint8_t[]>(CSEC_BYTES);
+    params.chan.ReceiveBlocking(priv_amp_seed.get(), CSEC_BYTES);
+  }
 
   int byte_length_outer = BITS_TO_BYTES(bit_length_outer);
   uint8_t priv_amp_matrix[bit_length_inner * byte_length_outer];
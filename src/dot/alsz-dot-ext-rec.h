@@ -14,6 +14,9 @@ public:
   ALSZOTExtRec receiver;
   std::unique_ptr<uint8_t[]> choices_outer;
   std::unique_ptr<uint8_t[]> response_outer;
+
+  //Received in the first Receive and reused in all later ones, see ALSZDOTExtSnd
+  std::unique_ptr<uint8_t[]> priv_amp_seed;
 };
 
 #endif /* TINY_DOT_EXT_REC_H_ */
\ No newline at end of file
@@ -5,7 +5,7 @@ ALSZDOTExtSnd::ALSZDOTExtSnd(Params& params, bool set_lsb_delta) :
   set_lsb_delta(set_lsb_delta),
   base_outer(std::make_unique<uint8_t[]>(params.num_OT * CSEC_BYTES)),
   delta_outer(std::make_unique<uint8_t[]>(CSEC_BYTES)),
-  sender(ALSZOTExtSnd((crypto*) & params.crypt, net.rcvthread, net.sndthread, num_seed_OT, num_check_OT)) {
+  sender(ALSZOTExtSnd((crypto*) & params.crypt, net.rcvthread.get(), net.sndthread.get(), num_seed_OT, num_check_OT)) {
 }
 
 void ALSZDOTExtSnd::InitOTSender() {
@@ -68,29 +68,34 @@ void ALSZDOTExtSnd::Send() {
 void ALSZDOTExtSnd::PrivacyAmplification(uint8_t base_inner[], uint8_t delta_inner[]) {
 
   int byte_length_outer = BITS_TO_BYTES(bit_length_outer);
-  uint8_t priv_amp_seed[CSEC_BYTES];
   uint8_t priv_amp_matrix[bit_length_inner * byte_length_outer];
 
-  bool done = false;
-  while (!done) {
-    params.crypt.gen_rnd(priv_amp_seed, CSEC_BYTES);
-    GeneratePrivAmpMatrix(priv_amp_seed, priv_amp_matrix, bit_length_inner * byte_length_outer);
-    for (int bit = 0; bit < bit_length_inner; ++bit) {
-      if (GetBitReversed(bit, delta_inner)) {
-        XOR_128(delta_outer.get(), priv_amp_matrix + (bit * byte_length_outer));
+  if (priv_amp_seed) {
+    //delta_inner only depends on the base OTs, so reusing the matrix gives the same delta_outer as before
+    GeneratePrivAmpMatrix(priv_amp_seed.get(), priv_amp_matrix, bit_length_inner * byte_length_outer);
+  } else {
+    priv_amp_seed = std::make_unique<uint8_t[]>(CSEC_BYTES);
+    bool done = false;
+    while (!done) {
+      params.crypt.gen_rnd(priv_amp_seed.get(), CSEC_BYTES);
+      GeneratePrivAmpMatrix(priv_amp_seed.get(), priv_amp_matrix, bit_length_inner * byte_length_outer);
+      for (int bit = 0; bit < bit_length_inner; ++bit) {
+        if (GetBitReversed(bit, delta_inner)) {
+          XOR_128(delta_outer.get(), priv_amp_matrix + (bit * byte_length_outer));
+        }
+      }
+      //If set_lsb_delta flag is set, this ensures that lsb(delta) == 1. This is needed for Half-Gate garbling.
+      if (set_lsb_delta && (GetLSB(delta_outer.get()) != 1)) {
+        //Reset delta_out as we're going to go into the loop again
+        std::fill(delta_outer.get(), delta_outer.get() + CSEC_BYTES, 0);
+      } else {
+        //We exit loop
+        done = true;
       }
     }
-    //If set_lsb_delta flag is set, this ensures that lsb(delta) == 1. This is needed for Half-Gate garbling.
-    if (set_lsb_delta && (GetLSB(delta_outer.get()) != 1)) {
-      //Reset delta_out as we're going to go into the loop again
-      std::fill(delta_outer.get(), delta_outer.get() + CSEC_BYTES, 0);
-    } else {
-      //We exit loop
-      done = true;
-    }
-  }
 
-  params.chan.Send(priv_amp_seed, CSEC_BYTES);
+    params.chan.Send(priv_amp_seed.get(), CSEC_BYTES);
+  }
 
   ALSZDOTExt::PrivacyAmplification(priv_amp_matrix, byte_length_outer, bit_length_inner, params.num_OT, base_inner, base_outer.get());
-}
\ No newline at end of file
+}
@@ -17,6 +17,9 @@ public:
   std::unique_ptr<uint8_t[]> base_outer;
   std::unique_ptr<uint8_t[]> delta_outer;
   bool set_lsb_delta;
+
+  //The privacy amplification matrix is fixed by the first Send, so all later Sends extend the same base OTs to the same global delta
+  std::unique_ptr<uint8_t[]> priv_amp_seed;
 };
 
 #endif /* TINY_DOT_EXT_SND_H_ */
\ No newline at end of file
@@ -2,7 +2,7 @@
 
 ALSZDOTExt::ALSZDOTExt(Params& params) :
   params(params),
-  net(params.ip_address.c_str(), params.port),
+  net(*params.mux, OT_EXT_CHAN + params.exec_id),
   bit_length_outer(CSEC),
   num_seed_OT(bit_length_outer + 2 * SSEC), //could be as low as SSEC, but then the number of ALSZ checks are more expensive
   bit_length_inner(num_seed_OT),
@@ -18,15 +18,6 @@ ALSZDOTExt::ALSZDOTExt(Params& params) :
   if (params.num_OT > 256 * NUMOTBLOCKS) {
     throw std::runtime_error("Abort, code cannot handle this many OTs. Recompile with larger NUMOTBLOCKS value.");
   }
-
-  if (params.net_role) { //Client
-    thread t([this]() { net.ConnectAndStart();});
-    t.detach();
-
-  } else { //Server
-    thread t([this]() { net.ListenAndStart();});
-    t.detach();
-  }
 }
 
 void ALSZDOTExt::PrivacyAmplification(uint8_t priv_amp_matrix[], int rows_bytes, int columns_bits, int num_vecs, uint8_t base_inner[], uint8_t base_outer[]) {
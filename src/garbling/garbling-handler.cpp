@@ -79,130 +79,167 @@ void GarblingHandler::AllShiftEvaluateGates(HalfGates& gates_data, int offset, u
   }
 }
 
-//HalfGate garbling
+//HalfGate garbling. Gates are processed AES_HASH_PIPELINES at a time so their four hashes each can be computed in a single batch.
 void GarblingHandler::GarbleGates(HalfGates& gates_data, int offset, uint8_t left_keys[], uint8_t right_keys[], uint8_t delta[], uint32_t ids[], uint32_t num_gates) {
   __m128i delta_128 = _mm_lddqu_si128((__m128i *) delta);
-  __m128i left_key_128, right_key_128, left_key_delta_128, right_key_delta_128, out_key_128, T_G_128, T_E_128, id_128, tmp_128;
-  for (uint32_t i = 0; i < num_gates; ++i) {
-    uint8_t left_bit = GetLSB(left_keys + (offset + i) * AES_BYTES);
-    uint8_t right_bit = GetLSB(right_keys + (offset + i) * AES_BYTES);
+  __m128i left_key_128, right_key_128, out_key_128, T_G_128, T_E_128, tmp_128;
+  __m128i hash_in[4 * AES_HASH_PIPELINES], hash_tweak[4 * AES_HASH_PIPELINES], hash_out[4 * AES_HASH_PIPELINES];
+  for (uint32_t c = 0; c < num_gates; c += AES_HASH_PIPELINES) {
+    uint32_t chunk_size = std::min((uint32_t) AES_HASH_PIPELINES, num_gates - c);
+    for (uint32_t k = 0; k < chunk_size; ++k) {
+      uint32_t i = offset + c + k;
+      left_key_128 = _mm_lddqu_si128((__m128i *) (left_keys + i * AES_BYTES));
+      right_key_128 = _mm_lddqu_si128((__m128i *) (right_keys + i * AES_BYTES));
+      hash_in[4 * k] = left_key_128;
+      hash_in[4 * k + 1] = _mm_xor_si128(left_key_128, delta_128);
+      hash_in[4 * k + 2] = right_key_128;
+      hash_in[4 * k + 3] = _mm_xor_si128(right_key_128, delta_128);
+      hash_tweak[4 * k] = (__m128i) _mm_load_ss((float*) &ids[i]);
+      hash_tweak[4 * k + 1] = hash_tweak[4 * k];
+      hash_tweak[4 * k + 2] = hash_tweak[4 * k];
+      hash_tweak[4 * k + 3] = hash_tweak[4 * k];
+    }
 
-    left_key_128 = _mm_lddqu_si128((__m128i *) (left_keys + (offset + i) * AES_BYTES));
-    right_key_128 = _mm_lddqu_si128((__m128i *) (right_keys + (offset + i) * AES_BYTES));
-    id_128 = (__m128i) _mm_load_ss((float*) &ids[offset + i]);
+    IntrinAESHash(hash_in, hash_tweak, hash_out, 4 * chunk_size, key_schedule);
 
-    left_key_delta_128 = _mm_xor_si128(left_key_128, delta_128);
-    right_key_delta_128 = _mm_xor_si128(right_key_128, delta_128);
+    for (uint32_t k = 0; k < chunk_size; ++k) {
+      uint32_t i = offset + c + k;
+      uint8_t left_bit = GetLSB(hash_in[4 * k]);
+      uint8_t right_bit = GetLSB(hash_in[4 * k + 2]);
 
-    out_key_128 = AESHash(left_key_128, id_128);
-    T_G_128 = AESHash(left_key_delta_128, id_128);
-    T_E_128 = AESHash(right_key_128, id_128);
-    tmp_128 = AESHash(right_key_delta_128, id_128);
-
-    T_G_128 = _mm_xor_si128(T_G_128, out_key_128);
-    if (right_bit) {
-      T_G_128 = _mm_xor_si128(T_G_128, delta_128);
-      out_key_128 = _mm_xor_si128(out_key_128, tmp_128);
-    } else {
-      out_key_128 = _mm_xor_si128(out_key_128, T_E_128);
-    }
+      out_key_128 = hash_out[4 * k];
+      T_G_128 = hash_out[4 * k + 1];
+      T_E_128 = hash_out[4 * k + 2];
+      tmp_128 = hash_out[4 * k + 3];
 
-    if (left_bit) {
-      out_key_128 = _mm_xor_si128(out_key_128, T_G_128);
-    }
+      T_G_128 = _mm_xor_si128(T_G_128, out_key_128);
+      if (right_bit) {
+        T_G_128 = _mm_xor_si128(T_G_128, delta_128);
+        out_key_128 = _mm_xor_si128(out_key_128, tmp_128);
+      } else {
+        out_key_128 = _mm_xor_si128(out_key_128, T_E_128);
+      }
 
-    T_E_128 = _mm_xor_si128(T_E_128, left_key_128);
-    T_E_128 = _mm_xor_si128(T_E_128, tmp_128);
+      if (left_bit) {
+        out_key_128 = _mm_xor_si128(out_key_128, T_G_128);
+      }
+
+      T_E_128 = _mm_xor_si128(T_E_128, hash_in[4 * k]);
+      T_E_128 = _mm_xor_si128(T_E_128, tmp_128);
 
-    _mm_storeu_si128((__m128i *) (gates_data.T_G + (offset + i) * AES_BYTES), T_G_128);
-    _mm_storeu_si128((__m128i *) (gates_data.T_E + (offset + i) * AES_BYTES), T_E_128);
-    _mm_storeu_si128((__m128i *) (gates_data.S_O + (offset + i) * AES_BYTES), out_key_128);
+      _mm_storeu_si128((__m128i *) (gates_data.T_G + i * AES_BYTES), T_G_128);
+      _mm_storeu_si128((__m128i *) (gates_data.T_E + i * AES_BYTES), T_E_128);
+      _mm_storeu_si128((__m128i *) (gates_data.S_O + i * AES_BYTES), out_key_128);
+    }
   }
 }
 
 //HalfGate Evaluation
 void GarblingHandler::OutputShiftEvaluateGates(HalfGates& gates_data, int offset, uint8_t left_keys[], uint8_t right_keys[], uint8_t out_keys[], uint32_t ids[], uint32_t num_gates, int neg_offset_ids) {
-  __m128i left_key_128, right_key_128, id_128, T_G_128, T_E_128, out_key_128, tmp_128, S_L_128, S_R_128, S_O_128;
-  for (uint32_t i = 0; i < num_gates; ++i) {
-    uint8_t left_bit = GetLSB(left_keys + (offset + i) * AES_BYTES);
-    uint8_t right_bit = GetLSB(right_keys + (offset + i) * AES_BYTES);
+  __m128i left_key_128, right_key_128, T_G_128, T_E_128, out_key_128, S_O_128;
+  __m128i hash_in[2 * AES_HASH_PIPELINES], hash_tweak[2 * AES_HASH_PIPELINES], hash_out[2 * AES_HASH_PIPELINES];
+  for (uint32_t c = 0; c < num_gates; c += AES_HASH_PIPELINES) {
+    uint32_t chunk_size = std::min((uint32_t) AES_HASH_PIPELINES, num_gates - c);
+    for (uint32_t k = 0; k < chunk_size; ++k) {
+      uint32_t i = offset + c + k;
+      hash_in[2 * k] = _mm_lddqu_si128((__m128i *) (left_keys + i * AES_BYTES));
+      hash_in[2 * k + 1] = _mm_lddqu_si128((__m128i *) (right_keys + i * AES_BYTES));
+      hash_tweak[2 * k] = (__m128i) _mm_load_ss((float*) &ids[i]);
+      hash_tweak[2 * k + 1] = hash_tweak[2 * k];
+    }
 
-    int current_gate_index = ids[offset + i] - neg_offset_ids - params.out_keys_start;
+    IntrinAESHash(hash_in, hash_tweak, hash_out, 2 * chunk_size, key_schedule);
 
-    S_O_128 = _mm_lddqu_si128((__m128i *) (gates_data.S_O + current_gate_index * AES_BYTES));
+    for (uint32_t k = 0; k < chunk_size; ++k) {
+      uint32_t i = offset + c + k;
+      int current_gate_index = ids[i] - neg_offset_ids - params.out_keys_start;
 
-    left_key_128 = _mm_lddqu_si128((__m128i *) (left_keys + (offset + i) * AES_BYTES));
-    right_key_128 = _mm_lddqu_si128((__m128i *) (right_keys + (offset + i) * AES_BYTES));
-    id_128 = (__m128i) _mm_load_ss((float*) &ids[offset + i]);
-    T_G_128 = _mm_lddqu_si128((__m128i *) (gates_data.T_G + current_gate_index * AES_BYTES));
-    T_E_128 = _mm_lddqu_si128((__m128i *) (gates_data.T_E + current_gate_index * AES_BYTES));
+      left_key_128 = hash_in[2 * k];
+      right_key_128 = hash_in[2 * k + 1];
+      S_O_128 = _mm_lddqu_si128((__m128i *) (gates_data.S_O + current_gate_index * AES_BYTES));
+      T_G_128 = _mm_lddqu_si128((__m128i *) (gates_data.T_G + current_gate_index * AES_BYTES));
+      T_E_128 = _mm_lddqu_si128((__m128i *) (gates_data.T_E + current_gate_index * AES_BYTES));
 
-    out_key_128 = AESHash(left_key_128, id_128);
-    tmp_128 = AESHash(right_key_128, id_128);
+      out_key_128 = hash_out[2 * k];
+      if (GetLSB(left_key_128)) {
+        out_key_128 = _mm_xor_si128(out_key_128, T_G_128);
+      }
 
-    if (left_bit) {
-      out_key_128 = _mm_xor_si128(out_key_128, T_G_128);
-    }
+      out_key_128 = _mm_xor_si128(out_key_128, hash_out[2 * k + 1]);
+      if (GetLSB(right_key_128)) {
+        out_key_128 = _mm_xor_si128(out_key_128, T_E_128);
+        out_key_128 = _mm_xor_si128(out_key_128, left_key_128);
+      }
 
-    out_key_128 = _mm_xor_si128(out_key_128, tmp_128);
-    if (right_bit) {
-      out_key_128 = _mm_xor_si128(out_key_128, T_E_128);
-      out_key_128 = _mm_xor_si128(out_key_128, left_key_128);
+      out_key_128 = _mm_xor_si128(out_key_128, S_O_128);
+      _mm_storeu_si128((__m128i *) (out_keys + i * AES_BYTES), out_key_128);
     }
-
-    out_key_128 = _mm_xor_si128(out_key_128, S_O_128);
-    _mm_storeu_si128((__m128i *) (out_keys + (offset + i) * AES_BYTES), out_key_128);
   }
 }
 
 //Wire Authenticators production
 void GarblingHandler::GarbleAuths(Auths& auths_data, int offset, uint8_t keys[], uint8_t delta[], uint32_t ids[], uint32_t num_auths) {
   __m128i delta_128 = _mm_lddqu_si128((__m128i *) delta);
-  __m128i key_128, key_delta_128, id_128;
-  for (uint32_t i = 0; i < num_auths; ++i) {
-    key_128 = _mm_lddqu_si128((__m128i *) (keys + (offset + i) * AES_BYTES));
-    id_128 = (__m128i) _mm_load_ss((float*) &ids[offset + i]);
+  __m128i key_128;
+  __m128i hash_in[2 * AES_HASH_PIPELINES], hash_tweak[2 * AES_HASH_PIPELINES], hash_out[2 * AES_HASH_PIPELINES];
+  for (uint32_t c = 0; c < num_auths; c += AES_HASH_PIPELINES) {
+    uint32_t chunk_size = std::min((uint32_t) AES_HASH_PIPELINES, num_auths - c);
+    for (uint32_t k = 0; k < chunk_size; ++k) {
+      key_128 = _mm_lddqu_si128((__m128i *) (keys + (offset + c + k) * AES_BYTES));
+      hash_in[2 * k] = key_128;
+      hash_in[2 * k + 1] = _mm_xor_si128(key_128, delta_128);
+      hash_tweak[2 * k] = (__m128i) _mm_load_ss((float*) &ids[offset + c + k]);
+      hash_tweak[2 * k + 1] = hash_tweak[2 * k];
+    }
 
-    key_delta_128 = _mm_xor_si128(key_128, delta_128);
-    key_128 = AESHash(key_128, id_128);
-    key_delta_128 = AESHash(key_delta_128, id_128);
-    _mm_storeu_si128((__m128i *) (auths_data.H_0 + (offset + i) * AES_BYTES), key_128);
-
-    _mm_storeu_si128((__m128i *) (auths_data.H_1 + (offset + i) * AES_BYTES), key_delta_128);
-    int res = memcmp(auths_data.H_0 + (offset + i) * AES_BYTES, auths_data.H_1 + (offset + i) * AES_BYTES, AES_BYTES);
-    if (res > 0) {
-      //Do nothing
-    } else if (res < 0) {
-      //Swap the order of the authenticators
-      uint8_t tmp[AES_BYTES];
-      std::copy(auths_data.H_0 + (offset + i) * AES_BYTES, auths_data.H_0 + (offset + i) * AES_BYTES + AES_BYTES, tmp);
-      std::copy(auths_data.H_1 + (offset + i) * AES_BYTES, auths_data.H_1 + (offset + i) * AES_BYTES + AES_BYTES, auths_data.H_0 + (offset + i) * AES_BYTES);
-      std::copy(tmp, tmp + AES_BYTES, auths_data.H_1 + (offset + i) * AES_BYTES);
-    } else {
-      std::cout << "Congrats, this only happens with prob. 2^-128! It must be your lucky day!" << std::endl;
+    IntrinAESHash(hash_in, hash_tweak, hash_out, 2 * chunk_size, key_schedule);
+
+    for (uint32_t k = 0; k < chunk_size; ++k) {
+      uint32_t i = c + k;
+      _mm_storeu_si128((__m128i *) (auths_data.H_0 + (offset + i) * AES_BYTES), hash_out[2 * k]);
+      _mm_storeu_si128((__m128i *) (auths_data.H_1 + (offset + i) * AES_BYTES), hash_out[2 * k + 1]);
+      int res = memcmp(auths_data.H_0 + (offset + i) * AES_BYTES, auths_data.H_1 + (offset + i) * AES_BYTES, AES_BYTES);
+      if (res > 0) {
+        //Do nothing
+      } else if (res < 0) {
+        //Swap the order of the authenticators
+        uint8_t tmp[AES_BYTES];
+        std::copy(auths_data.H_0 + (offset + i) * AES_BYTES, auths_data.H_0 + (offset + i) * AES_BYTES + AES_BYTES, tmp);
+        std::copy(auths_data.H_1 + (offset + i) * AES_BYTES, auths_data.H_1 + (offset + i) * AES_BYTES + AES_BYTES, auths_data.H_0 + (offset + i) * AES_BYTES);
+        std::copy(tmp, tmp + AES_BYTES, auths_data.H_1 + (offset + i) * AES_BYTES);
+      } else {
+        std::cout << "Congrats, this only happens with prob. 2^-128! It must be your lucky day!" << std::endl;
+      }
     }
   }
 }
 
 //Verify Wire Authenticators
 bool GarblingHandler::VerifyAuths(Auths& auths_data, int offset, uint8_t keys[], uint32_t ids[], uint32_t num_auths, int neg_offset_ids) {
-  __m128i key_128, hash_128, id_128;
-  for (uint32_t i = 0; i < num_auths; ++i) {
-    int current_auth_index = ids[offset + i] - neg_offset_ids - params.auth_start;
+  __m128i hash_128;
+  __m128i hash_in[AES_HASH_PIPELINES], hash_tweak[AES_HASH_PIPELINES], hash_out[AES_HASH_PIPELINES];
+  for (uint32_t c = 0; c < num_auths; c += AES_HASH_PIPELINES) {
+    uint32_t chunk_size = std::min((uint32_t) AES_HASH_PIPELINES, num_auths - c);
+    for (uint32_t k = 0; k < chunk_size; ++k) {
+      hash_in[k] = _mm_lddqu_si128((__m128i *) (keys + (offset + c + k) * AES_BYTES));
+      hash_tweak[k] = (__m128i) _mm_load_ss((float*) &ids[offset + c + k]);
+    }
 
-    key_128 = _mm_lddqu_si128((__m128i *) (keys + (offset + i) * AES_BYTES));
-    hash_128 = _mm_lddqu_si128((__m128i *) (auths_data.H_0 + current_auth_index * AES_BYTES));
-    id_128 = (__m128i) _mm_load_ss((float*) &ids[offset + i]);
-    key_128 = AESHash(key_128, id_128);
-    if (compare128(key_128, hash_128)) {
-      //Matched first authenticator
-    } else {
-      hash_128 = _mm_lddqu_si128((__m128i *) (auths_data.H_1 + current_auth_index * AES_BYTES));
-      if (compare128(key_128, hash_128)) {
-        //Matched second authenticator
+    IntrinAESHash(hash_in, hash_tweak, hash_out, chunk_size, key_schedule);
+
+    for (uint32_t k = 0; k < chunk_size; ++k) {
+      int current_auth_index = ids[offset + c + k] - neg_offset_ids - params.auth_start;
+      hash_128 = _mm_lddqu_si128((__m128i *) (auths_data.H_0 + current_auth_index * AES_BYTES));
+      if (compare128(hash_out[k], hash_128)) {
+        //Matched first authenticator
       } else {
-        //Matched none of the authenticators
-        return false;
+        hash_128 = _mm_lddqu_si128((__m128i *) (auths_data.H_1 + current_auth_index * AES_BYTES));
+        if (compare128(hash_out[k], hash_128)) {
+          //Matched second authenticator
+        } else {
+          //Matched none of the authenticators
+          return false;
+        }
       }
     }
   }
@@ -211,11 +248,13 @@ bool GarblingHandler::VerifyAuths(Auths& auths_data, int offset, uint8_t keys[],
 
 //Fixed-Key AES Hash
 __m128i GarblingHandler::AESHash(__m128i& value_128, __m128i& id_128) {
-  __m128i res = DOUBLE(value_128);
-  res = _mm_xor_si128(res, id_128);
-  __m128i tmp_input = res;
+  __m128i res;
+  IntrinAESHashBlocks<1>(&value_128, &id_128, &res, key_schedule);
 
-  DO_ENC_BLOCK(res, key_schedule);
+  return res;
+}
 
-  return _mm_xor_si128(res, tmp_input);
-}
\ No newline at end of file
+//Fixed-Key AES Hash of n blocks, each with its own tweak
+void GarblingHandler::AESHash(__m128i in[], __m128i tweak[], __m128i out[], uint32_t n) {
+  IntrinAESHash(in, tweak, out, n, key_schedule);
+}
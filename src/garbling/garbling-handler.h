@@ -22,26 +22,42 @@ public:
   bool VerifyAuths(Auths& auths_data, int offset, uint8_t keys[], uint32_t ids[], uint32_t num_auths, int neg_offset_ids);
 
   __m128i AESHash(__m128i& value_128, __m128i& id_128);
+  void AESHash(__m128i in[], __m128i tweak[], __m128i out[], uint32_t n);
 
   Params& params;
   __m128i key_schedule[11];
 };
 
-//Static context for added performance
-#define DO_ENC_BLOCK(m,k) \
-    do{\
-        m = _mm_xor_si128       (m, k[ 0]); \
-        m = _mm_aesenc_si128    (m, k[ 1]); \
-        m = _mm_aesenc_si128    (m, k[ 2]); \
-        m = _mm_aesenc_si128    (m, k[ 3]); \
-        m = _mm_aesenc_si128    (m, k[ 4]); \
-        m = _mm_aesenc_si128    (m, k[ 5]); \
-        m = _mm_aesenc_si128    (m, k[ 6]); \
-        m = _mm_aesenc_si128    (m, k[ 7]); \
-        m = _mm_aesenc_si128    (m, k[ 8]); \
-        m = _mm_aesenc_si128    (m, k[ 9]); \
-        m = _mm_aesenclast_si128(m, k[10]);\
-    }while(0)
+//Number of independent blocks kept in flight by the fixed-key hash
+#define AES_HASH_PIPELINES 8
+
+//Fixed-key AES hash of N blocks, out[i] = AES(2in[i] ^ tweak[i]) ^ 2in[i] ^ tweak[i]. The rounds of the N blocks are interleaved so the AES-NI pipeline is kept full. out may alias in.
+template <int N>
+static inline void IntrinAESHashBlocks(__m128i in[], __m128i tweak[], __m128i out[], __m128i key_schedule[]) {
+  __m128i pre[N], res[N];
+  for (int i = 0; i < N; ++i) {
+    pre[i] = _mm_xor_si128(DOUBLE(in[i]), tweak[i]);
+    res[i] = _mm_xor_si128(pre[i], key_schedule[0]);
+  }
+  for (int j = 1; j < 10; ++j) {
+    for (int i = 0; i < N; ++i) {
+      res[i] = _mm_aesenc_si128(res[i], key_schedule[j]);
+    }
+  }
+  for (int i = 0; i < N; ++i) {
+    out[i] = _mm_xor_si128(_mm_aesenclast_si128(res[i], key_schedule[10]), pre[i]);
+  }
+}
+
+static inline void IntrinAESHash(__m128i in[], __m128i tweak[], __m128i out[], uint32_t n, __m128i key_schedule[]) {
+  uint32_t i = 0;
+  for (; i + AES_HASH_PIPELINES <= n; i += AES_HASH_PIPELINES) {
+    IntrinAESHashBlocks<AES_HASH_PIPELINES>(in + i, tweak + i, out + i, key_schedule);
+  }
+  for (; i < n; ++i) {
+    IntrinAESHashBlocks<1>(in + i, tweak + i, out + i, key_schedule);
+  }
+}
 
 static inline __m128i aes_128_key_expansion(__m128i key, __m128i keygened) {
   keygened = _mm_shuffle_epi32(keygened, _MM_SHUFFLE(3, 3, 3, 3));
@@ -81,20 +97,12 @@ static inline void IntrinShiftEvaluateGates(HalfGates& gates_data, int offset, _
   S_L_128 = _mm_xor_si128(left_key_128, S_L_128);
   S_R_128 = _mm_xor_si128(right_key_128, S_R_128);
 
-  //////First Hash//////
-  __m128i res = _mm_xor_si128(DOUBLE(S_L_128), id_128);
-  // __m128i out_key_128 = res;
-  out_key_128 = res;
-  DO_ENC_BLOCK(res, key_schedule);
-  out_key_128 = _mm_xor_si128(out_key_128, res);
-  //////First Hash//////
-
-  //////Second Hash//////
-  res = _mm_xor_si128(DOUBLE(S_R_128), id_128);
-  out_key_128 = _mm_xor_si128(out_key_128, res);
-  DO_ENC_BLOCK(res, key_schedule);
-  out_key_128 = _mm_xor_si128(out_key_128, res);
-  //////Second Hash//////
+  //Both hashes in one interleaved call
+  __m128i hash_in[2] = {S_L_128, S_R_128};
+  __m128i hash_tweak[2] = {id_128, id_128};
+  __m128i hash_out[2];
+  IntrinAESHashBlocks<2>(hash_in, hash_tweak, hash_out, key_schedule);
+  out_key_128 = _mm_xor_si128(hash_out[0], hash_out[1]);
 
   out_key_128 = _mm_xor_si128(out_key_128, _mm_and_si128(T_G_128, invert_array[GetLSB(S_L_128)]));
   //Equals to
@@ -126,11 +134,7 @@ static inline bool IntrinVerifyAuths(Auths& auths_data, int offset, __m128i key_
 
   key_128 = _mm_xor_si128(key_128, S_A_128);
 
-  // key_128 = AESHash(key_128, id_128);
-  __m128i res = _mm_xor_si128(DOUBLE(key_128), id_128);
-  key_128 = res;
-  DO_ENC_BLOCK(res, key_schedule);
-  key_128 = _mm_xor_si128(key_128, res);
+  IntrinAESHashBlocks<1>(&key_128, &id_128, &key_128, key_schedule);
 
   if (compare128(key_128, hash_128)) {
     //Matched first authenticator
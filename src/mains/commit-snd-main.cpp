@@ -45,7 +45,7 @@ int main(int argc, const char* argv[]) {
     0, // Required?
     1, // Number of args expected.
     0, // Delimiter if expecting multiple args.
-    "IP Address of Machine running Commitsnd", // Help description.
+    "IP Address of Machine running Commitsnd. Use shm://name for shared memory on one host or wan://latency_ms,mbit,jitter_ms@address to emulate a WAN link", // Help description.
     "-ip"
   );
 
@@ -93,7 +93,7 @@ int main(int argc, const char* argv[]) {
   opt.get("-ip")->getString(ip_address);
   opt.get("-t")->getInt(print_special_format);
 
-  zmq::context_t context(NUM_IO_THREADS, 2 * (num_execs + 1));
+  zmq::context_t context(NUM_IO_THREADS);
   Params params(constant_seeds[0], commit_dummy_size, commit_dummy_input, commit_dummy_output, ip_address, (uint16_t) port, 0, context, num_execs); //Hardcoded dummy values
   ctpl::thread_pool thread_pool(params.num_cpus);
   params.num_commits = num_commits;
@@ -103,17 +103,11 @@ int main(int argc, const char* argv[]) {
 
   //Warm up network!
   uint8_t* dummy_val = new uint8_t[network_dummy_size]; //50 MB
-  uint8_t* dummy_val_rec = new uint8_t[network_dummy_size]; //50 MB
-  channel chan(OT_ADMIN_CHANNEL - 1, ot_snd.net.rcvthread, ot_snd.net.sndthread);
-  chan.send(dummy_val, network_dummy_size);
-  uint8_t* dummy_val_rec2 = chan.blocking_receive();
   params.chan.Send(dummy_val, network_dummy_size);
-  params.chan.ReceiveBlocking(dummy_val_rec2, network_dummy_size);
+  params.chan.ReceiveBlocking(dummy_val, network_dummy_size);
   params.chan.bytes_received_vec[params.chan.received_pointer] = 0;
   params.chan.bytes_sent_vec[params.chan.sent_pointer] = 0;
   delete[] dummy_val;
-  delete[] dummy_val_rec;
-  free(dummy_val_rec2);
   //Warm up network!
 
   //Base OTs
@@ -152,7 +146,7 @@ int main(int argc, const char* argv[]) {
   std::vector<std::unique_ptr<CommitSender>> commit_snds;
 
   for (int exec_id = 0; exec_id < params.num_execs; ++exec_id) {
-    thread_params_vec.emplace_back(std::make_unique<Params>(thread_seeds.get() + exec_id * CSEC_BYTES, params.num_pre_gates, params.num_pre_inputs, params.num_pre_outputs, params.ip_address, params.port, params.net_role, params.context, params.num_execs, exec_id));
+    thread_params_vec.emplace_back(std::make_unique<Params>(params, thread_seeds.get() + exec_id * CSEC_BYTES, params.num_pre_gates, params.num_pre_inputs, params.num_pre_outputs, exec_id));
     Params* thread_params = thread_params_vec[exec_id].get();
     thread_params->num_commits = params.num_commits / params.num_execs;
     thread_params->num_OT = CODEWORD_BITS;
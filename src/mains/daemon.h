@@ -0,0 +1,193 @@
+#ifndef TINY_MAINS_DAEMON_H_
+#define TINY_MAINS_DAEMON_H_
+
+#include "tiny/tiny.h"
+
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include <cerrno>
+
+#define DAEMON_QUIT -1
+#define DAEMON_BAD_REQUEST -2
+
+//Circuits that can be requested from a daemon, by name
+static const std::vector<std::pair<std::string, std::string>> daemon_circuit_files = {
+  {"aes", "test/data/AES-non-expanded.txt"},
+  {"sha-1", "test/data/sha-1.txt"},
+  {"sha-256", "test/data/sha-256.txt"},
+  {"cbc", "test/data/aescbcmac16.txt"}
+};
+
+//Serves evaluation requests from local clients on a unix socket, one client at a time. A request is a line "<circuit> <input as hex>" or "quit", and every request is answered with one line. The input bytes are laid out as in the test/data input files.
+class RequestServer {
+public:
+  RequestServer(std::string path) : path(path), client(NULL) {
+    listen_fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    struct sockaddr_un addr = {0};
+    addr.sun_family = AF_UNIX;
+    if (listen_fd < 0 || path.size() >= sizeof(addr.sun_path)) {
+      throw std::runtime_error("Could not create request socket " + path);
+    }
+    std::copy(path.begin(), path.end(), addr.sun_path);
+    unlink(path.c_str());
+    if (bind(listen_fd, (struct sockaddr*) &addr, sizeof(addr)) != 0 || listen(listen_fd, 1) != 0) {
+      throw std::runtime_error("Could not listen on request socket " + path);
+    }
+  }
+
+  ~RequestServer() {
+    if (client) {
+      fclose(client);
+    }
+    close(listen_fd);
+    unlink(path.c_str());
+  }
+
+  //Blocks until the next request line, accepting a new client whenever the current one disconnects
+  std::string Next() {
+    char* line = NULL;
+    size_t capacity = 0;
+    while (!client || getline(&line, &capacity, client) < 0) {
+      if (client) {
+        fclose(client);
+      }
+      int client_fd = accept(listen_fd, NULL, NULL);
+      client = client_fd < 0 ? NULL : fdopen(client_fd, "r");
+    }
+    std::string request(line);
+    free(line);
+    request.erase(request.find_last_not_of("\r\n") + 1);
+    return request;
+  }
+
+  //Writes with send and MSG_NOSIGNAL, as a client that already hung up must not raise SIGPIPE and kill the daemon. A failed write drops the client like a disconnect, and Next then waits for the next one
+  void Reply(std::string line) {
+    if (!client) {
+      return;
+    }
+    line += "\n";
+    size_t sent = 0;
+    while (sent < line.size()) {
+      ssize_t res = send(fileno(client), line.data() + sent, line.size() - sent, MSG_NOSIGNAL);
+      if (res < 0 && errno == EINTR) {
+        continue;
+      }
+      if (res <= 0) {
+        fclose(client);
+        client = NULL;
+        return;
+      }
+      sent += res;
+    }
+  }
+
+private:
+  std::string path;
+  int listen_fd;
+  FILE* client;
+};
+
+//Returns the index of the requested circuit and fills input with the num_inp_bits bits of the request, or DAEMON_QUIT or DAEMON_BAD_REQUEST
+static int ParseRequest(std::string request, std::vector<Circuit>& circuits, bool const_side, std::unique_ptr<uint8_t[]>& input) {
+  if (request == "quit") {
+    return DAEMON_QUIT;
+  }
+
+  size_t space = request.find(' ');
+  std::string name = request.substr(0, space);
+  std::string hex = space == std::string::npos ? "" : request.substr(space + 1);
+  for (size_t c = 0; c < daemon_circuit_files.size(); ++c) {
+    if (daemon_circuit_files[c].first != name) {
+      continue;
+    }
+
+    uint64_t num_inp_bits = const_side ? circuits[c].num_const_inp_wires : circuits[c].num_eval_inp_wires;
+    if (hex.size() != 2 * BITS_TO_BYTES(num_inp_bits) || hex.find_first_not_of("0123456789abcdefABCDEF") != std::string::npos) {
+      return DAEMON_BAD_REQUEST;
+    }
+
+    //Read input the "right" way, as the mains do for the input files
+    std::unique_ptr<uint8_t[]> bytes(std::make_unique<uint8_t[]>(BITS_TO_BYTES(num_inp_bits) + 1));
+    for (uint64_t i = 0; i < BITS_TO_BYTES(num_inp_bits); ++i) {
+      bytes[i] = std::stoi(hex.substr(2 * i, 2), NULL, 16);
+    }
+    input = std::make_unique<uint8_t[]>(BITS_TO_BYTES(num_inp_bits) + 1);
+    for (uint64_t i = 0; i < num_inp_bits; ++i) {
+      SetBit(i, GetBitReversed(i, bytes.get()), input.get());
+    }
+    return c;
+  }
+  return DAEMON_BAD_REQUEST;
+}
+
+//Both parties must evaluate the same circuit for each request. The constructor sends its circuit first and the evaluator answers with its own
+static int SyncRequest(Params& params, int circuit_id) {
+  int32_t own = circuit_id;
+  int32_t other;
+  if (params.net_role) {
+    params.chan.ReceiveBlocking((uint8_t*) &other, sizeof(int32_t));
+    params.chan.Send((uint8_t*) &own, sizeof(int32_t));
+  } else {
+    params.chan.Send((uint8_t*) &own, sizeof(int32_t));
+    params.chan.ReceiveBlocking((uint8_t*) &other, sizeof(int32_t));
+  }
+
+  if (own == DAEMON_QUIT || other == DAEMON_QUIT) {
+    return DAEMON_QUIT;
+  }
+  if (own != other) {
+    return DAEMON_BAD_REQUEST;
+  }
+  return own;
+}
+
+//Makes sure Offline finds room for circuit, preprocessing another batch when it fits neither in what is left of the active batch nor in a queued one. Both parties have the same counters, so they preprocess at the same time. In background mode Offline waits for the producer instead
+static void EnsurePool(Tiny& tiny, Circuit& circuit, bool can_preprocess) {
+  Params& params = tiny.params;
+  if (circuit.num_and_gates > params.num_pre_gates || circuit.num_inp_wires > params.num_pre_inputs || circuit.num_out_wires > params.num_pre_outputs) {
+    throw std::runtime_error("Circuit is larger than a preprocessed batch");
+  }
+
+  bool fits_active = (params.num_pre_gates - tiny.num_gates_used) >= circuit.num_and_gates && (params.num_pre_inputs - tiny.num_inputs_used) >= circuit.num_inp_wires && (params.num_pre_outputs - tiny.num_outputs_used) >= circuit.num_out_wires;
+  if (fits_active || tiny.GetNumQueuedBatches() > 0 || tiny.IsBackgroundRunning()) {
+    return;
+  }
+  if (!can_preprocess) {
+    throw std::runtime_error("The preprocessed pool is used up and can not be refilled");
+  }
+  tiny.Preprocess();
+}
+
+//Serves requests until either party is told to quit. evaluate runs the Offline and Online phases for a single circuit and returns what to reply after the latency
+static void RunDaemon(Tiny& tiny, std::string socket_path, bool can_preprocess, std::function<std::string(Circuit&, uint8_t*)> evaluate) {
+  std::vector<Circuit> circuits;
+  for (const std::pair<std::string, std::string>& circuit_file : daemon_circuit_files) {
+    circuits.emplace_back(read_text_circuit(circuit_file.second.c_str()));
+  }
+
+  RequestServer server(socket_path);
+  while (true) {
+    std::unique_ptr<uint8_t[]> input;
+    int circuit_id = ParseRequest(server.Next(), circuits, !tiny.params.net_role, input);
+    circuit_id = SyncRequest(tiny.params, circuit_id);
+    if (circuit_id == DAEMON_QUIT) {
+      server.Reply("quit");
+      return;
+    }
+    if (circuit_id == DAEMON_BAD_REQUEST) {
+      server.Reply("error");
+      continue;
+    }
+
+    auto request_begin = GET_TIME();
+    EnsurePool(tiny, circuits[circuit_id], can_preprocess);
+    std::string result = evaluate(circuits[circuit_id], input.get());
+    auto request_end = GET_TIME();
+
+    uint64_t request_time_nano = std::chrono::duration_cast<std::chrono::nanoseconds>(request_end - request_begin).count();
+    server.Reply(std::to_string((double) request_time_nano / 1000000) + " " + result);
+  }
+}
+
+#endif /* TINY_MAINS_DAEMON_H_ */
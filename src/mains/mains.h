@@ -16,6 +16,11 @@ static std::string default_optimize_online("0");
 static std::string default_ip_address("localhost");
 static std::string default_port("28001");
 static std::string default_print_format("0");
+static std::string default_pre_file("");
+static std::string default_daemon_socket("");
+static std::string default_stream("0");
+static std::string default_background("0, 0, 1, 2");
+static std::string default_tune_file("");
 
 static std::string default_num_commits("10000");
 static std::string default_num_commit_execs("1");
@@ -1,4 +1,6 @@
 #include "mains/mains.h"
+#include "mains/daemon.h"
+#include "tiny/auto-tune.h"
 #include "tiny/tiny-constructor.h"
 
 int main(int argc, const char* argv[]) {
@@ -62,7 +64,7 @@ int main(int argc, const char* argv[]) {
     0, // Required?
     1, // Number of args expected.
     0, // Delimiter if expecting multiple args.
-    "IP Address of Machine running TinyConst", // Help description.
+    "IP Address of Machine running TinyConst. Use shm://name for shared memory on one host or wan://latency_ms,mbit,jitter_ms@address to emulate a WAN link", // Help description.
     "-ip"
   );
 
@@ -75,6 +77,60 @@ int main(int argc, const char* argv[]) {
     "-p"
   );
 
+  opt.add(
+    default_pre_file.c_str(), // Default.
+    0, // Required?
+    1, // Number of args expected.
+    0, // Delimiter if expecting multiple args.
+    "Save the preprocessed state to this file", // Help description.
+    "-save"
+  );
+
+  opt.add(
+    default_pre_file.c_str(), // Default.
+    0, // Required?
+    1, // Number of args expected.
+    0, // Delimiter if expecting multiple args.
+    "Load the preprocessed state from this file instead of running Setup and Preprocess. The other party must do the same", // Help description.
+    "-load"
+  );
+
+  opt.add(
+    default_daemon_socket.c_str(), // Default.
+    0, // Required?
+    1, // Number of args expected.
+    0, // Delimiter if expecting multiple args.
+    "Keep running and serve evaluation requests from a unix socket at this path. -n and -c then only size the preprocessed pool", // Help description.
+    "-daemon"
+  );
+
+  opt.add(
+    default_stream.c_str(), // Default.
+    0, // Required?
+    1, // Number of args expected.
+    0, // Delimiter if expecting multiple args.
+    "Stream each circuit into the online phase as soon as it is soldered instead of running the phases one after the other. Both parties must agree", // Help description.
+    "-s"
+  );
+
+  opt.add(
+    default_background.c_str(), // Default.
+    0, // Required?
+    4, // Number of args expected.
+    ',', // Delimiter if expecting multiple args.
+    "Preprocess in the background instead of up front. Threads of a pool used by the background preprocessing on top of the -e threads, an absolute cap in Mbit/s on the background traffic regardless of other traffic (0 for no limit), low and high watermark in batches of the size given by -n and -c. 0 threads turns it off. The other party must use the same watermarks", // Help description.
+    "-bg"
+  );
+
+  opt.add(
+    default_tune_file.c_str(), // Default.
+    0, // Required?
+    1, // Number of args expected.
+    0, // Delimiter if expecting multiple args.
+    "Choose -e and -o automatically from probes of both hosts and the link, and record the phase times of this run in this file. A later run with the same -n and -c reuses the choice, one with other values uses the recorded times to choose better. The other party must also use -tune, but only the constructor's file is used for choosing", // Help description.
+    "-tune"
+  );
+
   //Attempt to parse input
   opt.parse(argc, argv);
 
@@ -92,9 +148,9 @@ int main(int argc, const char* argv[]) {
   }
 
   //Copy inputs into the right variables
-  int num_iters, pre_num_execs, offline_num_execs, online_num_execs, optimize_online, port;
+  int num_iters, pre_num_execs, offline_num_execs, online_num_execs, optimize_online, stream, port;
   std::vector<int> num_execs;
-  std::string circuit_name, ip_address, exec_name;
+  std::string circuit_name, ip_address, exec_name, save_file, load_file, daemon_socket, tune_file;
   Circuit circuit;
   FILE* fileptr;
   uint8_t* input_buffer;
@@ -109,8 +165,17 @@ int main(int argc, const char* argv[]) {
   online_num_execs = num_execs[2];
 
   opt.get("-o")->getInt(optimize_online);
+  opt.get("-s")->getInt(stream);
   opt.get("-ip")->getString(ip_address);
   opt.get("-p")->getInt(port);
+  opt.get("-save")->getString(save_file);
+  opt.get("-load")->getString(load_file);
+  opt.get("-daemon")->getString(daemon_socket);
+  opt.get("-tune")->getString(tune_file);
+
+  std::vector<double> background;
+  opt.get("-bg")->getDoubles(background);
+  int background_threads = background[0];
 
   //Set the circuit variables according to circuit_name
   if (circuit_name.find("aes") != std::string::npos) {
@@ -163,79 +228,141 @@ int main(int argc, const char* argv[]) {
     const_inputs.emplace_back(const_input.get());
   }
 
-  //Compute the required number of params that are to be created. We create one main param and one for each sub-thread that will be spawned later on. Need to know this at this point to setup context properly
-  int num_params = std::max(pre_num_execs, offline_num_execs);
-  num_params = std::max(num_params, online_num_execs);
-  zmq::context_t context(NUM_IO_THREADS, 2 * (num_params + 1)); //We need two sockets pr. channel
+  if (!tune_file.empty() && !load_file.empty()) {
+    std::cout << "-tune can not be used with -load, as the file needs the -e and -o of the run that saved it. Terminating" << std::endl;
+    return 1;
+  }
+
+  zmq::context_t context(NUM_IO_THREADS); //All channels share the two sockets of the multiplexer
 
   //Setup the main params object
   Params params(constant_seeds[0], num_gates, num_inputs, num_outputs, ip_address, (uint16_t) port, 0, context, pre_num_execs, GLOBAL_PARAMS_CHAN, optimize_online);
 
+  //The tuner replaces the -e and -o values before anything is sized by them
+  std::unique_ptr<AutoTuner> tuner;
+  if (!tune_file.empty()) {
+    tuner = std::make_unique<AutoTuner>(params, tune_file);
+    ExecConfig config = tuner->Agree(num_iters, !daemon_socket.empty() || background_threads > 0);
+    pre_num_execs = config.pre_num_execs;
+    offline_num_execs = config.offline_num_execs;
+    online_num_execs = config.online_num_execs;
+  }
+
+  //Compute the required number of params that are to be created. We create one main param and one for each sub-thread that will be spawned later on.
+  int num_params = std::max(pre_num_execs, offline_num_execs);
+  num_params = std::max(num_params, online_num_execs);
+
   TinyConstructor tiny_const(params);
 
   //Warm up network!
   uint8_t* dummy_val = new uint8_t[network_dummy_size]; //50 MB
-  uint8_t* dummy_val_rec = new uint8_t[network_dummy_size]; //50 MB
-  channel chan(OT_ADMIN_CHANNEL - 1, tiny_const.ot_snd.net.rcvthread, tiny_const.ot_snd.net.sndthread);
-  chan.send(dummy_val, network_dummy_size);
-  uint8_t* dummy_val_rec2 = chan.blocking_receive();
   params.chan.Send(dummy_val, network_dummy_size);
-  params.chan.ReceiveBlocking(dummy_val_rec2, network_dummy_size);
+  params.chan.ReceiveBlocking(dummy_val, network_dummy_size);
   params.chan.bytes_received_vec[params.chan.received_pointer] = 0;
   params.chan.bytes_sent_vec[params.chan.sent_pointer] = 0;
   delete[] dummy_val;
-  delete[] dummy_val_rec;
-  free(dummy_val_rec2);
   //Warm up network!
 
-  //Run initial Setup (BaseOT) phase
   auto setup_begin = GET_TIME();
-  mr_init_threading(); //Needed for Miracl library to work with threading.
-  tiny_const.Setup();
-  mr_end_threading();
-  auto setup_end = GET_TIME();
-  
-
-  //Run Preprocessing phase
-  auto preprocess_begin = GET_TIME();
-  tiny_const.Preprocess();
-  auto preprocess_end = GET_TIME();
+  auto setup_end = setup_begin;
+  auto preprocess_begin = setup_begin;
+  auto preprocess_end = setup_begin;
+  if (background_threads > 0) {
+    //Setup and Preprocess run on the background thread, so the first Offline waits for them instead
+    mr_init_threading(); //Needed for Miracl library to work with threading.
+    tiny_const.StartBackground(background_threads, background[1], background[2], background[3]);
+  } else if (load_file.empty()) {
+    //Run initial Setup (BaseOT) phase
+    mr_init_threading(); //Needed for Miracl library to work with threading.
+    tiny_const.Setup();
+    mr_end_threading();
+    setup_end = GET_TIME();
+
+    //Run Preprocessing phase
+    preprocess_begin = GET_TIME();
+    tiny_const.Preprocess();
+    preprocess_end = GET_TIME();
+
+    if (!save_file.empty()) {
+      tiny_const.SavePreprocessed(save_file);
+    }
+  } else {
+    //The preprocessing was done by an earlier run, so its time is spent mapping the file
+    preprocess_begin = GET_TIME();
+    tiny_const.LoadPreprocessed(load_file);
+    preprocess_end = GET_TIME();
+  }
 
   //Preprocessing creates pre_num_execs sub-param objects. If more are needed in the offline and online phases we create them here.
   int extra_execs = num_params - params.num_execs;
-  if (extra_execs < 0) {
-  } else {
-    std::unique_ptr<uint8_t[]> extra_thread_seeds(std::make_unique<uint8_t[]>(extra_execs * CSEC_BYTES));
-    tiny_const.params.rnd.GenRnd(extra_thread_seeds.get(), extra_execs * CSEC_BYTES);
-    for (int i = 0; i < extra_execs; ++i) {
-      tiny_const.thread_params_vec.emplace_back(std::make_unique<Params>(tiny_const.params, extra_thread_seeds.get() + i * CSEC_BYTES, tiny_const.thread_params_vec[0]->num_pre_gates, tiny_const.thread_params_vec[0]->num_pre_inputs, tiny_const.thread_params_vec[0]->num_pre_outputs, params.num_execs + i));
-      tiny_const.commit_snds.emplace_back(std::make_unique<CommitSender>(*tiny_const.thread_params_vec[params.num_execs + i], tiny_const.rot_seeds0.get(), tiny_const.rot_seeds1));
+  if (extra_execs > 0) {
+    tiny_const.AddExecs(extra_execs);
+  }
+
+  //Evaluate circuits one at a time as requests arrive, drawing from the preprocessed pool, instead of the num_iters fixed instances below
+  if (!daemon_socket.empty()) {
+    RunDaemon(tiny_const, daemon_socket, load_file.empty() && background_threads == 0, [&tiny_const](Circuit& circuit, uint8_t* input) {
+      std::vector<Circuit*> request_circuits = {&circuit};
+      std::vector<uint8_t*> request_inputs = {input};
+      tiny_const.Offline(request_circuits, 1);
+      tiny_const.Online(request_circuits, request_inputs, 1);
+      return std::string("ok");
+    });
+    //The producer's base OTs use Miracl, so threading is only ended once it has stopped
+    if (background_threads > 0) {
+      tiny_const.StopBackground();
+      mr_end_threading();
     }
+    return 0;
   }
 
-  // Figure out how many executions to run in offline phase
+  //Run Offline and Online phases. Figure out how many executions to run in each
   int top_num_execs = std::min((int)circuits.size(), offline_num_execs);
-  if (top_num_execs == 1) {
-    tiny_const.thread_pool.resize(top_num_execs);
-  }
+  int eval_num_execs = std::min((int)circuits.size(), online_num_execs);
+  auto offline_begin = GET_TIME();
+  auto offline_end = offline_begin;
+  auto online_begin = offline_begin;
+  auto online_end = offline_begin;
+  if (stream) {
+    //There is no boundary between the phases, so Offline is reported as the time until the first circuit was evaluated and Online as the time for the rest
+    eval_num_execs = top_num_execs;
+    std::mutex first_mutex;
+    bool have_first = false;
+    offline_begin = GET_TIME();
+    tiny_const.OfflineOnline(circuits, const_inputs, top_num_execs, [&](int c) {
+      std::lock_guard<std::mutex> lock(first_mutex);
+      if (!have_first) {
+        offline_end = GET_TIME();
+        have_first = true;
+      }
+    });
+    online_begin = offline_end;
+    online_end = GET_TIME();
+  } else {
+    if (top_num_execs == 1) {
+      tiny_const.thread_pool.resize(top_num_execs);
+    }
+    // tiny_const.thread_pool.resize(params.num_cpus * TP_MUL_FACTOR); //Very high performance benefit if on a high latency network as more executions can run in parallel!
 
-  // tiny_const.thread_pool.resize(params.num_cpus * TP_MUL_FACTOR); //Very high performance benefit if on a high latency network as more executions can run in parallel!
+    offline_begin = GET_TIME();
+    tiny_const.Offline(circuits, top_num_execs);
+    offline_end = GET_TIME();
 
-  //Run Offline phase
-  auto offline_begin = GET_TIME();
-  tiny_const.Offline(circuits, top_num_execs);
-  auto offline_end = GET_TIME();
+    // If we are doing single evaluation then we have slightly better performance with a single thread running in the thread pool.
+    if (eval_num_execs == 1) {
+      tiny_const.thread_pool.resize(eval_num_execs);
+    }
 
-  // If we are doing single evaluation then we have slightly better performance with a single thread running in the thread pool.
-  int eval_num_execs = std::min((int)circuits.size(), online_num_execs);
-  if (eval_num_execs == 1) {
-    tiny_const.thread_pool.resize(eval_num_execs);
+    online_begin = GET_TIME();
+    tiny_const.Online(circuits, const_inputs, eval_num_execs);
+    online_end = GET_TIME();
   }
 
-  //Run Online phase
-  auto online_begin = GET_TIME();
-  tiny_const.Online(circuits, const_inputs, eval_num_execs);
-  auto online_end = GET_TIME();
+  //The producer's base OTs use Miracl, so threading is only ended once it has stopped
+  if (background_threads > 0) {
+    tiny_const.StopBackground();
+    mr_end_threading();
+  }
 
   // Average out the timings of each phase and print results
   uint64_t setup_time_nano = std::chrono::duration_cast<std::chrono::nanoseconds>(setup_end - setup_begin).count();
@@ -243,6 +370,10 @@ int main(int argc, const char* argv[]) {
   uint64_t offline_time_nano = std::chrono::duration_cast<std::chrono::nanoseconds>(offline_end - offline_begin).count();
   uint64_t online_time_nano = std::chrono::duration_cast<std::chrono::nanoseconds>(online_end - online_begin).count();
 
+  if (tuner) {
+    tuner->Record((double) preprocess_time_nano / 1000000, (double) offline_time_nano / 1000000, (double) online_time_nano / 1000000);
+  }
+
   std::cout << "===== Const timings for " << num_iters << " x " << exec_name << "(" << (num_iters * circuit.num_and_gates) << ") with " << pre_num_execs << " preprocessing execs, " << top_num_execs << " offline execs and " << eval_num_execs << " online execs =====" << std::endl;
 
   std::cout << "Setup ms: " << (double) setup_time_nano / num_iters / 1000000 << std::endl;
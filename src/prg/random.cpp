@@ -5,6 +5,7 @@
 #include <stdio.h>
 
 #include <iostream>
+#include <stdexcept>
 using namespace std;
 
 
@@ -38,9 +39,7 @@ void PRNG::InitSeed()
         { aes_schedule(KeyScheduleC,seed); }
      else
         { aes_schedule(KeySchedule,seed); }
-     memset(state,0,RAND_SIZE*sizeof(octet));
-     for (int i = 0; i < PIPELINES; i++)
-         state[i*AES_BLK_SIZE] = i;
+     set_state(0);
   #else
      memcpy(state,seed,SEED_SIZE*sizeof(octet));
   #endif
@@ -90,6 +89,20 @@ void PRNG::hash()
 
 
 
+void PRNG::set_state(uint64_t block)
+{
+  // Stream block k is the encryption of counter k+PIPELINES, as
+  //  next() increments state before hashing
+  memset(state,0,RAND_SIZE*sizeof(octet));
+  for (int i = 0; i < PIPELINES; i++)
+    {
+      uint64_t* s = (uint64_t*)&state[i*AES_BLK_SIZE];
+      s[0] = block + i;
+      s[1] = (s[0] < block);
+    }
+}
+
+
 void PRNG::next()
 {
   // Increment state
@@ -150,12 +163,89 @@ __m128i PRNG::get_doubleword()
     return ans;
 }
 
+// Counter block encrypted to produce stream block k
+static inline __m128i counter_block(uint64_t k)
+{
+  uint64_t lo = k + PIPELINES;
+  return _mm_set_epi64x(lo < k, lo);
+}
+
+
+void PRNG::GenRndBlocks(octet* ans, uint64_t block, uint64_t num_blocks) const
+{
+  #ifdef USE_AES
+  // Only the AES-NI key schedule is set up when useC is false, and
+  //  the C version in aes.h is a stub, so there is nothing to fall
+  //  back to
+  if (useC)
+    { throw std::runtime_error("PRNG::GenRndBlocks requires AES-NI"); }
+  #endif
+  __m128i tmp[PIPELINES];
+  uint64_t i = 0;
+  // Keep PIPELINES blocks in flight and store straight to ans
+  for (; i + PIPELINES <= num_blocks; i += PIPELINES)
+    {
+      for (int k = 0; k < PIPELINES; k++)
+        tmp[k] = counter_block(block + i + k);
+      ecb_aes_128_encrypt<PIPELINES>(tmp,tmp,KeySchedule);
+      for (int k = 0; k < PIPELINES; k++)
+        _mm_storeu_si128((__m128i*)ans + i + k, tmp[k]);
+    }
+  for (; i < num_blocks; i++)
+    _mm_storeu_si128((__m128i*)ans + i, aes_128_encrypt(counter_block(block + i),KeySchedule));
+}
+
+
+void PRNG::Seek(uint64_t pos)
+{
+  // The buffer must start at a multiple of RAND_SIZE like it does
+  //  after reading from the seed, as get_uint and friends skip the
+  //  end of the buffer
+  set_state(pos / RAND_SIZE * PIPELINES);
+  next();
+  cnt = pos % RAND_SIZE;
+}
+
+
 void PRNG::GenRnd(uint8_t* ans, int len)
 {
+  // Use up what is left of the current random value first
+  int step=min(len,RAND_SIZE-cnt);
+  memcpy(ans,random+cnt,step);
+  cnt+=step;
+  if (cnt<RAND_SIZE)
+    return;
+  ans+=step;
+  len-=step;
+
+  #ifdef USE_AES
+  if (!useC)
+    {
+      // Whole blocks are encrypted directly into ans, only the
+      //  tail is staged through random. The block following the
+      //  current random value is the low word of state.
+      uint64_t block=((uint64_t*)state)[0];
+      uint64_t num_blocks=len/AES_BLK_SIZE;
+      GenRndBlocks(ans,block,num_blocks);
+      // Buffer the batch of PIPELINES blocks holding the tail, so the
+      //  buffer stays at the same boundaries as in the byte-by-byte
+      //  path and later get_uint calls skip the same bytes
+      uint64_t tail_block=block+num_blocks;
+      set_state(tail_block/PIPELINES*PIPELINES);
+      next();
+      cnt=(tail_block%PIPELINES)*AES_BLK_SIZE;
+      step=len-num_blocks*AES_BLK_SIZE;
+      memcpy(ans+num_blocks*AES_BLK_SIZE,random+cnt,step);
+      cnt+=step;
+      return;
+    }
+  #endif
+
+  next();
   int pos=0;
   while (len)
     {
-      int step=min(len,RAND_SIZE-cnt);
+      step=min(len,RAND_SIZE-cnt);
       memcpy(ans+pos,random+cnt,step);
       pos+=step;
       len-=step;
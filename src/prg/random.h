@@ -47,6 +47,7 @@ class PRNG
 
    void hash(); // Hashes state to random and sets cnt=0
    void next();
+   void set_state(uint64_t block); // Sets state so next() buffers blocks block,...
 
    
    PRNG();
@@ -69,6 +70,15 @@ class PRNG
 
    void GenRnd(octet* ans, int len);
 
+   // Encrypts num_blocks counter blocks of the stream, starting at
+   //  16-byte block index block, directly into ans. Does not touch
+   //  the buffered state, so can be used for random access.
+   void GenRndBlocks(octet* ans, uint64_t block, uint64_t num_blocks) const;
+
+   // Positions the stream at byte offset pos, as if pos bytes had
+   //  been read since the seed was set
+   void Seek(uint64_t pos);
+
    const octet* get_seed() const
      { return seed; }
 };
@@ -0,0 +1,15 @@
+#include "prg/seekable-prng.h"
+
+SeekablePRNG::SeekablePRNG(uint8_t seeds[], int num_rows, uint128_t seed_offset) : num_rows(num_rows), rows(num_rows) {
+
+  uint128_t seed;
+  for (int i = 0; i < num_rows; ++i) {
+    memcpy(&seed, seeds + i * SEED_SIZE, SEED_SIZE);
+    seed += seed_offset;
+    rows[i].SetSeed((uint8_t*) &seed);
+  }
+}
+
+void SeekablePRNG::GenRndBlocks(uint8_t* ans, int row, uint64_t block, uint64_t num_blocks) const {
+  rows[row].GenRndBlocks(ans, block, num_blocks);
+}
@@ -0,0 +1,18 @@
+#ifndef TINY_PRG_SEEKABLEPRNG_H_
+#define TINY_PRG_SEEKABLEPRNG_H_
+
+#include "prg/random.h"
+
+//Holds one PRNG stream per row, keyed with the row seed plus seed_offset. Any 16-byte block of any row can be produced in O(1) without generating the preceding blocks, so rows and blocks can be expanded out of order or from several threads at once.
+class SeekablePRNG {
+public:
+  SeekablePRNG(uint8_t seeds[], int num_rows, uint128_t seed_offset = 0);
+
+  //Writes num_blocks blocks of row starting at block into ans. Matches what GenRnd on a PRNG seeded with the row seed returns after block * AES_BLK_SIZE bytes.
+  void GenRndBlocks(uint8_t* ans, int row, uint64_t block, uint64_t num_blocks) const;
+
+  int num_rows;
+  std::vector<PRNG> rows;
+};
+
+#endif /* TINY_PRG_SEEKABLEPRNG_H_ */
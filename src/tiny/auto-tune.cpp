@@ -0,0 +1,249 @@
+#include "tiny/auto-tune.h"
+
+//Wall time of a phase with work_ms of single core work split over num_execs execs that each also wait stall_ms for the network. Only num_busy execs make progress at a time, but waiting execs overlap with working ones. transfer_ms is the least time the link needs for the data of the phase
+static double PhaseMs(double work_ms, double stall_ms, double transfer_ms, int num_execs, int num_busy) {
+  double cpu_ms = (work_ms + num_execs * TUNE_EXEC_OVERHEAD_MS) / std::min(num_execs, num_busy);
+  double exec_ms = work_ms / num_execs + TUNE_EXEC_OVERHEAD_MS + stall_ms;
+  return std::max(std::max(cpu_ms, exec_ms), transfer_ms);
+}
+
+//Tries powers of two up to max_execs and keeps the fewest execs with the lowest time
+template<typename PhaseFunc>
+static double BestExecs(int max_execs, int& num_execs, PhaseFunc phase_ms) {
+  num_execs = 1;
+  double best_ms = phase_ms(1);
+  for (int execs = 2; execs <= max_execs; execs *= 2) {
+    double ms = phase_ms(execs);
+    if (ms < best_ms) {
+      best_ms = ms;
+      num_execs = execs;
+    }
+  }
+  return best_ms;
+}
+
+AutoTuner::AutoTuner(Params& params, std::string tune_file) : params(params), tune_file(tune_file), num_gates(0), num_circuits(0), rtt_ms(0), mbit(0) {
+  FILE* file = fopen(tune_file.c_str(), "r");
+  if (file == NULL) {
+    return;
+  }
+
+  char key[64];
+  double val;
+  while (fscanf(file, "%63s %lf", key, &val) == 2) {
+    history[key] = val;
+  }
+  fclose(file);
+}
+
+ExecConfig AutoTuner::Agree(int num_circuits, bool amortized) {
+  this->num_circuits = num_circuits;
+  num_gates = params.num_pre_gates;
+
+  //The constructor decides whether to probe, so both parties run the same probes
+  uint8_t probe;
+  if (params.net_role) {
+    params.chan.ReceiveBlocking(&probe, 1);
+  } else {
+    probe = !(history.count("pre_execs") && history["gates"] == num_gates && history["circuits"] == num_circuits);
+    params.chan.Send(&probe, 1);
+  }
+
+  HostProbe host;
+  if (probe) {
+    host = ProbeHost();
+    ProbeLink();
+
+    HostProbe other_host;
+    if (params.net_role) {
+      params.chan.Send((uint8_t*) &host, sizeof(HostProbe));
+    } else {
+      params.chan.ReceiveBlocking((uint8_t*) &other_host, sizeof(HostProbe));
+      host.num_cpus = std::min(host.num_cpus, other_host.num_cpus);
+      host.mem_gbps = std::min(host.mem_gbps, other_host.mem_gbps);
+    }
+  }
+
+  if (params.net_role) {
+    params.chan.ReceiveBlocking((uint8_t*) &config, sizeof(ExecConfig));
+  } else {
+    if (probe) {
+      config = Choose(host, amortized);
+      std::cout << "Probed " << host.num_cpus << " cores, " << host.mem_gbps << " GB/s memory, " << rtt_ms << " ms RTT and " << mbit << " Mbit/s" << std::endl;
+    } else {
+      config.pre_num_execs = history["pre_execs"];
+      config.offline_num_execs = history["offline_execs"];
+      config.online_num_execs = history["online_execs"];
+      config.optimize_online = history["optimize_online"];
+    }
+    params.chan.Send((uint8_t*) &config, sizeof(ExecConfig));
+  }
+
+  ApplyConfig();
+  std::cout << (probe ? "Tuned" : "Reusing") << " -e " << config.pre_num_execs << "," << config.offline_num_execs << "," << config.online_num_execs << " -o " << config.optimize_online << std::endl;
+  return config;
+}
+
+void AutoTuner::Record(double preprocess_ms, double offline_ms, double online_ms) {
+  FILE* file = fopen(tune_file.c_str(), "w");
+  if (file == NULL) {
+    throw std::runtime_error("Could not write tune file " + tune_file);
+  }
+
+  //Tiny has rounded the gates since Agree, so the workload is recorded as it was asked for
+  fprintf(file, "gates %lu\n", num_gates);
+  fprintf(file, "circuits %d\n", num_circuits);
+  fprintf(file, "pre_execs %d\n", config.pre_num_execs);
+  fprintf(file, "offline_execs %d\n", config.offline_num_execs);
+  fprintf(file, "online_execs %d\n", config.online_num_execs);
+  fprintf(file, "optimize_online %d\n", config.optimize_online);
+  fprintf(file, "cpus %d\n", params.num_cpus);
+  fprintf(file, "wires %lu\n", params.num_garbled_wires);
+  fprintf(file, "eval_gates %lu\n", params.num_eval_gates);
+  fprintf(file, "preprocess_ms %f\n", preprocess_ms);
+  fprintf(file, "offline_ms %f\n", offline_ms);
+  fprintf(file, "online_ms %f\n", online_ms);
+  fclose(file);
+}
+
+HostProbe AutoTuner::ProbeHost() {
+  HostProbe host;
+  host.num_cpus = params.num_cpus;
+
+  //Every core copies between its own two buffers, which are far larger than its share of the caches
+  std::vector<std::unique_ptr<uint8_t[]>> buffers;
+  for (int i = 0; i < 2 * host.num_cpus; ++i) {
+    buffers.emplace_back(std::make_unique<uint8_t[]>(TUNE_MEM_PROBE_BYTES));
+    std::fill(buffers[i].get(), buffers[i].get() + TUNE_MEM_PROBE_BYTES, i);
+  }
+
+  std::vector<std::thread> threads;
+  auto probe_begin = GET_TIME();
+  for (int t = 0; t < host.num_cpus; ++t) {
+    uint8_t* a = buffers[2 * t].get();
+    uint8_t* b = buffers[2 * t + 1].get();
+    threads.emplace_back([a, b] {
+      for (int r = 0; r < TUNE_MEM_PROBE_ROUNDS; ++r) {
+        if (r % 2 == 0) {
+          std::copy(a, a + TUNE_MEM_PROBE_BYTES, b);
+        } else {
+          std::copy(b, b + TUNE_MEM_PROBE_BYTES, a);
+        }
+      }
+    });
+  }
+  for (std::thread& thread : threads) {
+    thread.join();
+  }
+  auto probe_end = GET_TIME();
+
+  //Each copied byte is read once and written once
+  double probe_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(probe_end - probe_begin).count();
+  host.mem_gbps = 2.0 * host.num_cpus * TUNE_MEM_PROBE_ROUNDS * TUNE_MEM_PROBE_BYTES / probe_ns;
+  return host;
+}
+
+void AutoTuner::ProbeLink() {
+  uint8_t ping = 0;
+  std::unique_ptr<uint8_t[]> bulk(std::make_unique<uint8_t[]>(TUNE_PROBE_BYTES));
+
+  if (params.net_role) {
+    for (int r = 0; r < TUNE_PROBE_ROUNDS; ++r) {
+      params.chan.ReceiveBlocking(&ping, 1);
+      params.chan.Send(&ping, 1);
+    }
+    params.chan.ReceiveBlocking(bulk.get(), TUNE_PROBE_BYTES);
+    params.chan.Send(&ping, 1);
+    return;
+  }
+
+  //The fastest round trip is the one least disturbed by other load on the hosts
+  rtt_ms = std::numeric_limits<double>::max();
+  for (int r = 0; r < TUNE_PROBE_ROUNDS; ++r) {
+    auto ping_begin = GET_TIME();
+    params.chan.Send(&ping, 1);
+    params.chan.ReceiveBlocking(&ping, 1);
+    auto ping_end = GET_TIME();
+    rtt_ms = std::min(rtt_ms, std::chrono::duration_cast<std::chrono::nanoseconds>(ping_end - ping_begin).count() / 1000000.0);
+  }
+
+  auto bulk_begin = GET_TIME();
+  params.chan.Send(bulk.get(), TUNE_PROBE_BYTES);
+  params.chan.ReceiveBlocking(&ping, 1);
+  auto bulk_end = GET_TIME();
+  double bulk_ms = std::chrono::duration_cast<std::chrono::nanoseconds>(bulk_end - bulk_begin).count() / 1000000.0 - rtt_ms;
+  mbit = 8.0 * TUNE_PROBE_BYTES / (std::max(bulk_ms, 0.001) * 1000);
+}
+
+ExecConfig AutoTuner::Choose(HostProbe& host, bool amortized) {
+  ExecConfig best;
+  double best_ms = std::numeric_limits<double>::max();
+  for (int optimize_online = 0; optimize_online < 2; ++optimize_online) {
+    if (!params.ChooseBucketParams(optimize_online)) {
+      continue;
+    }
+    params.ComputeGateAndAuthNumbers(params.num_pre_gates, params.num_pre_inputs, params.num_pre_outputs);
+
+    ExecConfig candidate;
+    candidate.optimize_online = optimize_online;
+    double pre_ms = PreprocessMs(host, candidate.pre_num_execs);
+    double total_ms = OfflineMs(host, candidate.offline_num_execs) + OnlineMs(host, candidate.online_num_execs);
+    if (!amortized) {
+      total_ms += pre_ms;
+    }
+
+    if (total_ms < best_ms) {
+      best_ms = total_ms;
+      best = candidate;
+    }
+  }
+  return best;
+}
+
+double AutoTuner::UnitNs(std::string phase_key, std::string execs_key, std::string units_key, double default_ns) {
+  if (history[phase_key] <= 0 || history[units_key] <= 0) {
+    return default_ns;
+  }
+  double num_busy = std::min(history[execs_key], history["cpus"]);
+  return history[phase_key] * 1000000 * num_busy / history[units_key];
+}
+
+double AutoTuner::PreprocessMs(HostProbe& host, int& num_execs) {
+  double work_ms = params.num_garbled_wires * UnitNs("preprocess_ms", "pre_execs", "wires", TUNE_NS_PR_WIRE) / 1000000;
+  double transfer_ms = params.num_garbled_wires * TUNE_BYTES_PR_WIRE * 8 / (mbit * 1000);
+  double stall_ms = TUNE_PRE_ROUND_TRIPS * rtt_ms;
+
+  //Preprocessing streams through its commitments, so the memory bandwidth can keep fewer execs busy than there are cores
+  int num_busy = std::max(1, std::min(host.num_cpus, (int) (host.mem_gbps / TUNE_GBPS_PR_EXEC)));
+  int max_execs = std::max(1, std::min(TUNE_MAX_EXECS, (int) (params.num_pre_gates / TUNE_MIN_GATES_PR_EXEC)));
+  return BestExecs(max_execs, num_execs, [&](int execs) {
+    return PhaseMs(work_ms, stall_ms, transfer_ms, execs, num_busy);
+  });
+}
+
+double AutoTuner::OfflineMs(HostProbe& host, int& num_execs) {
+  double work_ms = params.num_eval_gates * UnitNs("offline_ms", "offline_execs", "eval_gates", TUNE_NS_PR_SOLDER) / 1000000;
+  double transfer_ms = params.num_eval_gates * CSEC_BYTES * 8 / (mbit * 1000);
+
+  //Each circuit is soldered with one decommit round trip
+  int max_execs = std::max(1, std::min(TUNE_MAX_EXECS, num_circuits));
+  return BestExecs(max_execs, num_execs, [&](int execs) {
+    return PhaseMs(work_ms, CEIL_DIVIDE(num_circuits, execs) * rtt_ms, transfer_ms, execs, host.num_cpus);
+  });
+}
+
+double AutoTuner::OnlineMs(HostProbe& host, int& num_execs) {
+  double work_ms = params.num_eval_gates * UnitNs("online_ms", "online_execs", "eval_gates", TUNE_NS_PR_EVAL) / 1000000;
+
+  //Each exec needs two round trips pr. ONLINE_BATCH_SIZE circuits
+  int max_execs = std::max(1, std::min(TUNE_MAX_EXECS, num_circuits));
+  return BestExecs(max_execs, num_execs, [&](int execs) {
+    return PhaseMs(work_ms, 2 * CEIL_DIVIDE(CEIL_DIVIDE(num_circuits, execs), ONLINE_BATCH_SIZE) * rtt_ms, 0, execs, host.num_cpus);
+  });
+}
+
+void AutoTuner::ApplyConfig() {
+  params.num_execs = config.pre_num_execs;
+  params.ChooseBucketParams(config.optimize_online);
+  params.ComputeGateAndAuthNumbers(params.num_pre_gates, params.num_pre_inputs, params.num_pre_outputs);
+}
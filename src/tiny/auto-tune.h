@@ -0,0 +1,77 @@
+#ifndef TINY_TINY_AUTOTUNE_H_
+#define TINY_TINY_AUTOTUNE_H_
+
+#include "tiny/params.h"
+
+#include <map>
+
+//Probes
+#define TUNE_PROBE_ROUNDS 16 //Ping-pongs for the round trip time, the fastest one is used
+#define TUNE_PROBE_BYTES 8000000 //Sent once to measure the link bandwidth
+#define TUNE_MEM_PROBE_BYTES 8000000 //Copied back and forth by each core to measure memory bandwidth
+#define TUNE_MEM_PROBE_ROUNDS 8
+
+//Cost model. The pr. unit costs are only used until a run has been recorded in the tune file, after which the measured ones take over
+#define TUNE_NS_PR_WIRE 500 //Single core preprocessing time pr. garbled wire
+#define TUNE_NS_PR_SOLDER 20 //Single core offline time pr. evaluation gate
+#define TUNE_NS_PR_EVAL 30 //Single core online time pr. evaluation gate
+#define TUNE_BYTES_PR_WIRE 48 //Preprocessing traffic pr. garbled wire
+#define TUNE_EXEC_OVERHEAD_MS 2.0 //Fixed cost of an extra exec in a phase
+#define TUNE_GBPS_PR_EXEC 1.5 //Memory bandwidth a busy preprocessing exec needs
+#define TUNE_PRE_ROUND_TRIPS 8 //Round trips each preprocessing exec waits for
+#define TUNE_MIN_GATES_PR_EXEC 1024 //Below this a preprocessing exec is mostly fixed cost
+#define TUNE_MAX_EXECS 256
+
+struct ExecConfig {
+  int32_t pre_num_execs;
+  int32_t offline_num_execs;
+  int32_t online_num_execs;
+  int32_t optimize_online;
+};
+
+struct HostProbe {
+  int32_t num_cpus;
+  double mem_gbps;
+};
+
+//Picks the -e and -o values of a run instead of the user. Both parties probe their cores and memory bandwidth and the link between them, and the constructor feeds the slowest of each into a cost model of the three phases and sends the result to the evaluator. The model starts from fixed pr. unit costs, but each run records its phase times in tune_file and later runs derive the unit costs from those, so it adapts to the host after a single run. A run with the same number of gates and circuits as the recorded one reuses its config without probing.
+class AutoTuner {
+public:
+  //The config and timings of the last run are read from tune_file if it exists
+  AutoTuner(Params& params, std::string tune_file);
+
+  //Both parties must call this right after creating params, before a Tiny instance is created on it, as it changes params.num_execs and the bucket sizes. amortized leaves preprocessing out of the cost, for runs where it happens off the critical path
+  ExecConfig Agree(int num_circuits, bool amortized);
+
+  //Stores the config and the phase times measured with it in ms
+  void Record(double preprocess_ms, double offline_ms, double online_ms);
+
+private:
+  HostProbe ProbeHost();
+
+  //Sets rtt_ms and mbit. The evaluator only echoes
+  void ProbeLink();
+
+  ExecConfig Choose(HostProbe& host, bool amortized);
+
+  //Single core time in ns pr. unit of a phase in the recorded run, or default_ns if none was recorded
+  double UnitNs(std::string phase_key, std::string execs_key, std::string units_key, double default_ns);
+
+  //Expected time of each phase in ms, and the exec count that minimizes it
+  double PreprocessMs(HostProbe& host, int& num_execs);
+  double OfflineMs(HostProbe& host, int& num_execs);
+  double OnlineMs(HostProbe& host, int& num_execs);
+
+  void ApplyConfig();
+
+  Params& params;
+  std::string tune_file;
+  std::map<std::string, double> history;
+  ExecConfig config;
+  uint64_t num_gates;
+  int num_circuits;
+  double rtt_ms;
+  double mbit;
+};
+
+#endif /* TINY_TINY_AUTOTUNE_H_ */
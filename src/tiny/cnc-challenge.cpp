@@ -0,0 +1,65 @@
+#include "tiny/cnc-challenge.h"
+
+CnCChallenge::CnCChallenge(uint32_t num_items, int weight, PRNG& rnd) : num_items(num_items), num_words(CEIL_DIVIDE(num_items, 64)) {
+
+  //Pad to whole 128-bit lanes so the AND below needs no tail handling
+  int num_bytes = BITS_TO_BYTES(num_items);
+  int num_lanes = CEIL_DIVIDE(num_words * sizeof(uint64_t), AES_BYTES);
+  mask = std::make_unique<uint64_t[]>(2 * num_lanes);
+  std::unique_ptr<uint64_t[]> rand(std::make_unique<uint64_t[]>(2 * num_lanes));
+
+  //Each bit survives weight ANDs with fresh randomness
+  std::fill(mask.get(), mask.get() + 2 * num_lanes, ~(uint64_t) 0);
+  __m128i* mask_128 = (__m128i*) mask.get();
+  __m128i* rand_128 = (__m128i*) rand.get();
+  for (int w = 0; w < weight; ++w) {
+    rnd.GenRnd((uint8_t*) rand.get(), num_bytes);
+    for (int i = 0; i < num_lanes; ++i) {
+      _mm_store_si128(mask_128 + i, _mm_and_si128(_mm_load_si128(mask_128 + i), _mm_load_si128(rand_128 + i)));
+    }
+  }
+
+  //Clear the bits past num_items in the last word
+  if (num_items % 64) {
+    mask[num_words - 1] &= (((uint64_t) 1) << (num_items % 64)) - 1;
+  }
+
+  //Prefix sums of the check counts give each word its first check and eval position
+  checks_before_word = std::make_unique<uint32_t[]>(num_words + 1);
+  uint32_t sum = 0;
+  for (uint32_t j = 0; j < num_words; ++j) {
+    checks_before_word[j] = sum;
+    sum += __builtin_popcountll(mask[j]);
+  }
+  checks_before_word[num_words] = sum;
+  num_checks = sum;
+  num_evals = num_items - num_checks;
+
+  check_ids = std::make_unique<uint32_t[]>(num_checks);
+  eval_ids = std::make_unique<uint32_t[]>(num_evals);
+  FillIndices(0, num_words);
+}
+
+void CnCChallenge::FillIndices(uint32_t from_word, uint32_t to_word) {
+  for (uint32_t j = from_word; j < to_word; ++j) {
+    uint32_t check_pos = checks_before_word[j];
+    uint32_t eval_pos = j * 64 - check_pos;
+    uint32_t word_items = std::min((uint32_t) 64, num_items - j * 64);
+
+    uint64_t checks = mask[j];
+    while (checks) {
+      check_ids[check_pos++] = j * 64 + __builtin_ctzll(checks);
+      checks &= checks - 1;
+    }
+
+    //The eval items are the zero bits within the word
+    uint64_t evals = ~mask[j];
+    if (word_items < 64) {
+      evals &= (((uint64_t) 1) << word_items) - 1;
+    }
+    while (evals) {
+      eval_ids[eval_pos++] = j * 64 + __builtin_ctzll(evals);
+      evals &= evals - 1;
+    }
+  }
+}
@@ -0,0 +1,31 @@
+#ifndef TINY_TINY_CNCCHALLENGE_H_
+#define TINY_TINY_CNCCHALLENGE_H_
+
+#include "util/util.h"
+
+//Cut-and-choose challenge over num_items gates or auths. Each item is a check item with probability 2^-weight. The mask is sampled from exactly weight * BITS_TO_BYTES(num_items) bytes of rnd, the same bytes and order as weight fresh strings ANDed together, so both parties agree given the same cnc seed.
+class CnCChallenge {
+public:
+  CnCChallenge(uint32_t num_items, int weight, PRNG& rnd);
+
+  //Writes the check and eval indices of the items in mask words [from_word, to_word). Disjoint word ranges can be filled concurrently as all output positions are given by the prefix sums.
+  void FillIndices(uint32_t from_word, uint32_t to_word);
+
+  bool IsCheck(uint32_t i) {
+    return (mask[i / 64] >> (i % 64)) & 1;
+  };
+
+  uint32_t num_items;
+  uint32_t num_words;
+  uint32_t num_checks;
+  uint32_t num_evals;
+
+  std::unique_ptr<uint64_t[]> mask;
+  std::unique_ptr<uint32_t[]> checks_before_word;
+
+  //Indices in [0, num_items) of the check items and of the remaining items, both in increasing order
+  std::unique_ptr<uint32_t[]> check_ids;
+  std::unique_ptr<uint32_t[]> eval_ids;
+};
+
+#endif /* TINY_TINY_CNCCHALLENGE_H_ */
@@ -1,9 +1,18 @@
 #include "tiny/tiny.h"
 
-Params::Params(uint8_t* seed, uint64_t num_pre_gates, uint64_t num_pre_inputs, uint64_t num_pre_outputs, std::string ip_address, uint16_t port, uint8_t net_role, zmq::context_t& context, int num_execs, int exec_id, bool optimize_online) : crypt(CSEC, seed), num_cpus(std::thread::hardware_concurrency()), num_execs(num_execs), exec_id(exec_id), context(context), ip_address(ip_address), port(port), net_role(net_role), chan(ip_address, port + exec_id + 1, port + exec_id + 1 + MAX_TOTAL_PARAMS, net_role, context){
+Params::Params(uint8_t* seed, uint64_t num_pre_gates, uint64_t num_pre_inputs, uint64_t num_pre_outputs, std::string ip_address, uint16_t port, uint8_t net_role, zmq::context_t& context, int num_execs, int exec_id, bool optimize_online) : crypt(CSEC, seed), num_cpus(std::thread::hardware_concurrency()), num_execs(num_execs), exec_id(exec_id), ip_address(ip_address), port(port), net_role(net_role), context(context), mux(std::make_shared<Multiplexer>(ip_address, port + 1, net_role, context)), chan(*mux, exec_id) {
 
   rnd.SetSeed(seed);
 
+  this->num_pre_gates = num_pre_gates;
+  if (!ChooseBucketParams(optimize_online)) {
+    std::cout << "No online param choices available. Defaulting to normal mode." << std::endl;
+  }
+
+  ComputeGateAndAuthNumbers(num_pre_gates, num_pre_inputs, num_pre_outputs);
+}
+
+bool Params::ChooseBucketParams(bool optimize_online) {
   bool found = false;
   for (int i = 0; i < bucket_param_table_size; ++i) {
     if (num_pre_gates > bucket_param_table[i][0]) {
@@ -20,30 +29,27 @@ Params::Params(uint8_t* seed, uint64_t num_pre_gates, uint64_t num_pre_inputs, u
     throw std::runtime_error("Insufficient number of garbled gates requested.");
   }
 
+  bool found_online = true;
   if (optimize_online) {
-    bool found = false;
+    found_online = false;
     for (int i = 0; i < bucket_param_table_online_size; ++i) {
       if (num_pre_gates > bucket_param_table_online[i][0]) {
         num_auth = bucket_param_table_online[i][1];
         num_bucket = bucket_param_table_online[i][2];
         p_a = bucket_param_table_online[i][3];
         p_g = bucket_param_table_online[i][4];
-        found = true;
+        found_online = true;
         break; //Do not try worse parameters
       }
     }
-    if (!found) {
-      std::cout << "No online param choices available. Defaulting to normal mode." << std::endl;
-    }
   }
 
   num_inp_auth = (2 * num_auth + 1);
   num_inp_bucket = (2 * num_bucket + 1);
-
-  ComputeGateAndAuthNumbers(num_pre_gates, num_pre_inputs, num_pre_outputs);
+  return found_online;
 }
 
-Params::Params(Params& MainParams, uint8_t* seed, uint64_t num_pre_gates, uint64_t num_pre_inputs, uint64_t num_pre_outputs, int exec_id) : crypt(CSEC, seed), num_cpus(std::thread::hardware_concurrency()), num_execs(MainParams.num_execs), exec_id(exec_id), context(MainParams.context), ip_address(MainParams.ip_address), port(MainParams.port), net_role(MainParams.net_role), chan(ip_address, port + exec_id + 1, port + exec_id + 1 + MAX_TOTAL_PARAMS, net_role, context) {
+Params::Params(Params& MainParams, uint8_t* seed, uint64_t num_pre_gates, uint64_t num_pre_inputs, uint64_t num_pre_outputs, int exec_id) : crypt(CSEC, seed), num_cpus(std::thread::hardware_concurrency()), num_execs(MainParams.num_execs), exec_id(exec_id), ip_address(MainParams.ip_address), port(MainParams.port), net_role(MainParams.net_role), context(MainParams.context), mux(MainParams.mux), chan(*mux, exec_id) {
 
   rnd.SetSeed(seed);
 
@@ -11,6 +11,8 @@ public:
   Params(uint8_t* seed, uint64_t num_pre_gates, uint64_t num_pre_inputs, uint64_t num_pre_outputs, std::string ip_address, uint16_t port, uint8_t net_role, zmq::context_t& context, int num_exces, int exec_id = GLOBAL_PARAMS_CHAN, bool optimize_online = FALSE);
   Params(Params& MainParams, uint8_t* seed, uint64_t num_pre_gates, uint64_t num_pre_inputs, uint64_t num_pre_outputs, int exec_id);
 
+  //Picks the bucket sizes and check fractions for num_pre_gates from the normal table, or from the online table if optimize_online. Returns false if the online table has no choice for num_pre_gates, leaving the normal choice in place. ComputeGateAndAuthNumbers must be run again afterwards
+  bool ChooseBucketParams(bool optimize_online);
   void ComputeCheckFractions();
   void ComputeGateAndAuthNumbers(uint64_t num_pre_gates, uint64_t num_pre_inputs, uint64_t num_pre_outputs);
 
@@ -68,6 +70,9 @@ public:
   uint16_t port;
   uint8_t net_role;
   zmq::context_t& context;
+
+  //Created by the main params and shared by all sub-params, so every channel uses the same two connections
+  std::shared_ptr<Multiplexer> mux;
   Channel chan;
 };
 
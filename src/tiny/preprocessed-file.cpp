@@ -0,0 +1,140 @@
+#include "tiny/preprocessed-file.h"
+
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+PreprocessedWriter::PreprocessedWriter(std::string path) : offset(0) {
+  file = fopen(path.c_str(), "wb");
+  if (file == NULL) {
+    throw std::runtime_error("Could not create preprocessed file " + path);
+  }
+  Write<uint64_t>(PRE_FILE_MAGIC);
+  Write<uint32_t>(PRE_FILE_VERSION);
+}
+
+PreprocessedWriter::~PreprocessedWriter() {
+  fclose(file);
+}
+
+void PreprocessedWriter::Write(const void* buf, uint64_t num_bytes) {
+  if (fwrite(buf, 1, num_bytes, file) != num_bytes) {
+    throw std::runtime_error("Could not write preprocessed file");
+  }
+  offset += num_bytes;
+}
+
+uint64_t PreprocessedWriter::WriteAligned(const void* buf, uint64_t num_bytes) {
+  uint8_t zeros[PRE_FILE_ALIGN] = {0};
+  Write(zeros, PAD_TO_MULTIPLE(offset, PRE_FILE_ALIGN) - offset);
+
+  uint64_t buf_offset = offset;
+  Write(buf, num_bytes);
+  return buf_offset;
+}
+
+void PreprocessedWriter::WriteBlocks(std::vector<std::unique_ptr<uint8_t[]>>& blocks, uint64_t num_blocks, uint64_t block_size) {
+  if (blocks.size() < num_blocks) {
+    throw std::runtime_error("Only execs holding their commitment blocks can be saved");
+  }
+
+  Write<uint64_t>(num_blocks);
+  Write<uint64_t>(block_size);
+  for (uint64_t j = 0; j < num_blocks; ++j) {
+    uint64_t block_offset;
+    if (j == 0) {
+      block_offset = WriteAligned(blocks[j].get(), block_size);
+    } else {
+      block_offset = offset;
+      Write(blocks[j].get(), block_size);
+    }
+    block_offsets[blocks[j].get()] = std::make_pair(block_offset, block_size);
+  }
+}
+
+void PreprocessedWriter::WriteShares(std::vector<uint8_t*>& shares) {
+  std::unique_ptr<uint64_t[]> share_offsets(std::make_unique<uint64_t[]>(shares.size()));
+  for (uint64_t i = 0; i < shares.size(); ++i) {
+    auto block = block_offsets.upper_bound(shares[i]);
+    if (block == block_offsets.begin()) {
+      throw std::runtime_error("Commitment share outside of the written blocks");
+    }
+    --block;
+    if (shares[i] >= block->first + block->second.second) {
+      throw std::runtime_error("Commitment share outside of the written blocks");
+    }
+    share_offsets[i] = block->second.first + (shares[i] - block->first);
+  }
+
+  Write<uint64_t>(shares.size());
+  WriteAligned(share_offsets.get(), shares.size() * sizeof(uint64_t));
+}
+
+PreprocessedReader::PreprocessedReader(std::string path) : offset(0) {
+  int fd = open(path.c_str(), O_RDONLY);
+  struct stat st;
+  if (fd < 0 || fstat(fd, &st) != 0) {
+    throw std::runtime_error("Could not open preprocessed file " + path);
+  }
+  size = st.st_size;
+
+  //Pages are only read from disk when first touched, so startup does not depend on the size of the file
+  void* map = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if (map == MAP_FAILED) {
+    throw std::runtime_error("Could not map preprocessed file " + path);
+  }
+  uint64_t map_size = size;
+  mapping = std::shared_ptr<uint8_t>((uint8_t*) map, [map_size](uint8_t* map) {
+    munmap(map, map_size);
+  });
+
+  if (size < sizeof(uint64_t) + sizeof(uint32_t) || Read<uint64_t>() != PRE_FILE_MAGIC) {
+    throw std::runtime_error(path + " is not a preprocessed file");
+  }
+  if (Read<uint32_t>() != PRE_FILE_VERSION) {
+    throw std::runtime_error(path + " was written by an incompatible version");
+  }
+}
+
+void PreprocessedReader::Read(void* buf, uint64_t num_bytes) {
+  if (offset + num_bytes > size) {
+    throw std::runtime_error("Preprocessed file is truncated");
+  }
+  std::copy(mapping.get() + offset, mapping.get() + offset + num_bytes, (uint8_t*) buf);
+  offset += num_bytes;
+}
+
+uint8_t* PreprocessedReader::ReadAligned(uint64_t num_bytes) {
+  offset = PAD_TO_MULTIPLE(offset, PRE_FILE_ALIGN);
+  uint8_t* buf = At(offset);
+  if (offset + num_bytes > size) {
+    throw std::runtime_error("Preprocessed file is truncated");
+  }
+  offset += num_bytes;
+  return buf;
+}
+
+uint8_t* PreprocessedReader::At(uint64_t file_offset) {
+  if (file_offset > size) {
+    throw std::runtime_error("Preprocessed file is truncated");
+  }
+  return mapping.get() + file_offset;
+}
+
+void PreprocessedReader::SkipBlocks() {
+  uint64_t num_blocks = Read<uint64_t>();
+  uint64_t block_size = Read<uint64_t>();
+  ReadAligned(num_blocks * block_size);
+}
+
+void PreprocessedReader::ReadShares(std::vector<uint8_t*>& shares) {
+  uint64_t num_shares = Read<uint64_t>();
+  uint64_t* share_offsets = (uint64_t*) ReadAligned(num_shares * sizeof(uint64_t));
+
+  shares.resize(num_shares);
+  for (uint64_t i = 0; i < num_shares; ++i) {
+    shares[i] = At(share_offsets[i]);
+  }
+}
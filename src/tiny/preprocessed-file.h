@@ -0,0 +1,74 @@
+#ifndef TINY_TINY_PREPROCESSEDFILE_H_
+#define TINY_TINY_PREPROCESSEDFILE_H_
+
+#include "util/util.h"
+
+#include <map>
+
+#define PRE_FILE_MAGIC 0x3146657250796e54 //"TnyPreF1"
+#define PRE_FILE_VERSION 1
+#define PRE_FILE_ALIGN 4096
+
+//On-disk format of a party's preprocessed state. The file is a sequence of fixed size fields and arrays in the order they are written, preceded by a magic number and a version that is bumped whenever the layout changes. Large arrays are page aligned so a reader can use them in place after mapping the file.
+class PreprocessedWriter {
+public:
+  PreprocessedWriter(std::string path);
+  ~PreprocessedWriter();
+
+  void Write(const void* buf, uint64_t num_bytes);
+
+  //Pads the file to PRE_FILE_ALIGN first and returns the offset of buf in the file
+  uint64_t WriteAligned(const void* buf, uint64_t num_bytes);
+
+  template<typename T> void Write(T val) {
+    Write(&val, sizeof(T));
+  }
+
+  //Writes the first num_blocks commitment blocks back to back and remembers where each one was placed
+  void WriteBlocks(std::vector<std::unique_ptr<uint8_t[]>>& blocks, uint64_t num_blocks, uint64_t block_size);
+
+  //Writes each share pointer as the file offset of the data it points to. The shares of one exec may point into the blocks of another (the global delta commitment), so all blocks of a batch must be written before any of its shares.
+  void WriteShares(std::vector<uint8_t*>& shares);
+
+  uint64_t offset;
+
+private:
+  FILE* file;
+
+  //Block start -> (file offset, block size)
+  std::map<uint8_t*, std::pair<uint64_t, uint64_t>> block_offsets;
+};
+
+//Maps the whole file copy-on-write, so arrays can be handed out as pointers into the mapping while the file itself is never modified.
+class PreprocessedReader {
+public:
+  PreprocessedReader(std::string path);
+
+  void Read(void* buf, uint64_t num_bytes);
+
+  //Skips the padding written by WriteAligned and returns a pointer into the mapping
+  uint8_t* ReadAligned(uint64_t num_bytes);
+
+  uint8_t* At(uint64_t file_offset);
+
+  //Skips blocks written by WriteBlocks. They are reached through the shares
+  void SkipBlocks();
+
+  //Points shares into the mapping
+  void ReadShares(std::vector<uint8_t*>& shares);
+
+  template<typename T> T Read() {
+    T val;
+    Read(&val, sizeof(T));
+    return val;
+  }
+
+  //Unmaps the file once the last copy is gone. Everything pointing into the mapping must hold a copy
+  std::shared_ptr<uint8_t> mapping;
+
+private:
+  uint64_t size;
+  uint64_t offset;
+};
+
+#endif /* TINY_TINY_PREPROCESSEDFILE_H_ */
@@ -2,12 +2,33 @@
 
 TinyConstructor::TinyConstructor(Params& params) :
   Tiny(params),
-  ot_snd(params, true),  //The true flag ensures that lsb(global_delta) == 1
-  rot_seeds0(std::make_unique<uint8_t[]>(2 * CODEWORD_BITS * CSEC_BYTES)),
-  rot_seeds1(rot_seeds0.get() + CODEWORD_BITS * CSEC_BYTES),
-  raw_eval_ids(std::make_unique<uint32_t[]>(params.num_eval_gates + params.num_eval_auths)) {
+  ot_snd(params, true) {  //The true flag ensures that lsb(global_delta) == 1
 
-  //The global eval_gate and eval_auth mappings. The below executions populate these arrays as the ids are received.
+  InitBatch();
+}
+
+TinyConstructor::~TinyConstructor() {
+  StopBackground();
+}
+
+//Replaces the active batch with freshly allocated and empty state
+void TinyConstructor::InitBatch() {
+  Batch batch;
+  batch.rot_seeds0 = std::make_unique<uint8_t[]>(2 * CODEWORD_BITS * CSEC_BYTES);
+  //The eval ids are read at random by all execs, so no node should hold them all
+  batch.raw_eval_ids = MakeInterleaved<uint32_t>(params.num_eval_gates + params.num_eval_auths);
+  SwapBatch(batch);
+}
+
+void TinyConstructor::SwapBatch(Batch& batch) {
+  std::swap(thread_params_vec, batch.thread_params_vec);
+  std::swap(commit_snds, batch.commit_snds);
+  std::swap(rot_seeds0, batch.rot_seeds0);
+  std::swap(raw_eval_ids, batch.raw_eval_ids);
+  std::swap(mapping, batch.mapping);
+
+  //The global eval_gate and eval_auth mappings. The preprocessing executions populate these arrays as the ids are received.
+  rot_seeds1 = rot_seeds0.get() + CODEWORD_BITS * CSEC_BYTES;
   eval_gates_ids = raw_eval_ids.get();
   eval_auths_ids = eval_gates_ids + params.num_eval_gates;
 }
@@ -24,6 +45,25 @@ void TinyConstructor::Setup() {
 }
 
 void TinyConstructor::Preprocess() {
+  if (num_preprocessed == 0) {
+    PreprocessBatch();
+  } else {
+    //Keep the active batch aside while the new one is produced in fresh buffers, then queue the new one behind it
+    std::unique_ptr<Batch> active(std::make_unique<Batch>());
+    SwapBatch(*active);
+    InitBatch();
+    params.rnd.GenRnd(thread_seeds.get(), CSEC_BYTES * params.num_execs);
+
+    PreprocessBatch();
+
+    queued_batches.emplace_back(std::make_unique<Batch>());
+    SwapBatch(*queued_batches.back());
+    SwapBatch(*active);
+  }
+  ++num_preprocessed;
+}
+
+void TinyConstructor::PreprocessBatch() {
   std::vector<std::vector<std::chrono::duration<long double, std::milli>>> durations(CONST_NUM_TIMINGS);
 
   for (std::vector<std::chrono::duration<long double, std::milli>>& duration : durations) {
@@ -55,6 +95,7 @@ void TinyConstructor::Preprocess() {
   //Containers for holding pointers to objects used in each exec. For future use
   std::vector<std::future<void>> cnc_execs_finished(params.num_execs);
   std::unique_ptr<uint32_t[]> tmp_gate_eval_ids_ptr(new uint32_t[params.num_eval_gates + params.num_eval_auths]);
+  NumaTopology::Get().Interleave(tmp_gate_eval_ids_ptr.get(), (params.num_eval_gates + params.num_eval_auths) * sizeof(uint32_t));
   uint32_t* tmp_gate_eval_ids = tmp_gate_eval_ids_ptr.get();
   uint32_t* tmp_auth_eval_ids = tmp_gate_eval_ids + params.num_eval_gates;
 
@@ -84,7 +125,7 @@ void TinyConstructor::Preprocess() {
     int thread_num_pre_gates = gates_to[exec_id] - gates_from[exec_id];
 
     //Need to create a new params for each execution with the correct num_pre_gates and num_pre_inputs. The exec_id value decides which channel the execution is communicating on, so must match the eval execution.
-    thread_params_vec.emplace_back(std::make_unique<Params>(params, thread_seeds.get() + exec_id * CSEC_BYTES, thread_num_pre_gates, thread_num_pre_inputs, thread_num_pre_outputs, exec_id));
+    thread_params_vec.emplace_back(std::make_unique<Params>(params, thread_seeds.get() + exec_id * CSEC_BYTES, thread_num_pre_gates, thread_num_pre_inputs, thread_num_pre_outputs, exec_chan_offset + exec_id));
     Params* thread_params = thread_params_vec[exec_id].get();
 
     //We store our local state in the containers as we need to access them for future use
@@ -96,6 +137,8 @@ void TinyConstructor::Preprocess() {
 
     //Starts the current execution
     cnc_execs_finished[exec_id] = thread_pool.push([this, thread_params, commit_snd, delta_holder, exec_id, &cout_mutex, &delta_checks, inp_from, inp_to, last_exec_id, &durations, tmp_auth_eval_ids, tmp_gate_eval_ids] (int id) {
+      //The commitment matrices and garbling buffers of the exec are allocated below, so they are first touched on its node
+      NodePin pin(NumaTopology::Get().NodeOfExec(exec_id, params.num_execs));
 
       auto commit_begin = GET_TIME();
       // If it's the last execution then we commit to s extra OTs as these are to be used for CNC.
@@ -217,8 +260,8 @@ void TinyConstructor::Preprocess() {
       //===========================Run Garbling================================
       auto garbling_begin = GET_TIME();
 
-      //Holds all memory needed for garbling
-      std::unique_ptr<uint8_t[]> raw_garbling_data(std::make_unique<uint8_t[]>(3 * thread_params->Q * CSEC_BYTES + 2 * thread_params->A * CSEC_BYTES + (3 * thread_params->Q + thread_params->A) * CSEC_BYTES));
+      //Holds all memory needed for garbling. Shared as every chunk message sent below keeps the buffer alive until ZMQ has written it
+      std::shared_ptr<uint8_t> raw_garbling_data(MakeLarge<uint8_t>(3 * thread_params->Q * CSEC_BYTES + 2 * thread_params->A * CSEC_BYTES + (3 * thread_params->Q + thread_params->A) * CSEC_BYTES).release(), std::default_delete<uint8_t[]>());
       std::unique_ptr<uint32_t[]> raw_id_data(std::make_unique<uint32_t[]>(thread_params->Q + thread_params->A));
 
       //For convenience we assign pointers into the garbling data.
@@ -236,35 +279,49 @@ void TinyConstructor::Preprocess() {
       uint32_t* gate_ids = raw_id_data.get();
       uint32_t* auth_ids = gate_ids + thread_params->Q;
 
-      //Construct all 0-keys used in gates and all gate ids
-      for (int i = 0; i < thread_params->Q; ++i) {
-        XOR_128(keys + i * CSEC_BYTES, commit_snd->commit_shares0[thread_params->left_keys_start + i], commit_snd->commit_shares1[thread_params->left_keys_start + i]);
-        XOR_128(keys + (thread_params->Q + i) * CSEC_BYTES, commit_snd->commit_shares0[thread_params->right_keys_start + i], commit_snd->commit_shares1[thread_params->right_keys_start + i]);
-        XOR_128(keys + (2 * thread_params->Q + i) * CSEC_BYTES, commit_snd->commit_shares0[thread_params->out_keys_start + i], commit_snd->commit_shares1[thread_params->out_keys_start + i]);
-        gate_ids[i] = exec_id * (thread_params->Q + thread_params->A) + thread_params->out_keys_start + i;
-      }
-
-      //Garble all gates which stores the garbled tables in gates_data.T_G and gates_data.T_E and output keys in gates_data.S_O for convenience
       GarblingHandler gh(*thread_params);
-      gh.GarbleGates(gates_data, 0, keys, keys + thread_params->Q * CSEC_BYTES, global_delta, gate_ids, thread_params->Q);
 
-      //Solder output wire with the designated committed value for output wires
-      for (uint32_t i = 0; i < thread_params->Q; ++i) {
-        XOR_128(gates_data.S_O + i * CSEC_BYTES, keys + (2 * thread_params->Q + i) * CSEC_BYTES);
-      }
+      //Gates and auths (but not keys) are garbled and sent in chunks of GARBLING_CHUNK_SIZE so ZMQ transmits chunk k while chunk k+1 is garbled. The evaluator receives with the same chunking
+      for (uint32_t c = 0; c < thread_params->Q; c += GARBLING_CHUNK_SIZE) {
+        uint32_t chunk_size = std::min((uint64_t) GARBLING_CHUNK_SIZE, thread_params->Q - c);
 
-      //Construct all 0-keys used for authenticators and all auth ids
-      for (int i = 0; i < thread_params->A; ++i) {
-        XOR_128(keys + (3 * thread_params->Q + i) * CSEC_BYTES, commit_snd->commit_shares0[thread_params->auth_start + i], commit_snd->commit_shares1[thread_params->auth_start + i]);
+        //Construct all 0-keys used in gates and all gate ids
+        for (uint32_t i = c; i < c + chunk_size; ++i) {
+          XOR_128(keys + i * CSEC_BYTES, commit_snd->commit_shares0[thread_params->left_keys_start + i], commit_snd->commit_shares1[thread_params->left_keys_start + i]);
+          XOR_128(keys + (thread_params->Q + i) * CSEC_BYTES, commit_snd->commit_shares0[thread_params->right_keys_start + i], commit_snd->commit_shares1[thread_params->right_keys_start + i]);
+          XOR_128(keys + (2 * thread_params->Q + i) * CSEC_BYTES, commit_snd->commit_shares0[thread_params->out_keys_start + i], commit_snd->commit_shares1[thread_params->out_keys_start + i]);
+          gate_ids[i] = exec_id * (thread_params->Q + thread_params->A) + thread_params->out_keys_start + i;
+        }
 
-        auth_ids[i] = exec_id * (thread_params->Q + thread_params->A) + thread_params->auth_start + i;
+        //Garble the gates which stores the garbled tables in gates_data.T_G and gates_data.T_E and output keys in gates_data.S_O for convenience
+        gh.GarbleGates(gates_data, c, keys, keys + thread_params->Q * CSEC_BYTES, global_delta, gate_ids, chunk_size);
+
+        //Solder output wire with the designated committed value for output wires
+        for (uint32_t i = c; i < c + chunk_size; ++i) {
+          XOR_128(gates_data.S_O + i * CSEC_BYTES, keys + (2 * thread_params->Q + i) * CSEC_BYTES);
+        }
+
+        thread_params->chan.Send(raw_garbling_data, gates_data.T_G + c * CSEC_BYTES, chunk_size * CSEC_BYTES);
+        thread_params->chan.Send(raw_garbling_data, gates_data.T_E + c * CSEC_BYTES, chunk_size * CSEC_BYTES);
+        thread_params->chan.Send(raw_garbling_data, gates_data.S_O + c * CSEC_BYTES, chunk_size * CSEC_BYTES);
       }
 
-      //Garble the auths which stores the two authenticators in auths_data.H_0 and auths_data.H_1
-      gh.GarbleAuths(auths_data, 0, keys + 3 * thread_params->Q * CSEC_BYTES, global_delta, auth_ids, thread_params->A);
+      for (uint32_t c = 0; c < thread_params->A; c += GARBLING_CHUNK_SIZE) {
+        uint32_t chunk_size = std::min((uint64_t) GARBLING_CHUNK_SIZE, thread_params->A - c);
 
-      //Sends gates and auths (but not keys)
-      thread_params->chan.Send(raw_garbling_data.get(), 3 * thread_params->Q * CSEC_BYTES + 2 * thread_params->A * CSEC_BYTES);
+        //Construct all 0-keys used for authenticators and all auth ids
+        for (uint32_t i = c; i < c + chunk_size; ++i) {
+          XOR_128(keys + (3 * thread_params->Q + i) * CSEC_BYTES, commit_snd->commit_shares0[thread_params->auth_start + i], commit_snd->commit_shares1[thread_params->auth_start + i]);
+
+          auth_ids[i] = exec_id * (thread_params->Q + thread_params->A) + thread_params->auth_start + i;
+        }
+
+        //Garble the auths which stores the two authenticators in auths_data.H_0 and auths_data.H_1
+        gh.GarbleAuths(auths_data, c, keys + 3 * thread_params->Q * CSEC_BYTES, global_delta, auth_ids, chunk_size);
+
+        thread_params->chan.Send(raw_garbling_data, auths_data.H_0 + c * CSEC_BYTES, chunk_size * CSEC_BYTES);
+        thread_params->chan.Send(raw_garbling_data, auths_data.H_1 + c * CSEC_BYTES, chunk_size * CSEC_BYTES);
+      }
 
       auto garbling_end = GET_TIME();
       durations[CONST_GARBLING_TIME][exec_id] = garbling_end - garbling_begin;
@@ -276,19 +333,15 @@ void TinyConstructor::Preprocess() {
       thread_params->chan.ReceiveBlocking(cnc_seed, CSEC_BYTES);
       auto cnc_begin = GET_TIME();
 
-      //Sample check gates and check auths along with the challenge inputs to these. SampleChallenges populates all these variables
-      int num_bytes_gates = BITS_TO_BYTES(thread_params->Q);
-      int num_bytes_auths = BITS_TO_BYTES(thread_params->A);
+      //Sample check gates and check auths along with the challenge inputs to these. The CnCChallenge objects hold the check and eval index lists
       PRNG cnc_rand;
       cnc_rand.SetSeed(cnc_seed);
 
-      std::unique_ptr<uint8_t[]> cnc_check_gates(std::make_unique<uint8_t[]>(num_bytes_gates + num_bytes_auths));
-      uint8_t* cnc_check_auths = cnc_check_gates.get() + num_bytes_gates;
-      WeightedRandomString(cnc_check_gates.get(), thread_params->p_g, num_bytes_gates, cnc_rand);
-      WeightedRandomString(cnc_check_auths, thread_params->p_a, num_bytes_auths, cnc_rand);
+      CnCChallenge gate_challenge(thread_params->Q, thread_params->p_g, cnc_rand);
+      CnCChallenge auth_challenge(thread_params->A, thread_params->p_a, cnc_rand);
 
-      int num_check_gates = countSetBits(cnc_check_gates.get(), 0, thread_params->Q - 1);
-      int num_check_auths = countSetBits(cnc_check_auths, 0, thread_params->A - 1);
+      int num_check_gates = gate_challenge.num_checks;
+      int num_check_auths = auth_challenge.num_checks;
 
       std::unique_ptr<uint8_t[]> left_cnc_input(std::make_unique<uint8_t[]>(3 * BITS_TO_BYTES(num_check_gates) + BITS_TO_BYTES(num_check_auths)));
       uint8_t* right_cnc_input = left_cnc_input.get() + BITS_TO_BYTES(num_check_gates);
@@ -307,77 +360,73 @@ void TinyConstructor::Preprocess() {
       int num_checks = 3 * num_check_gates + num_check_auths;
       int num_check_keys_sent = 2 * num_check_gates + num_check_auths;
       std::unique_ptr<uint8_t[]> cnc_reply_keys(std::make_unique<uint8_t[]>(num_check_keys_sent * CSEC_BYTES));
-      std::unique_ptr<uint8_t[]> cnc_decommit_shares0(std::make_unique<uint8_t[]>(2 * num_checks * CODEWORD_BYTES));
+      std::unique_ptr<uint8_t[]> cnc_decommit_shares0(MakeLarge<uint8_t>(2 * num_checks * CODEWORD_BYTES));
       uint8_t* cnc_decommit_shares1 = cnc_decommit_shares0.get() + num_checks * CODEWORD_BYTES;
 
-      int current_auth_check_num = 0;
-      int current_eval_auth_num = 0;
-      for (uint32_t i = 0; i < thread_params->A; ++i) {
-        if (GetBit(i, cnc_check_auths)) {
-          XOR_128(cnc_reply_keys.get() + current_auth_check_num * CSEC_BYTES, commit_snd->commit_shares0[thread_params->auth_start + i], commit_snd->commit_shares1[thread_params->auth_start + i]);
-          std::copy(commit_snd->commit_shares0[thread_params->auth_start + i], commit_snd->commit_shares0[thread_params->auth_start + i] + CODEWORD_BYTES, cnc_decommit_shares0.get() + current_auth_check_num * CODEWORD_BYTES);
-          std::copy(commit_snd->commit_shares1[thread_params->auth_start + i], commit_snd->commit_shares1[thread_params->auth_start + i] + CODEWORD_BYTES, cnc_decommit_shares1 + current_auth_check_num * CODEWORD_BYTES);
-          if (GetBit(current_auth_check_num, auth_cnc_input)) {
-            XOR_128(cnc_reply_keys.get() + current_auth_check_num * CSEC_BYTES, global_delta);
-            XOR_CodeWords(cnc_decommit_shares0.get() + current_auth_check_num * CODEWORD_BYTES, commit_snd->commit_shares0[thread_params->delta_pos]);
-            XOR_CodeWords(cnc_decommit_shares1 + current_auth_check_num * CODEWORD_BYTES, commit_snd->commit_shares1[thread_params->delta_pos]);
-          }
-          ++current_auth_check_num;
-        } else if (current_eval_auth_num < thread_params->num_eval_auths) {
-          //Populate the array with the correct eval auth indices
-          tmp_auth_eval_ids[thread_params->num_eval_auths * exec_id + current_eval_auth_num] = exec_id * (thread_params->Q + thread_params->A) + thread_params->auth_start + i;
-          ++current_eval_auth_num;
+      //Each check item only depends on its position in the check list, so the loops below have no carried state
+      for (int current_auth_check_num = 0; current_auth_check_num < num_check_auths; ++current_auth_check_num) {
+        uint32_t i = auth_challenge.check_ids[current_auth_check_num];
+        XOR_128(cnc_reply_keys.get() + current_auth_check_num * CSEC_BYTES, commit_snd->commit_shares0[thread_params->auth_start + i], commit_snd->commit_shares1[thread_params->auth_start + i]);
+        std::copy(commit_snd->commit_shares0[thread_params->auth_start + i], commit_snd->commit_shares0[thread_params->auth_start + i] + CODEWORD_BYTES, cnc_decommit_shares0.get() + current_auth_check_num * CODEWORD_BYTES);
+        std::copy(commit_snd->commit_shares1[thread_params->auth_start + i], commit_snd->commit_shares1[thread_params->auth_start + i] + CODEWORD_BYTES, cnc_decommit_shares1 + current_auth_check_num * CODEWORD_BYTES);
+        if (GetBit(current_auth_check_num, auth_cnc_input)) {
+          XOR_128(cnc_reply_keys.get() + current_auth_check_num * CSEC_BYTES, global_delta);
+          XOR_CodeWords(cnc_decommit_shares0.get() + current_auth_check_num * CODEWORD_BYTES, commit_snd->commit_shares0[thread_params->delta_pos]);
+          XOR_CodeWords(cnc_decommit_shares1 + current_auth_check_num * CODEWORD_BYTES, commit_snd->commit_shares1[thread_params->delta_pos]);
         }
       }
 
+      //Populate the array with the correct eval auth indices
+      uint32_t num_filled_eval_auths = std::min((uint64_t) auth_challenge.num_evals, thread_params->num_eval_auths);
+      for (uint32_t current_eval_auth_num = 0; current_eval_auth_num < num_filled_eval_auths; ++current_eval_auth_num) {
+        tmp_auth_eval_ids[thread_params->num_eval_auths * exec_id + current_eval_auth_num] = exec_id * (thread_params->Q + thread_params->A) + thread_params->auth_start + auth_challenge.eval_ids[current_eval_auth_num];
+      }
+
       //Now for the gates
-      int current_check_num = 0;
-      int current_eval_gate_num = 0;
-      for (uint32_t i = 0; i < thread_params->Q; ++i) {
-        if (GetBit(i, cnc_check_gates.get())) {
-
-          //Left
-          XOR_128(cnc_reply_keys.get() + (num_check_auths + current_check_num) * CSEC_BYTES, commit_snd->commit_shares0[thread_params->left_keys_start + i], commit_snd->commit_shares1[thread_params->left_keys_start + i]);
-          std::copy(commit_snd->commit_shares0[thread_params->left_keys_start + i], commit_snd->commit_shares0[thread_params->left_keys_start + i] + CODEWORD_BYTES, cnc_decommit_shares0.get() + (num_check_auths + current_check_num) * CODEWORD_BYTES);
-          std::copy(commit_snd->commit_shares1[thread_params->left_keys_start + i], commit_snd->commit_shares1[thread_params->left_keys_start + i] + CODEWORD_BYTES, cnc_decommit_shares1 + (num_check_auths + current_check_num) * CODEWORD_BYTES);
-
-          //We include the global delta if the left-input is supposed to be 1.
-          if (GetBit(current_check_num, left_cnc_input.get())) {
-            XOR_128(cnc_reply_keys.get() + (num_check_auths + current_check_num) * CSEC_BYTES, global_delta);
-            XOR_CodeWords(cnc_decommit_shares0.get() + (num_check_auths + current_check_num) * CODEWORD_BYTES, commit_snd->commit_shares0[thread_params->delta_pos]);
-            XOR_CodeWords(cnc_decommit_shares1 + (num_check_auths + current_check_num) * CODEWORD_BYTES, commit_snd->commit_shares1[thread_params->delta_pos]);
-          }
+      for (int current_check_num = 0; current_check_num < num_check_gates; ++current_check_num) {
+        uint32_t i = gate_challenge.check_ids[current_check_num];
+
+        //Left
+        XOR_128(cnc_reply_keys.get() + (num_check_auths + current_check_num) * CSEC_BYTES, commit_snd->commit_shares0[thread_params->left_keys_start + i], commit_snd->commit_shares1[thread_params->left_keys_start + i]);
+        std::copy(commit_snd->commit_shares0[thread_params->left_keys_start + i], commit_snd->commit_shares0[thread_params->left_keys_start + i] + CODEWORD_BYTES, cnc_decommit_shares0.get() + (num_check_auths + current_check_num) * CODEWORD_BYTES);
+        std::copy(commit_snd->commit_shares1[thread_params->left_keys_start + i], commit_snd->commit_shares1[thread_params->left_keys_start + i] + CODEWORD_BYTES, cnc_decommit_shares1 + (num_check_auths + current_check_num) * CODEWORD_BYTES);
+
+        //We include the global delta if the left-input is supposed to be 1.
+        if (GetBit(current_check_num, left_cnc_input.get())) {
+          XOR_128(cnc_reply_keys.get() + (num_check_auths + current_check_num) * CSEC_BYTES, global_delta);
+          XOR_CodeWords(cnc_decommit_shares0.get() + (num_check_auths + current_check_num) * CODEWORD_BYTES, commit_snd->commit_shares0[thread_params->delta_pos]);
+          XOR_CodeWords(cnc_decommit_shares1 + (num_check_auths + current_check_num) * CODEWORD_BYTES, commit_snd->commit_shares1[thread_params->delta_pos]);
+        }
 
-          //Right
-          XOR_128(cnc_reply_keys.get() + (num_check_auths + num_check_gates + current_check_num) * CSEC_BYTES, commit_snd->commit_shares0[thread_params->right_keys_start + i], commit_snd->commit_shares1[thread_params->right_keys_start + i]);
-          std::copy(commit_snd->commit_shares0[thread_params->right_keys_start + i], commit_snd->commit_shares0[thread_params->right_keys_start + i] + CODEWORD_BYTES, cnc_decommit_shares0.get() + (num_check_auths + num_check_gates + current_check_num) * CODEWORD_BYTES);
-          std::copy(commit_snd->commit_shares1[thread_params->right_keys_start + i], commit_snd->commit_shares1[thread_params->right_keys_start + i] + CODEWORD_BYTES, cnc_decommit_shares1 + (num_check_auths + num_check_gates + current_check_num) * CODEWORD_BYTES);
+        //Right
+        XOR_128(cnc_reply_keys.get() + (num_check_auths + num_check_gates + current_check_num) * CSEC_BYTES, commit_snd->commit_shares0[thread_params->right_keys_start + i], commit_snd->commit_shares1[thread_params->right_keys_start + i]);
+        std::copy(commit_snd->commit_shares0[thread_params->right_keys_start + i], commit_snd->commit_shares0[thread_params->right_keys_start + i] + CODEWORD_BYTES, cnc_decommit_shares0.get() + (num_check_auths + num_check_gates + current_check_num) * CODEWORD_BYTES);
+        std::copy(commit_snd->commit_shares1[thread_params->right_keys_start + i], commit_snd->commit_shares1[thread_params->right_keys_start + i] + CODEWORD_BYTES, cnc_decommit_shares1 + (num_check_auths + num_check_gates + current_check_num) * CODEWORD_BYTES);
 
-          //We include the global delta if the right-input is supposed to be 1.
-          if (GetBit(current_check_num, right_cnc_input)) {
-            XOR_128(cnc_reply_keys.get() + (num_check_auths + num_check_gates + current_check_num) * CSEC_BYTES, global_delta);
-            XOR_CodeWords(cnc_decommit_shares0.get() + (num_check_auths + num_check_gates + current_check_num) * CODEWORD_BYTES, commit_snd->commit_shares0[thread_params->delta_pos]);
-            XOR_CodeWords(cnc_decommit_shares1 + (num_check_auths + num_check_gates + current_check_num) * CODEWORD_BYTES, commit_snd->commit_shares1[thread_params->delta_pos]);
-          }
+        //We include the global delta if the right-input is supposed to be 1.
+        if (GetBit(current_check_num, right_cnc_input)) {
+          XOR_128(cnc_reply_keys.get() + (num_check_auths + num_check_gates + current_check_num) * CSEC_BYTES, global_delta);
+          XOR_CodeWords(cnc_decommit_shares0.get() + (num_check_auths + num_check_gates + current_check_num) * CODEWORD_BYTES, commit_snd->commit_shares0[thread_params->delta_pos]);
+          XOR_CodeWords(cnc_decommit_shares1 + (num_check_auths + num_check_gates + current_check_num) * CODEWORD_BYTES, commit_snd->commit_shares1[thread_params->delta_pos]);
+        }
 
-          //Out
-          std::copy(commit_snd->commit_shares0[thread_params->out_keys_start + i], commit_snd->commit_shares0[thread_params->out_keys_start + i] + CODEWORD_BYTES, cnc_decommit_shares0.get() + (num_check_auths + 2 * num_check_gates + current_check_num) * CODEWORD_BYTES);
-          std::copy(commit_snd->commit_shares1[thread_params->out_keys_start + i], commit_snd->commit_shares1[thread_params->out_keys_start + i] + CODEWORD_BYTES, cnc_decommit_shares1 + (num_check_auths + 2 * num_check_gates + current_check_num) * CODEWORD_BYTES);
+        //Out
+        std::copy(commit_snd->commit_shares0[thread_params->out_keys_start + i], commit_snd->commit_shares0[thread_params->out_keys_start + i] + CODEWORD_BYTES, cnc_decommit_shares0.get() + (num_check_auths + 2 * num_check_gates + current_check_num) * CODEWORD_BYTES);
+        std::copy(commit_snd->commit_shares1[thread_params->out_keys_start + i], commit_snd->commit_shares1[thread_params->out_keys_start + i] + CODEWORD_BYTES, cnc_decommit_shares1 + (num_check_auths + 2 * num_check_gates + current_check_num) * CODEWORD_BYTES);
 
-          //We include the global delta if the right-input is supposed to be 1.
-          if (GetBit(current_check_num, out_cnc_input)) {
-            XOR_CodeWords(cnc_decommit_shares0.get() + (num_check_auths + 2 * num_check_gates + current_check_num) * CODEWORD_BYTES, commit_snd->commit_shares0[thread_params->delta_pos]);
-            XOR_CodeWords(cnc_decommit_shares1 + (num_check_auths + 2 * num_check_gates + current_check_num) * CODEWORD_BYTES, commit_snd->commit_shares1[thread_params->delta_pos]);
-          }
-          ++current_check_num;
-        }
-        else if (current_eval_gate_num < thread_params->num_eval_gates) {
-          //Populate the array with the correct eval gate indices
-          tmp_gate_eval_ids[thread_params->num_eval_gates * exec_id + current_eval_gate_num] = exec_id * (thread_params->Q + thread_params->A) + thread_params->out_keys_start + i;
-          ++current_eval_gate_num;
+        //We include the global delta if the right-input is supposed to be 1.
+        if (GetBit(current_check_num, out_cnc_input)) {
+          XOR_CodeWords(cnc_decommit_shares0.get() + (num_check_auths + 2 * num_check_gates + current_check_num) * CODEWORD_BYTES, commit_snd->commit_shares0[thread_params->delta_pos]);
+          XOR_CodeWords(cnc_decommit_shares1 + (num_check_auths + 2 * num_check_gates + current_check_num) * CODEWORD_BYTES, commit_snd->commit_shares1[thread_params->delta_pos]);
         }
       }
 
+      //Populate the array with the correct eval gate indices
+      uint32_t num_filled_eval_gates = std::min((uint64_t) gate_challenge.num_evals, thread_params->num_eval_gates);
+      for (uint32_t current_eval_gate_num = 0; current_eval_gate_num < num_filled_eval_gates; ++current_eval_gate_num) {
+        tmp_gate_eval_ids[thread_params->num_eval_gates * exec_id + current_eval_gate_num] = exec_id * (thread_params->Q + thread_params->A) + thread_params->out_keys_start + gate_challenge.eval_ids[current_eval_gate_num];
+      }
+
       //Send all challenge keys
       thread_params->chan.Send(cnc_reply_keys.get(), num_check_keys_sent * CSEC_BYTES);
 
@@ -412,8 +461,8 @@ void TinyConstructor::Preprocess() {
   for (uint32_t i = 0; i < params.num_eval_auths; ++i) {
     permuted_eval_auths_ids[i] = i;
   }
-  PermuteArray(permuted_eval_gates_ids, params.num_eval_gates, bucket_seeds);
-  PermuteArray(permuted_eval_auths_ids, params.num_eval_auths, bucket_seeds + CSEC_BYTES);
+  ParallelPermuteArray(permuted_eval_gates_ids, params.num_eval_gates, bucket_seeds, thread_pool);
+  ParallelPermuteArray(permuted_eval_auths_ids, params.num_eval_auths, bucket_seeds + CSEC_BYTES, thread_pool);
 
   for (uint32_t i = 0; i < params.num_eval_gates; ++i) {
     eval_gates_ids[permuted_eval_gates_ids[i]] = tmp_gate_eval_ids[i];
@@ -440,6 +489,7 @@ void TinyConstructor::Preprocess() {
     Params* thread_params = thread_params_vec[exec_id].get();
 
     pre_soldering_execs_finished[exec_id] = thread_pool.push([this, thread_params, exec_id, inp_from, inp_to, ga_inp_from, ga_inp_to, ga_from, ga_to, &eval_gates_to_blocks, &eval_auths_to_blocks] (int id) {
+      NodePin pin(NumaTopology::Get().NodeOfExec(exec_id, params.num_execs));
 
       int num_gates = thread_params->num_pre_gates;
       int num_inputs = thread_params->num_pre_inputs;
@@ -452,7 +502,7 @@ void TinyConstructor::Preprocess() {
       int num_pre_solderings = 3 * num_gate_solderings + num_auth_solderings + num_inp_auth_solderings;
 
       //Create raw preprocessed solderings data and point into this for convenience
-      std::unique_ptr<uint8_t[]> pre_solderings(std::make_unique<uint8_t[]>(num_pre_solderings * CSEC_BYTES + 3 * CSEC_BYTES + 2 * (num_pre_solderings * CODEWORD_BYTES)));
+      std::unique_ptr<uint8_t[]> pre_solderings(MakeLarge<uint8_t>(num_pre_solderings * CSEC_BYTES + 3 * CSEC_BYTES + 2 * (num_pre_solderings * CODEWORD_BYTES)));
 
       uint8_t* left_wire_solderings = pre_solderings.get();
       uint8_t* right_wire_solderings = left_wire_solderings + CSEC_BYTES * num_gate_solderings;
@@ -703,190 +753,326 @@ void TinyConstructor::Preprocess() {
 #endif
 }
 
-void TinyConstructor::Offline(std::vector<Circuit*>& circuits, int top_num_execs) {
-  // int top_num_execs = std::min((int)circuits.size(), offline_num_execs);
-  std::vector<std::future<void>> top_soldering_execs_finished(top_num_execs);
-  //Split the number of preprocessed gates and inputs into top_num_execs executions
-  std::vector<int> circuits_from, circuits_to;
-  PartitionBufferFixedNum(circuits_from, circuits_to, top_num_execs, circuits.size());
-
-  int num_gates_needed = 0;
-  int num_inp_gates_needed = 0;
-  int num_inps_needed = 0;
-  int num_outs_needed = 0;
-  for (int i = 0; i < circuits.size(); ++i) {
-    gates_offset.emplace_back(num_gates_used + num_gates_needed);
-    inp_gates_offset.emplace_back(num_inputs_used / 2 + num_inp_gates_needed);
-    inputs_offset.emplace_back(num_inputs_used + num_inps_needed);
-    outputs_offset.emplace_back(num_outputs_used + num_outs_needed);
-    num_gates_needed += circuits[i]->num_and_gates;
-    num_inp_gates_needed += circuits[i]->num_const_inp_wires / 2;
-    num_inps_needed += circuits[i]->num_inp_wires;
-    num_outs_needed += circuits[i]->num_out_wires;
+void TinyConstructor::AddExecs(int num_extra_execs) {
+  num_added_execs += num_extra_execs;
+
+  //In background mode there is no active batch before the first Offline, which then adds the execs
+  if (!thread_params_vec.empty()) {
+    CreateExecs(num_extra_execs);
   }
+}
 
-  if ((params.num_pre_gates - num_gates_used) < num_gates_needed) {
-    throw std::runtime_error("Not enough garbled gates");
-  } else {
-    num_gates_used += num_gates_needed;
+void TinyConstructor::CreateExecs(int num_new_execs) {
+  int num_current_execs = thread_params_vec.size();
+  if (num_current_execs + num_new_execs > BATCH_CHAN_STRIDE) {
+    throw std::runtime_error("More execs than channels reserved pr. batch");
   }
 
-  //Due to the way we choose our parameters, if there are enough num_inps, then there are also enough for inp_gates.
-  if ((params.num_pre_inputs - num_inputs_used) < num_inps_needed) {
-    throw std::runtime_error("Not enough input authenticators");
-  } else {
-    num_inputs_used += num_inps_needed;
+  //The new execs continue after the channels of the batch
+  uint32_t first_chan = thread_params_vec[0]->exec_id + num_current_execs;
+  std::unique_ptr<uint8_t[]> extra_thread_seeds(std::make_unique<uint8_t[]>(num_new_execs * CSEC_BYTES));
+  params.rnd.GenRnd(extra_thread_seeds.get(), num_new_execs * CSEC_BYTES);
+  for (int i = 0; i < num_new_execs; ++i) {
+    thread_params_vec.emplace_back(std::make_unique<Params>(params, extra_thread_seeds.get() + i * CSEC_BYTES, thread_params_vec[0]->num_pre_gates, thread_params_vec[0]->num_pre_inputs, thread_params_vec[0]->num_pre_outputs, first_chan + i));
+    commit_snds.emplace_back(std::make_unique<CommitSender>(*thread_params_vec[num_current_execs + i], rot_seeds0.get(), rot_seeds1));
+  }
+}
+
+int TinyConstructor::GetNumQueuedBatches() {
+  std::lock_guard<std::mutex> lock(batches_mutex);
+  return queued_batches.size();
+}
+
+//Whatever is left of the active batch is dropped. The new batch gets the execs added with AddExecs, so callers keep their channels
+void TinyConstructor::ActivateNextBatch() {
+  {
+    std::lock_guard<std::mutex> lock(batches_mutex);
+    SwapBatch(*queued_batches.front());
+    queued_batches.pop_front();
+    ++num_activated;
   }
+  batches_changed.notify_all();
 
-  if ((params.num_pre_outputs - num_outputs_used) < num_outs_needed) {
-    throw std::runtime_error("Not enough output wires");
-  } else {
-    num_outputs_used += num_outs_needed;
+  num_gates_used = 0;
+  num_inputs_used = 0;
+  num_outputs_used = 0;
+
+  int num_missing_execs = params.num_execs + num_added_execs - thread_params_vec.size();
+  if (num_missing_execs > 0) {
+    CreateExecs(num_missing_execs);
   }
+}
 
-  //Setup maps from eval_gates and eval_auths to commit_block and inner block commit index. Needed to construct decommits that span all executions
-  IDMap eval_gates_to_blocks(eval_gates_ids, thread_params_vec[0]->Q + thread_params_vec[0]->A, thread_params_vec[0]->out_keys_start);
-  IDMap eval_auths_to_blocks(eval_auths_ids, thread_params_vec[0]->Q + thread_params_vec[0]->A, thread_params_vec[0]->auth_start);
+void TinyConstructor::CreateProducer(int num_threads) {
+  std::unique_ptr<uint8_t[]> producer_seed(std::make_unique<uint8_t[]>(CSEC_BYTES));
+  params.rnd.GenRnd(producer_seed.get(), CSEC_BYTES);
+  producer_params = std::make_unique<Params>(params, producer_seed.get(), params.num_pre_gates, params.num_pre_inputs, params.num_pre_outputs, PRODUCER_PARAMS_CHAN);
+  producer = std::make_unique<TinyConstructor>(*producer_params);
+  producer->thread_pool.resize(num_threads);
+}
 
-  auto top_soldering_begin = GET_TIME();
-  for (int exec_id = 0; exec_id < top_num_execs; ++exec_id) {
-    int circ_from = circuits_from[exec_id];
-    int circ_to = circuits_to[exec_id];
+void TinyConstructor::ProduceBatch() {
+  if (num_produced == 0) {
+    producer->Setup();
+  }
 
-    Params* thread_params = thread_params_vec[exec_id].get();
+  //The slot of a batch is only reused once it is neither queued nor active any more
+  uint32_t chan_offset = BATCH_CHAN_STRIDE * (1 + num_produced % NUM_BATCH_CHAN_SLOTS);
+  SetBackgroundExecs(chan_offset, true);
+  producer->exec_chan_offset = chan_offset;
+  producer->InitBatch();
+  producer->params.rnd.GenRnd(producer->thread_seeds.get(), CSEC_BYTES * params.num_execs);
+  producer->PreprocessBatch();
+  SetBackgroundExecs(chan_offset, false);
+
+  std::unique_ptr<Batch> batch(std::make_unique<Batch>());
+  producer->SwapBatch(*batch);
+  {
+    std::lock_guard<std::mutex> lock(batches_mutex);
+    if (num_produced == 0) {
+      global_delta = producer->global_delta;
+    }
+    queued_batches.emplace_back(std::move(batch));
+    ++num_produced;
+    ++num_preprocessed;
+  }
+  batches_changed.notify_all();
+}
 
-    top_soldering_execs_finished[exec_id] = thread_pool.push([this, thread_params, exec_id, circ_from, circ_to, &circuits, & eval_gates_to_blocks, &eval_auths_to_blocks] (int id) {
+void TinyConstructor::SavePreprocessed(std::string path) {
+  PreprocessedWriter writer(path);
+  WritePreprocessedHeader(writer);
+  writer.Write(global_delta, CSEC_BYTES);
 
+  SaveBatch(writer);
+  for (std::unique_ptr<Batch>& batch : queued_batches) {
+    SwapBatch(*batch);
+    SaveBatch(writer);
+    SwapBatch(*batch);
+  }
+}
 
-      for (int c = circ_from; c < circ_to; ++c) {
-        Circuit* circuit = circuits[c];
-        int gate_offset = gates_offset[c];
-        int inp_gate_offset = inp_gates_offset[c];
-        int inp_offset = inputs_offset[c];
+void TinyConstructor::LoadPreprocessed(std::string path) {
+  PreprocessedReader reader(path);
+  int num_batches = ReadPreprocessedHeader(reader);
+  reader.Read(ot_snd.delta_outer.get(), CSEC_BYTES);
+  global_delta = ot_snd.delta_outer.get();
 
-        int num_top_solderings = 2 * circuit->num_and_gates + circuit->num_const_inp_wires; //the 2* factor cancels out as we can check two inputs pr. input bucket.
+  //Load every batch into the queue and then make the first one active
+  for (int b = 0; b < num_batches; ++b) {
+    InitBatch();
+    LoadBatch(reader);
+    queued_batches.emplace_back(std::make_unique<Batch>());
+    SwapBatch(*queued_batches.back());
+  }
+  SwapBatch(*queued_batches.front());
+  queued_batches.pop_front();
+  num_preprocessed = num_batches;
+}
 
-        std::unique_ptr<uint8_t[]> topological_solderings(std::make_unique<uint8_t[]>(num_top_solderings * (CSEC_BYTES + 2 * CODEWORD_BYTES) + circuit->num_wires * (2 * CODEWORD_BYTES + CSEC_BYTES)));
-        uint8_t* topsolder_decommit_shares0 = topological_solderings.get() + num_top_solderings * CSEC_BYTES;
-        uint8_t* topsolder_decommit_shares1 = topsolder_decommit_shares0 + num_top_solderings * CODEWORD_BYTES;
-        uint8_t* decommit_shares_tmp0 = topsolder_decommit_shares1 + num_top_solderings * CODEWORD_BYTES;
-        uint8_t* decommit_shares_tmp1 = decommit_shares_tmp0 + circuit->num_wires * CODEWORD_BYTES;
-        uint8_t* values = decommit_shares_tmp1 + circuit->num_wires * CODEWORD_BYTES;
+void TinyConstructor::SaveBatch(PreprocessedWriter& writer) {
+  WriteThreadParams(writer);
+  writer.Write(rot_seeds0.get(), 2 * CODEWORD_BITS * CSEC_BYTES);
+  writer.WriteAligned(raw_eval_ids.get(), (params.num_eval_gates + params.num_eval_auths) * sizeof(uint32_t));
 
-        int curr_auth_inp_head_pos, curr_inp_head_block, curr_inp_head_idx, curr_head_pos, curr_head_block, curr_head_idx;
+  for (int exec_id = 0; exec_id < params.num_execs; ++exec_id) {
+    writer.WriteBlocks(commit_snds[exec_id]->matrices0, commit_snds[exec_id]->num_blocks, commit_snds[exec_id]->transpose_matrix_size);
+    writer.WriteBlocks(commit_snds[exec_id]->matrices1, commit_snds[exec_id]->num_blocks, commit_snds[exec_id]->transpose_matrix_size);
+  }
+  for (int exec_id = 0; exec_id < params.num_execs; ++exec_id) {
+    writer.WriteShares(commit_snds[exec_id]->commit_shares0);
+    writer.WriteShares(commit_snds[exec_id]->commit_shares1);
+  }
+}
 
+void TinyConstructor::LoadBatch(PreprocessedReader& reader) {
+  ReadThreadParams(reader);
+  reader.Read(rot_seeds0.get(), 2 * CODEWORD_BITS * CSEC_BYTES);
+  uint64_t ids_bytes = (params.num_eval_gates + params.num_eval_auths) * sizeof(uint32_t);
+  uint8_t* ids = reader.ReadAligned(ids_bytes);
+  std::copy(ids, ids + ids_bytes, (uint8_t*) raw_eval_ids.get());
+
+  for (int exec_id = 0; exec_id < (int) thread_params_vec.size(); ++exec_id) {
+    commit_snds.emplace_back(std::make_unique<CommitSender>(*thread_params_vec[exec_id], rot_seeds0.get(), rot_seeds1));
+    reader.SkipBlocks();
+    reader.SkipBlocks();
+  }
+  for (std::unique_ptr<CommitSender>& commit_snd : commit_snds) {
+    reader.ReadShares(commit_snd->commit_shares0);
+    reader.ReadShares(commit_snd->commit_shares1);
+    commit_snd->num_commits_produced = commit_snd->commit_shares0.size();
+  }
+  mapping = reader.mapping;
+}
 
-        for (int i = 0; i < circuit->num_inp_wires; ++i) {
-          curr_auth_inp_head_pos = params.num_pre_gates * thread_params->num_auth + (inp_offset + i) * thread_params->num_inp_auth;
-          eval_auths_to_blocks.GetExecIDAndIndex(curr_auth_inp_head_pos, curr_inp_head_block, curr_inp_head_idx);
+//Sends the topological solderings of circuit c and decommits them
+void TinyConstructor::SolderCircuit(Params* thread_params, int exec_id, int c, std::vector<Circuit*>& circuits, IDMap& eval_gates_to_blocks, IDMap& eval_auths_to_blocks) {
+  Circuit* circuit = circuits[c];
+  int gate_offset = gates_offset[c];
+  int inp_gate_offset = inp_gates_offset[c];
+  int inp_offset = inputs_offset[c];
 
-          std::copy(commit_snds[curr_inp_head_block]->commit_shares0[thread_params->auth_start + curr_inp_head_idx], commit_snds[curr_inp_head_block]->commit_shares0[thread_params->auth_start + curr_inp_head_idx] + CSEC_BYTES, values + i * CSEC_BYTES);
-          XOR_128(values + i * CSEC_BYTES, commit_snds[curr_inp_head_block]->commit_shares1[thread_params->auth_start + curr_inp_head_idx]);
+  int num_top_solderings = 2 * circuit->num_and_gates + circuit->num_const_inp_wires; //the 2* factor cancels out as we can check two inputs pr. input bucket.
 
-          //Build decommit_info
-          std::copy(commit_snds[curr_inp_head_block]->commit_shares0[thread_params->auth_start + curr_inp_head_idx], commit_snds[curr_inp_head_block]->commit_shares0[thread_params->auth_start + curr_inp_head_idx] + CODEWORD_BYTES, decommit_shares_tmp0 + i * CODEWORD_BYTES);
-          std::copy(commit_snds[curr_inp_head_block]->commit_shares1[thread_params->auth_start + curr_inp_head_idx], commit_snds[curr_inp_head_block]->commit_shares1[thread_params->auth_start + curr_inp_head_idx] + CODEWORD_BYTES, decommit_shares_tmp1 + i * CODEWORD_BYTES);
-        }
+  ExecArena* arena = exec_arenas[exec_id].get();
+  arena->Reset();
+  uint8_t* topological_solderings = arena->Alloc<uint8_t>(num_top_solderings * (CSEC_BYTES + 2 * CODEWORD_BYTES) + circuit->num_wires * (2 * CODEWORD_BYTES + CSEC_BYTES));
+  uint8_t* topsolder_decommit_shares0 = topological_solderings + num_top_solderings * CSEC_BYTES;
+  uint8_t* topsolder_decommit_shares1 = topsolder_decommit_shares0 + num_top_solderings * CODEWORD_BYTES;
+  uint8_t* decommit_shares_tmp0 = topsolder_decommit_shares1 + num_top_solderings * CODEWORD_BYTES;
+  uint8_t* decommit_shares_tmp1 = decommit_shares_tmp0 + circuit->num_wires * CODEWORD_BYTES;
+  uint8_t* values = decommit_shares_tmp1 + circuit->num_wires * CODEWORD_BYTES;
 
-        int left_inp_start = circuit->num_and_gates;
-        int right_inp_start = 2 * circuit->num_and_gates + circuit->num_const_inp_wires / 2;
-        for (int i = 0; i < circuit->num_const_inp_wires / 2; ++i) {
-          curr_head_pos = params.num_pre_gates * params.num_bucket + (inp_gate_offset + i) * params.num_inp_bucket;
-          eval_gates_to_blocks.GetExecIDAndIndex(curr_head_pos, curr_head_block, curr_head_idx);
+  int curr_auth_inp_head_pos, curr_inp_head_block, curr_inp_head_idx, curr_head_pos, curr_head_block, curr_head_idx;
 
-          //Left
-          XOR_128(topological_solderings.get() + (left_inp_start + i) * CSEC_BYTES, commit_snds[curr_head_block]->commit_shares0[thread_params->left_keys_start + curr_head_idx], commit_snds[curr_head_block]->commit_shares1[thread_params->left_keys_start + curr_head_idx]);
 
-          XOR_128(topological_solderings.get() + (left_inp_start + i) * CSEC_BYTES, values + i * CSEC_BYTES);
+  for (int i = 0; i < (int) circuit->num_inp_wires; ++i) {
+    curr_auth_inp_head_pos = params.num_pre_gates * thread_params->num_auth + (inp_offset + i) * thread_params->num_inp_auth;
+    eval_auths_to_blocks.GetExecIDAndIndex(curr_auth_inp_head_pos, curr_inp_head_block, curr_inp_head_idx);
 
-          std::copy(commit_snds[curr_head_block]->commit_shares0[thread_params->left_keys_start + curr_head_idx], commit_snds[curr_head_block]->commit_shares0[thread_params->left_keys_start + curr_head_idx] + CODEWORD_BYTES, topsolder_decommit_shares0 + (left_inp_start + i) * CODEWORD_BYTES);
-          XOR_CodeWords(topsolder_decommit_shares0 + (left_inp_start + i) * CODEWORD_BYTES, decommit_shares_tmp0 + i * CODEWORD_BYTES);
+    std::copy(commit_snds[curr_inp_head_block]->commit_shares0[thread_params->auth_start + curr_inp_head_idx], commit_snds[curr_inp_head_block]->commit_shares0[thread_params->auth_start + curr_inp_head_idx] + CSEC_BYTES, values + i * CSEC_BYTES);
+    XOR_128(values + i * CSEC_BYTES, commit_snds[curr_inp_head_block]->commit_shares1[thread_params->auth_start + curr_inp_head_idx]);
 
-          std::copy(commit_snds[curr_head_block]->commit_shares1[thread_params->left_keys_start + curr_head_idx], commit_snds[curr_head_block]->commit_shares1[thread_params->left_keys_start + curr_head_idx] + CODEWORD_BYTES, topsolder_decommit_shares1 + (left_inp_start + i) * CODEWORD_BYTES);
-          XOR_CodeWords(topsolder_decommit_shares1 + (left_inp_start + i) * CODEWORD_BYTES, decommit_shares_tmp1 + i * CODEWORD_BYTES);
+    //Build decommit_info
+    std::copy(commit_snds[curr_inp_head_block]->commit_shares0[thread_params->auth_start + curr_inp_head_idx], commit_snds[curr_inp_head_block]->commit_shares0[thread_params->auth_start + curr_inp_head_idx] + CODEWORD_BYTES, decommit_shares_tmp0 + i * CODEWORD_BYTES);
+    std::copy(commit_snds[curr_inp_head_block]->commit_shares1[thread_params->auth_start + curr_inp_head_idx], commit_snds[curr_inp_head_block]->commit_shares1[thread_params->auth_start + curr_inp_head_idx] + CODEWORD_BYTES, decommit_shares_tmp1 + i * CODEWORD_BYTES);
+  }
 
-          //Right
-          XOR_128(topological_solderings.get() + (right_inp_start + i) * CSEC_BYTES, commit_snds[curr_head_block]->commit_shares0[thread_params->right_keys_start + curr_head_idx], commit_snds[curr_head_block]->commit_shares1[thread_params->right_keys_start + curr_head_idx]);
+  int left_inp_start = circuit->num_and_gates;
+  int right_inp_start = 2 * circuit->num_and_gates + circuit->num_const_inp_wires / 2;
+  for (int i = 0; i < (int) circuit->num_const_inp_wires / 2; ++i) {
+    curr_head_pos = params.num_pre_gates * params.num_bucket + (inp_gate_offset + i) * params.num_inp_bucket;
+    eval_gates_to_blocks.GetExecIDAndIndex(curr_head_pos, curr_head_block, curr_head_idx);
 
-          XOR_128(topological_solderings.get() + (right_inp_start + i) * CSEC_BYTES, values + (circuit->num_const_inp_wires / 2 + i) * CSEC_BYTES);
+    //Left
+    XOR_128(topological_solderings + (left_inp_start + i) * CSEC_BYTES, commit_snds[curr_head_block]->commit_shares0[thread_params->left_keys_start + curr_head_idx], commit_snds[curr_head_block]->commit_shares1[thread_params->left_keys_start + curr_head_idx]);
 
-          std::copy(commit_snds[curr_head_block]->commit_shares0[thread_params->right_keys_start + curr_head_idx], commit_snds[curr_head_block]->commit_shares0[thread_params->right_keys_start + curr_head_idx] + CODEWORD_BYTES, topsolder_decommit_shares0 + (right_inp_start + i) * CODEWORD_BYTES);
-          XOR_CodeWords(topsolder_decommit_shares0 + (right_inp_start + i) * CODEWORD_BYTES, decommit_shares_tmp0 + (circuit->num_const_inp_wires / 2 + i) * CODEWORD_BYTES);
+    XOR_128(topological_solderings + (left_inp_start + i) * CSEC_BYTES, values + i * CSEC_BYTES);
 
-          std::copy(commit_snds[curr_head_block]->commit_shares1[thread_params->right_keys_start + curr_head_idx], commit_snds[curr_head_block]->commit_shares1[thread_params->right_keys_start + curr_head_idx] + CODEWORD_BYTES, topsolder_decommit_shares1 + (right_inp_start + i) * CODEWORD_BYTES);
-          XOR_CodeWords(topsolder_decommit_shares1 + (right_inp_start + i) * CODEWORD_BYTES, decommit_shares_tmp1 + (circuit->num_const_inp_wires / 2 + i) * CODEWORD_BYTES);
-        }
+    std::copy(commit_snds[curr_head_block]->commit_shares0[thread_params->left_keys_start + curr_head_idx], commit_snds[curr_head_block]->commit_shares0[thread_params->left_keys_start + curr_head_idx] + CODEWORD_BYTES, topsolder_decommit_shares0 + (left_inp_start + i) * CODEWORD_BYTES);
+    XOR_CodeWords(topsolder_decommit_shares0 + (left_inp_start + i) * CODEWORD_BYTES, decommit_shares_tmp0 + i * CODEWORD_BYTES);
 
-        int curr_and_gate = 0;
-        int left_gate_start = 0;
-        int right_gate_start = circuit->num_and_gates + circuit->num_const_inp_wires / 2;
-        for (int i = 0; i < circuit->num_gates; ++i) {
-          Gate g = circuit->gates[i];
-          if (g.type == NOT) {
-            std::copy(values + g.left_wire * CSEC_BYTES, values + g.left_wire * CSEC_BYTES + CSEC_BYTES, values + g.out_wire * CSEC_BYTES);
-            XOR_128(values + g.out_wire * CSEC_BYTES, commit_snds[0]->commit_shares0[thread_params->delta_pos]);
-            XOR_128(values + g.out_wire * CSEC_BYTES, commit_snds[0]->commit_shares1[thread_params->delta_pos]);
+    std::copy(commit_snds[curr_head_block]->commit_shares1[thread_params->left_keys_start + curr_head_idx], commit_snds[curr_head_block]->commit_shares1[thread_params->left_keys_start + curr_head_idx] + CODEWORD_BYTES, topsolder_decommit_shares1 + (left_inp_start + i) * CODEWORD_BYTES);
+    XOR_CodeWords(topsolder_decommit_shares1 + (left_inp_start + i) * CODEWORD_BYTES, decommit_shares_tmp1 + i * CODEWORD_BYTES);
 
-            //Build decommit_info
-            std::copy(decommit_shares_tmp0 + g.left_wire * CODEWORD_BYTES, decommit_shares_tmp0 + g.left_wire * CODEWORD_BYTES + CODEWORD_BYTES, decommit_shares_tmp0 + g.out_wire * CODEWORD_BYTES);
-            std::copy(decommit_shares_tmp1 + g.left_wire * CODEWORD_BYTES, decommit_shares_tmp1 + g.left_wire * CODEWORD_BYTES + CODEWORD_BYTES, decommit_shares_tmp1 + g.out_wire * CODEWORD_BYTES);
+    //Right
+    XOR_128(topological_solderings + (right_inp_start + i) * CSEC_BYTES, commit_snds[curr_head_block]->commit_shares0[thread_params->right_keys_start + curr_head_idx], commit_snds[curr_head_block]->commit_shares1[thread_params->right_keys_start + curr_head_idx]);
 
-            XOR_CodeWords(decommit_shares_tmp0 + g.out_wire * CODEWORD_BYTES, commit_snds[0]->commit_shares0[thread_params->delta_pos]);
-            XOR_CodeWords(decommit_shares_tmp1 + g.out_wire * CODEWORD_BYTES, commit_snds[0]->commit_shares1[thread_params->delta_pos]);
+    XOR_128(topological_solderings + (right_inp_start + i) * CSEC_BYTES, values + (circuit->num_const_inp_wires / 2 + i) * CSEC_BYTES);
 
-          } else if (g.type == XOR) {
-            std::copy(values + g.left_wire * CSEC_BYTES, values + g.left_wire * CSEC_BYTES + CSEC_BYTES, values + g.out_wire * CSEC_BYTES);
-            XOR_128(values + g.out_wire * CSEC_BYTES, values + g.right_wire * CSEC_BYTES);
+    std::copy(commit_snds[curr_head_block]->commit_shares0[thread_params->right_keys_start + curr_head_idx], commit_snds[curr_head_block]->commit_shares0[thread_params->right_keys_start + curr_head_idx] + CODEWORD_BYTES, topsolder_decommit_shares0 + (right_inp_start + i) * CODEWORD_BYTES);
+    XOR_CodeWords(topsolder_decommit_shares0 + (right_inp_start + i) * CODEWORD_BYTES, decommit_shares_tmp0 + (circuit->num_const_inp_wires / 2 + i) * CODEWORD_BYTES);
 
-            //Build decommit_info
-            std::copy(decommit_shares_tmp0 + g.left_wire * CODEWORD_BYTES, decommit_shares_tmp0 + g.left_wire * CODEWORD_BYTES + CODEWORD_BYTES, decommit_shares_tmp0 + g.out_wire * CODEWORD_BYTES);
-            std::copy(decommit_shares_tmp1 + g.left_wire * CODEWORD_BYTES, decommit_shares_tmp1 + g.left_wire * CODEWORD_BYTES + CODEWORD_BYTES, decommit_shares_tmp1 + g.out_wire * CODEWORD_BYTES);
+    std::copy(commit_snds[curr_head_block]->commit_shares1[thread_params->right_keys_start + curr_head_idx], commit_snds[curr_head_block]->commit_shares1[thread_params->right_keys_start + curr_head_idx] + CODEWORD_BYTES, topsolder_decommit_shares1 + (right_inp_start + i) * CODEWORD_BYTES);
+    XOR_CodeWords(topsolder_decommit_shares1 + (right_inp_start + i) * CODEWORD_BYTES, decommit_shares_tmp1 + (circuit->num_const_inp_wires / 2 + i) * CODEWORD_BYTES);
+  }
 
-            XOR_CodeWords(decommit_shares_tmp0 + g.out_wire * CODEWORD_BYTES, decommit_shares_tmp0 + g.right_wire * CODEWORD_BYTES);
-            XOR_CodeWords(decommit_shares_tmp1 + g.out_wire * CODEWORD_BYTES, decommit_shares_tmp1 + g.right_wire * CODEWORD_BYTES);
+  int curr_and_gate = 0;
+  int left_gate_start = 0;
+  int right_gate_start = circuit->num_and_gates + circuit->num_const_inp_wires / 2;
+  for (int i = 0; i < (int) circuit->num_gates; ++i) {
+    Gate g = circuit->gates[i];
+    if (g.type == NOT) {
+      std::copy(values + g.left_wire * CSEC_BYTES, values + g.left_wire * CSEC_BYTES + CSEC_BYTES, values + g.out_wire * CSEC_BYTES);
+      XOR_128(values + g.out_wire * CSEC_BYTES, commit_snds[0]->commit_shares0[thread_params->delta_pos]);
+      XOR_128(values + g.out_wire * CSEC_BYTES, commit_snds[0]->commit_shares1[thread_params->delta_pos]);
 
-          } else if (g.type == AND) {
-            curr_head_pos = (gate_offset + curr_and_gate) * thread_params->num_bucket;
-            eval_gates_to_blocks.GetExecIDAndIndex(curr_head_pos, curr_head_block, curr_head_idx);
-            XOR_128(values + g.out_wire * CSEC_BYTES, commit_snds[curr_head_block]->commit_shares0[thread_params->out_keys_start + curr_head_idx], commit_snds[curr_head_block]->commit_shares1[thread_params->out_keys_start + curr_head_idx]);
+      //Build decommit_info
+      std::copy(decommit_shares_tmp0 + g.left_wire * CODEWORD_BYTES, decommit_shares_tmp0 + g.left_wire * CODEWORD_BYTES + CODEWORD_BYTES, decommit_shares_tmp0 + g.out_wire * CODEWORD_BYTES);
+      std::copy(decommit_shares_tmp1 + g.left_wire * CODEWORD_BYTES, decommit_shares_tmp1 + g.left_wire * CODEWORD_BYTES + CODEWORD_BYTES, decommit_shares_tmp1 + g.out_wire * CODEWORD_BYTES);
 
-            XOR_128(topological_solderings.get() + (left_gate_start + curr_and_gate) * CSEC_BYTES, commit_snds[curr_head_block]->commit_shares0[thread_params->left_keys_start + curr_head_idx], commit_snds[curr_head_block]->commit_shares1[thread_params->left_keys_start + curr_head_idx]);
+      XOR_CodeWords(decommit_shares_tmp0 + g.out_wire * CODEWORD_BYTES, commit_snds[0]->commit_shares0[thread_params->delta_pos]);
+      XOR_CodeWords(decommit_shares_tmp1 + g.out_wire * CODEWORD_BYTES, commit_snds[0]->commit_shares1[thread_params->delta_pos]);
 
-            XOR_128(topological_solderings.get() + (right_gate_start + curr_and_gate) * CSEC_BYTES, commit_snds[curr_head_block]->commit_shares0[thread_params->right_keys_start + curr_head_idx], commit_snds[curr_head_block]->commit_shares1[thread_params->right_keys_start + curr_head_idx]);
+    } else if (g.type == XOR) {
+      std::copy(values + g.left_wire * CSEC_BYTES, values + g.left_wire * CSEC_BYTES + CSEC_BYTES, values + g.out_wire * CSEC_BYTES);
+      XOR_128(values + g.out_wire * CSEC_BYTES, values + g.right_wire * CSEC_BYTES);
 
-            XOR_128(topological_solderings.get() + (left_gate_start + curr_and_gate) * CSEC_BYTES, values + g.left_wire * CSEC_BYTES);
-            XOR_128(topological_solderings.get() + (right_gate_start + curr_and_gate) * CSEC_BYTES, values + g.right_wire * CSEC_BYTES);
+      //Build decommit_info
+      std::copy(decommit_shares_tmp0 + g.left_wire * CODEWORD_BYTES, decommit_shares_tmp0 + g.left_wire * CODEWORD_BYTES + CODEWORD_BYTES, decommit_shares_tmp0 + g.out_wire * CODEWORD_BYTES);
+      std::copy(decommit_shares_tmp1 + g.left_wire * CODEWORD_BYTES, decommit_shares_tmp1 + g.left_wire * CODEWORD_BYTES + CODEWORD_BYTES, decommit_shares_tmp1 + g.out_wire * CODEWORD_BYTES);
 
-            //Build decommit_info
-            std::copy(commit_snds[curr_head_block]->commit_shares0[thread_params->out_keys_start + curr_head_idx], commit_snds[curr_head_block]->commit_shares0[thread_params->out_keys_start + curr_head_idx] + CODEWORD_BYTES, decommit_shares_tmp0 + g.out_wire * CODEWORD_BYTES);
-            std::copy(commit_snds[curr_head_block]->commit_shares1[thread_params->out_keys_start + curr_head_idx], commit_snds[curr_head_block]->commit_shares1[thread_params->out_keys_start + curr_head_idx] + CODEWORD_BYTES, decommit_shares_tmp1 + g.out_wire * CODEWORD_BYTES);
+      XOR_CodeWords(decommit_shares_tmp0 + g.out_wire * CODEWORD_BYTES, decommit_shares_tmp0 + g.right_wire * CODEWORD_BYTES);
+      XOR_CodeWords(decommit_shares_tmp1 + g.out_wire * CODEWORD_BYTES, decommit_shares_tmp1 + g.right_wire * CODEWORD_BYTES);
 
-            std::copy(commit_snds[curr_head_block]->commit_shares0[thread_params->left_keys_start + curr_head_idx], commit_snds[curr_head_block]->commit_shares0[thread_params->left_keys_start + curr_head_idx] + CODEWORD_BYTES, topsolder_decommit_shares0 + (left_gate_start + curr_and_gate) * CODEWORD_BYTES);
-            std::copy(commit_snds[curr_head_block]->commit_shares1[thread_params->left_keys_start + curr_head_idx], commit_snds[curr_head_block]->commit_shares1[thread_params->left_keys_start + curr_head_idx] + CODEWORD_BYTES, topsolder_decommit_shares1 + (left_gate_start + curr_and_gate) * CODEWORD_BYTES);
+    } else if (g.type == AND) {
+      curr_head_pos = (gate_offset + curr_and_gate) * thread_params->num_bucket;
+      eval_gates_to_blocks.GetExecIDAndIndex(curr_head_pos, curr_head_block, curr_head_idx);
+      XOR_128(values + g.out_wire * CSEC_BYTES, commit_snds[curr_head_block]->commit_shares0[thread_params->out_keys_start + curr_head_idx], commit_snds[curr_head_block]->commit_shares1[thread_params->out_keys_start + curr_head_idx]);
 
-            std::copy(commit_snds[curr_head_block]->commit_shares0[thread_params->right_keys_start + curr_head_idx], commit_snds[curr_head_block]->commit_shares0[thread_params->right_keys_start + curr_head_idx] + CODEWORD_BYTES, topsolder_decommit_shares0 + (right_gate_start + curr_and_gate) * CODEWORD_BYTES);
-            std::copy(commit_snds[curr_head_block]->commit_shares1[thread_params->right_keys_start + curr_head_idx], commit_snds[curr_head_block]->commit_shares1[thread_params->right_keys_start + curr_head_idx] + CODEWORD_BYTES, topsolder_decommit_shares1 + (right_gate_start + curr_and_gate) * CODEWORD_BYTES);
+      XOR_128(topological_solderings + (left_gate_start + curr_and_gate) * CSEC_BYTES, commit_snds[curr_head_block]->commit_shares0[thread_params->left_keys_start + curr_head_idx], commit_snds[curr_head_block]->commit_shares1[thread_params->left_keys_start + curr_head_idx]);
 
-            XOR_CodeWords(topsolder_decommit_shares0 + (left_gate_start + curr_and_gate) * CODEWORD_BYTES, decommit_shares_tmp0 + g.left_wire * CODEWORD_BYTES);
-            XOR_CodeWords(topsolder_decommit_shares1 + (left_gate_start + curr_and_gate) * CODEWORD_BYTES, decommit_shares_tmp1 + g.left_wire * CODEWORD_BYTES);
+      XOR_128(topological_solderings + (right_gate_start + curr_and_gate) * CSEC_BYTES, commit_snds[curr_head_block]->commit_shares0[thread_params->right_keys_start + curr_head_idx], commit_snds[curr_head_block]->commit_shares1[thread_params->right_keys_start + curr_head_idx]);
 
-            XOR_CodeWords(topsolder_decommit_shares0 + (right_gate_start + curr_and_gate) * CODEWORD_BYTES, decommit_shares_tmp0 + g.right_wire * CODEWORD_BYTES);
-            XOR_CodeWords(topsolder_decommit_shares1 + (right_gate_start + curr_and_gate) * CODEWORD_BYTES, decommit_shares_tmp1 + g.right_wire * CODEWORD_BYTES);
+      XOR_128(topological_solderings + (left_gate_start + curr_and_gate) * CSEC_BYTES, values + g.left_wire * CSEC_BYTES);
+      XOR_128(topological_solderings + (right_gate_start + curr_and_gate) * CSEC_BYTES, values + g.right_wire * CSEC_BYTES);
 
-            ++curr_and_gate;
-          }
-        }
+      //Build decommit_info
+      std::copy(commit_snds[curr_head_block]->commit_shares0[thread_params->out_keys_start + curr_head_idx], commit_snds[curr_head_block]->commit_shares0[thread_params->out_keys_start + curr_head_idx] + CODEWORD_BYTES, decommit_shares_tmp0 + g.out_wire * CODEWORD_BYTES);
+      std::copy(commit_snds[curr_head_block]->commit_shares1[thread_params->out_keys_start + curr_head_idx], commit_snds[curr_head_block]->commit_shares1[thread_params->out_keys_start + curr_head_idx] + CODEWORD_BYTES, decommit_shares_tmp1 + g.out_wire * CODEWORD_BYTES);
+
+      std::copy(commit_snds[curr_head_block]->commit_shares0[thread_params->left_keys_start + curr_head_idx], commit_snds[curr_head_block]->commit_shares0[thread_params->left_keys_start + curr_head_idx] + CODEWORD_BYTES, topsolder_decommit_shares0 + (left_gate_start + curr_and_gate) * CODEWORD_BYTES);
+      std::copy(commit_snds[curr_head_block]->commit_shares1[thread_params->left_keys_start + curr_head_idx], commit_snds[curr_head_block]->commit_shares1[thread_params->left_keys_start + curr_head_idx] + CODEWORD_BYTES, topsolder_decommit_shares1 + (left_gate_start + curr_and_gate) * CODEWORD_BYTES);
+
+      std::copy(commit_snds[curr_head_block]->commit_shares0[thread_params->right_keys_start + curr_head_idx], commit_snds[curr_head_block]->commit_shares0[thread_params->right_keys_start + curr_head_idx] + CODEWORD_BYTES, topsolder_decommit_shares0 + (right_gate_start + curr_and_gate) * CODEWORD_BYTES);
+      std::copy(commit_snds[curr_head_block]->commit_shares1[thread_params->right_keys_start + curr_head_idx], commit_snds[curr_head_block]->commit_shares1[thread_params->right_keys_start + curr_head_idx] + CODEWORD_BYTES, topsolder_decommit_shares1 + (right_gate_start + curr_and_gate) * CODEWORD_BYTES);
 
-        thread_params->chan.Send(topological_solderings.get(), num_top_solderings * CSEC_BYTES);
+      XOR_CodeWords(topsolder_decommit_shares0 + (left_gate_start + curr_and_gate) * CODEWORD_BYTES, decommit_shares_tmp0 + g.left_wire * CODEWORD_BYTES);
+      XOR_CodeWords(topsolder_decommit_shares1 + (left_gate_start + curr_and_gate) * CODEWORD_BYTES, decommit_shares_tmp1 + g.left_wire * CODEWORD_BYTES);
 
-        commit_snds[exec_id]->BatchDecommit(topsolder_decommit_shares0, topsolder_decommit_shares1, num_top_solderings);
+      XOR_CodeWords(topsolder_decommit_shares0 + (right_gate_start + curr_and_gate) * CODEWORD_BYTES, decommit_shares_tmp0 + g.right_wire * CODEWORD_BYTES);
+      XOR_CodeWords(topsolder_decommit_shares1 + (right_gate_start + curr_and_gate) * CODEWORD_BYTES, decommit_shares_tmp1 + g.right_wire * CODEWORD_BYTES);
+
+      ++curr_and_gate;
+    }
+  }
+
+  thread_params->chan.Send(topological_solderings, num_top_solderings * CSEC_BYTES);
+
+  commit_snds[exec_id]->BatchDecommit(topsolder_decommit_shares0, topsolder_decommit_shares1, num_top_solderings);
+}
+
+uint64_t TinyConstructor::SolderScratchBytes(Circuit* circuit) {
+  uint64_t num_top_solderings = 2 * circuit->num_and_gates + circuit->num_const_inp_wires;
+  return ExecArena::SliceBytes(num_top_solderings * (CSEC_BYTES + 2 * CODEWORD_BYTES) + circuit->num_wires * (2 * CODEWORD_BYTES + CSEC_BYTES));
+}
+
+void TinyConstructor::Offline(std::vector<Circuit*>& circuits, int top_num_execs) {
+  ReserveCircuits(circuits);
+
+  std::vector<int> circuits_from, circuits_to;
+  int num_tasks = SplitCircuits(circuits, top_num_execs, circuits_from, circuits_to);
+  EnsureExecs(num_tasks);
+  std::vector<std::future<void>> top_soldering_execs_finished(num_tasks);
+
+  //Setup maps from eval_gates and eval_auths to commit_block and inner block commit index. Needed to construct decommits that span all executions
+  IDMap eval_gates_to_blocks(eval_gates_ids, thread_params_vec[0]->Q + thread_params_vec[0]->A, thread_params_vec[0]->out_keys_start);
+  IDMap eval_auths_to_blocks(eval_auths_ids, thread_params_vec[0]->Q + thread_params_vec[0]->A, thread_params_vec[0]->auth_start);
+
+  auto top_soldering_begin = GET_TIME();
+  for (int exec_id = 0; exec_id < num_tasks; ++exec_id) {
+    int circ_from = circuits_from[exec_id];
+    int circ_to = circuits_to[exec_id];
+
+    Params* thread_params = thread_params_vec[exec_id].get();
+
+    top_soldering_execs_finished[exec_id] = thread_pool.push([this, thread_params, exec_id, num_tasks, circ_from, circ_to, &circuits, & eval_gates_to_blocks, &eval_auths_to_blocks] (int id) {
+      NodePin pin(NumaTopology::Get().NodeOfExec(exec_id, num_tasks));
+      ReserveSolderArena(exec_id, circuits, circ_from, circ_to);
+
+      for (int c = circ_from; c < circ_to; ++c) {
+        SolderCircuit(thread_params, exec_id, c, circuits, eval_gates_to_blocks, eval_auths_to_blocks);
       }
     });
   }
 
+  //All execs have to finish before a failure in one of them is passed on, as they use the maps above
   for (std::future<void>& r : top_soldering_execs_finished) {
     r.wait();
   }
+  for (std::future<void>& r : top_soldering_execs_finished) {
+    r.get();
+  }
 
   auto top_soldering_end = GET_TIME();
 #ifdef TINY_PRINT
@@ -894,126 +1080,223 @@ void TinyConstructor::Offline(std::vector<Circuit*>& circuits, int top_num_execs
 #endif
 }
 
-void TinyConstructor::Online(std::vector<Circuit*>& circuits, std::vector<uint8_t*>& inputs, int eval_num_execs) {
+//Circuits are handled ONLINE_BATCH_SIZE at a time. The evaluator sends e for the whole batch in one message and all input keys and decommits of the batch are returned in one reply, so the number of round trips does not grow with the number of circuits in a batch
+void TinyConstructor::OnlineBatch(Params* thread_params, int exec_id, int batch_from, int batch_to, std::vector<Circuit*>& circuits, std::vector<uint8_t*>& inputs, IDMap& eval_gates_to_blocks, IDMap& eval_auths_to_blocks) {
+  Circuit* circuit;
+  uint8_t* input;
+  uint8_t* const_inp_keys;
+  uint8_t* decommit_shares_inp_0;
+  uint8_t* decommit_shares_inp_1;
+  uint8_t* decommit_shares_out_0;
+  uint8_t* decommit_shares_out_1;
+  uint8_t* e;
+
+  int gate_offset, inp_offset, out_offset;
+  int curr_auth_inp_head_pos, curr_inp_head_block, curr_inp_head_idx, curr_output_pos, curr_output_block, curr_output_idx;
+  int curr_input, curr_output, ot_commit_block, commit_id;
+
+  uint64_t num_batch_e_bytes = 0;
+  uint64_t num_batch_send_bytes = 0;
+  for (int c = batch_from; c < batch_to; ++c) {
+    num_batch_e_bytes += BITS_TO_BYTES(circuits[c]->num_eval_inp_wires);
+    num_batch_send_bytes += circuits[c]->num_const_inp_wires * CSEC_BYTES + (circuits[c]->num_eval_inp_wires + circuits[c]->num_out_wires) * (CODEWORD_BYTES + CSEC_BYTES);
+  }
 
-  std::vector<std::future<void>> online_execs_finished(eval_num_execs);
-  std::vector<int> circuits_from, circuits_to;
+  //batch_send is handed to the channel, so only batch_e comes from the arena
+  ExecArena* arena = exec_arenas[exec_id].get();
+  arena->Reset();
+  uint8_t* batch_e = arena->Alloc<uint8_t>(num_batch_e_bytes);
+  std::unique_ptr<uint8_t[]> batch_send(new uint8_t[num_batch_send_bytes]);
+
+  //Do eval_input based on e
+  thread_params->chan.ReceiveBlocking(batch_e, num_batch_e_bytes);
+
+  e = batch_e;
+  const_inp_keys = batch_send.get();
+  for (int c = batch_from; c < batch_to; ++c) {
+    circuit = circuits[c];
+    input = inputs[c];
+    gate_offset = gates_offset[c];
+    inp_offset = inputs_offset[c];
+    out_offset = outputs_offset[c];
+
+    decommit_shares_inp_0 = const_inp_keys + circuit->num_const_inp_wires * CSEC_BYTES;
+    decommit_shares_inp_1 =  decommit_shares_inp_0 + circuit->num_eval_inp_wires * CODEWORD_BYTES;
+
+    decommit_shares_out_0 =  decommit_shares_inp_1 + circuit->num_eval_inp_wires * CSEC_BYTES;
+    decommit_shares_out_1 = decommit_shares_out_0 + circuit->num_out_wires * CODEWORD_BYTES;
+
+    //Construct const_inp_keys first
+    for (int i = 0; i < (int) circuit->num_const_inp_wires; ++i) {
+      curr_auth_inp_head_pos = params.num_pre_gates * thread_params->num_auth + (inp_offset + i) * thread_params->num_inp_auth;
+      eval_auths_to_blocks.GetExecIDAndIndex(curr_auth_inp_head_pos, curr_inp_head_block, curr_inp_head_idx);
+      XOR_128(const_inp_keys + i * CSEC_BYTES, commit_snds[curr_inp_head_block]->commit_shares0[thread_params->auth_start + curr_inp_head_idx], commit_snds[curr_inp_head_block]->commit_shares1[thread_params->auth_start + curr_inp_head_idx]);
+      if (GetBit(i, input)) {
+        XOR_128(const_inp_keys + i * CSEC_BYTES, commit_snds[curr_inp_head_block]->commit_shares0[thread_params->delta_pos]);
+        XOR_128(const_inp_keys + i * CSEC_BYTES, commit_snds[curr_inp_head_block]->commit_shares1[thread_params->delta_pos]);
+      }
+    }
 
-  PartitionBufferFixedNum(circuits_from, circuits_to, eval_num_execs, circuits.size());
+    for (int i = 0; i < (int) circuit->num_eval_inp_wires; ++i) {
+      curr_input = (inp_offset + i);
+      ot_commit_block = curr_input / thread_params->num_pre_inputs;
+      commit_id = thread_params->ot_chosen_start + curr_input % thread_params->num_pre_inputs;
 
-  IDMap eval_auths_to_blocks(eval_auths_ids, thread_params_vec[0]->Q + thread_params_vec[0]->A, thread_params_vec[0]->auth_start);
-  IDMap eval_gates_to_blocks(eval_gates_ids, thread_params_vec[0]->Q + thread_params_vec[0]->A, thread_params_vec[0]->out_keys_start);
+      std::copy(commit_snds[ot_commit_block]->commit_shares0[commit_id], commit_snds[ot_commit_block]->commit_shares0[commit_id] + CODEWORD_BYTES, decommit_shares_inp_0 + i * CODEWORD_BYTES);
 
-  for (int exec_id = 0; exec_id < eval_num_execs; ++exec_id) {
+      std::copy(commit_snds[ot_commit_block]->commit_shares1[commit_id], commit_snds[ot_commit_block]->commit_shares1[commit_id] + CSEC_BYTES, decommit_shares_inp_1 + i * CSEC_BYTES);
 
-    int circ_from = circuits_from[exec_id];
-    int circ_to = circuits_to[exec_id];
-    Params* thread_params = thread_params_vec[exec_id].get();
+      //Add the input key
+      curr_auth_inp_head_pos = params.num_pre_gates * thread_params->num_auth + (inp_offset + circuit->num_const_inp_wires + i) * thread_params->num_inp_auth;
+      eval_auths_to_blocks.GetExecIDAndIndex(curr_auth_inp_head_pos, curr_inp_head_block, curr_inp_head_idx);
+      XOR_CodeWords(decommit_shares_inp_0 + i * CODEWORD_BYTES, commit_snds[curr_inp_head_block]->commit_shares0[thread_params->auth_start + curr_inp_head_idx]);
 
-    online_execs_finished[exec_id] = thread_pool.push([this, thread_params, exec_id, circ_from, circ_to, &circuits, &inputs, &eval_gates_to_blocks, &eval_auths_to_blocks] (int id) {
-
-      Circuit* circuit;
-      uint8_t* input;
-      uint8_t* eval_inp_keys;
-      uint8_t* out_keys;
-      uint8_t* decommit_shares_inp_0;
-      uint8_t* decommit_shares_inp_1;
-      uint8_t* decommit_shares_out_0;
-      uint8_t* decommit_shares_out_1;
-      uint8_t* e;
-
-      int gate_offset, inp_offset, out_offset;
-      int curr_auth_inp_head_pos, curr_inp_head_block, curr_inp_head_idx, curr_output_pos, curr_output_block, curr_output_idx;
-      int curr_input, curr_output, ot_commit_block, commit_id;
-      for (int c = circ_from; c < circ_to; ++c) {
-        circuit = circuits[c];
-        input = inputs[c];
-        gate_offset = gates_offset[c];
-        inp_offset = inputs_offset[c];
-        out_offset = outputs_offset[c];
+      XOR_128(decommit_shares_inp_1 + i * CSEC_BYTES, commit_snds[curr_inp_head_block]->commit_shares1[thread_params->auth_start + curr_inp_head_idx]);
 
-        uint8_t* const_inp_keys = new uint8_t[circuit->num_const_inp_wires * CSEC_BYTES + (circuit->num_eval_inp_wires + circuit->num_out_wires) * (CODEWORD_BYTES + CSEC_BYTES) + BITS_TO_BYTES(circuit->num_eval_inp_wires)];
+      if (GetBit(i, e)) {
+        XOR_CodeWords(decommit_shares_inp_0 + i * CODEWORD_BYTES, commit_snds[ot_commit_block]->commit_shares0[thread_params->delta_pos]);
 
-        decommit_shares_inp_0 = const_inp_keys + circuit->num_const_inp_wires * CSEC_BYTES;
-        decommit_shares_inp_1 =  decommit_shares_inp_0 + circuit->num_eval_inp_wires * CODEWORD_BYTES;
+        XOR_128(decommit_shares_inp_1 + i * CSEC_BYTES, commit_snds[ot_commit_block]->commit_shares1[thread_params->delta_pos]);
 
-        decommit_shares_out_0 =  decommit_shares_inp_1 + circuit->num_eval_inp_wires * CSEC_BYTES;
-        decommit_shares_out_1 = decommit_shares_out_0 + circuit->num_out_wires * CODEWORD_BYTES;
+      }
+    }
 
-        e = decommit_shares_out_1 + circuit->num_out_wires * CSEC_BYTES;
+    //Construct output key decommits
+    for (int i = 0; i < (int) circuit->num_out_wires; ++i) {
+      curr_output = (out_offset + i);
+      ot_commit_block = curr_output / thread_params->num_pre_outputs;
+      commit_id = thread_params->out_lsb_blind_start + curr_output % thread_params->num_pre_outputs;
 
-        uint32_t num_send_bytes_inp = circuit->num_const_inp_wires * CSEC_BYTES +  circuit->num_eval_inp_wires * (CODEWORD_BYTES + CSEC_BYTES);
-        uint32_t num_send_bytes_out =  circuit->num_out_wires * (CODEWORD_BYTES + CSEC_BYTES);
+      std::copy(commit_snds[ot_commit_block]->commit_shares0[commit_id], commit_snds[ot_commit_block]->commit_shares0[commit_id] + CODEWORD_BYTES, decommit_shares_out_0 + i * CODEWORD_BYTES);
 
-        //Construct const_inp_keys first
-        for (int i = 0; i < circuit->num_const_inp_wires; ++i) {
-          curr_auth_inp_head_pos = params.num_pre_gates * thread_params->num_auth + (inp_offset + i) * thread_params->num_inp_auth;
-          eval_auths_to_blocks.GetExecIDAndIndex(curr_auth_inp_head_pos, curr_inp_head_block, curr_inp_head_idx);
-          XOR_128(const_inp_keys + i * CSEC_BYTES, commit_snds[curr_inp_head_block]->commit_shares0[thread_params->auth_start + curr_inp_head_idx], commit_snds[curr_inp_head_block]->commit_shares1[thread_params->auth_start + curr_inp_head_idx]);
-          if (GetBit(i, input)) {
-            XOR_128(const_inp_keys + i * CSEC_BYTES, commit_snds[curr_inp_head_block]->commit_shares0[thread_params->delta_pos]);
-            XOR_128(const_inp_keys + i * CSEC_BYTES, commit_snds[curr_inp_head_block]->commit_shares1[thread_params->delta_pos]);
-          }
-        }
-        //Do eval_input based on e
-        thread_params->chan.ReceiveBlocking(e, BITS_TO_BYTES(circuit->num_eval_inp_wires));
+      std::copy(commit_snds[ot_commit_block]->commit_shares1[commit_id], commit_snds[ot_commit_block]->commit_shares1[commit_id] + CSEC_BYTES, decommit_shares_out_1 + i * CSEC_BYTES);
 
-        for (int i = 0; i < circuit->num_eval_inp_wires; ++i) {
-          curr_input = (inp_offset + i);
-          ot_commit_block = curr_input / thread_params->num_pre_inputs;
-          commit_id = thread_params->ot_chosen_start + curr_input % thread_params->num_pre_inputs;
+      curr_output_pos = (gate_offset + circuit->num_and_gates - circuit->num_out_wires + i) * thread_params->num_bucket;
+      eval_gates_to_blocks.GetExecIDAndIndex(curr_output_pos, curr_output_block, curr_output_idx);
 
-          std::copy(commit_snds[ot_commit_block]->commit_shares0[commit_id], commit_snds[ot_commit_block]->commit_shares0[commit_id] + CODEWORD_BYTES, decommit_shares_inp_0 + i * CODEWORD_BYTES);
+      XOR_CodeWords(decommit_shares_out_0 + i * CODEWORD_BYTES, commit_snds[curr_output_block]->commit_shares0[thread_params->out_keys_start + curr_output_idx]);
 
-          std::copy(commit_snds[ot_commit_block]->commit_shares1[commit_id], commit_snds[ot_commit_block]->commit_shares1[commit_id] + CSEC_BYTES, decommit_shares_inp_1 + i * CSEC_BYTES);
+      XOR_128(decommit_shares_out_1 + i * CSEC_BYTES, commit_snds[curr_output_block]->commit_shares1[thread_params->out_keys_start + curr_output_idx]);
+    }
 
-          //Add the input key
-          curr_auth_inp_head_pos = params.num_pre_gates * thread_params->num_auth + (inp_offset + circuit->num_const_inp_wires + i) * thread_params->num_inp_auth;
-          eval_auths_to_blocks.GetExecIDAndIndex(curr_auth_inp_head_pos, curr_inp_head_block, curr_inp_head_idx);
-          XOR_CodeWords(decommit_shares_inp_0 + i * CODEWORD_BYTES, commit_snds[curr_inp_head_block]->commit_shares0[thread_params->auth_start + curr_inp_head_idx]);
+    e += BITS_TO_BYTES(circuit->num_eval_inp_wires);
+    const_inp_keys = decommit_shares_out_1 + circuit->num_out_wires * CSEC_BYTES;
+  }
 
-          XOR_128(decommit_shares_inp_1 + i * CSEC_BYTES, commit_snds[curr_inp_head_block]->commit_shares1[thread_params->auth_start + curr_inp_head_idx]);
+  //Send all input keys and input and output decommits of the batch
+  thread_params->chan.Send(std::move(batch_send), num_batch_send_bytes);
+}
 
-          if (GetBit(i, e)) {
-            XOR_CodeWords(decommit_shares_inp_0 + i * CODEWORD_BYTES, commit_snds[ot_commit_block]->commit_shares0[thread_params->delta_pos]);
+uint64_t TinyConstructor::OnlineScratchBytes(std::vector<Circuit*>& circuits, int batch_from, int batch_to) {
+  uint64_t num_batch_e_bytes = 0;
+  for (int c = batch_from; c < batch_to; ++c) {
+    num_batch_e_bytes += BITS_TO_BYTES(circuits[c]->num_eval_inp_wires);
+  }
+  return ExecArena::SliceBytes(num_batch_e_bytes);
+}
 
-            XOR_128(decommit_shares_inp_1 + i * CSEC_BYTES, commit_snds[ot_commit_block]->commit_shares1[thread_params->delta_pos]);
+void TinyConstructor::Online(std::vector<Circuit*>& circuits, std::vector<uint8_t*>& inputs, int eval_num_execs) {
 
-          }
-        }
+  //The online phase is a few round trips of small messages, so poll for them instead of paying for wakeups
+  params.mux->SetBusyPoll(true);
 
-        //Send all input keys and decommits
-        thread_params->chan.Send(const_inp_keys, num_send_bytes_inp);
+  std::vector<int> circuits_from, circuits_to;
+  int num_tasks = SplitCircuits(circuits, eval_num_execs, circuits_from, circuits_to);
+  EnsureExecs(num_tasks);
+  std::vector<std::future<void>> online_execs_finished(num_tasks);
 
-        //Construct output key decommits
-        for (int i = 0; i < circuit->num_out_wires; ++i) {
-          curr_output = (out_offset + i);
-          ot_commit_block = curr_output / thread_params->num_pre_outputs;
-          commit_id = thread_params->out_lsb_blind_start + curr_output % thread_params->num_pre_outputs;
+  IDMap eval_auths_to_blocks(eval_auths_ids, thread_params_vec[0]->Q + thread_params_vec[0]->A, thread_params_vec[0]->auth_start);
+  IDMap eval_gates_to_blocks(eval_gates_ids, thread_params_vec[0]->Q + thread_params_vec[0]->A, thread_params_vec[0]->out_keys_start);
 
-          std::copy(commit_snds[ot_commit_block]->commit_shares0[commit_id], commit_snds[ot_commit_block]->commit_shares0[commit_id] + CODEWORD_BYTES, decommit_shares_out_0 + i * CODEWORD_BYTES);
+  for (int exec_id = 0; exec_id < num_tasks; ++exec_id) {
 
-          std::copy(commit_snds[ot_commit_block]->commit_shares1[commit_id], commit_snds[ot_commit_block]->commit_shares1[commit_id] + CSEC_BYTES, decommit_shares_out_1 + i * CSEC_BYTES);
+    int circ_from = circuits_from[exec_id];
+    int circ_to = circuits_to[exec_id];
+    Params* thread_params = thread_params_vec[exec_id].get();
+
+    online_execs_finished[exec_id] = thread_pool.push([this, thread_params, exec_id, num_tasks, circ_from, circ_to, &circuits, &inputs, &eval_gates_to_blocks, &eval_auths_to_blocks] (int id) {
+      NodePin pin(NumaTopology::Get().NodeOfExec(exec_id, num_tasks));
+      ReserveOnlineArena(exec_id, circuits, circ_from, circ_to, ONLINE_BATCH_SIZE);
 
-          curr_output_pos = (gate_offset + circuit->num_and_gates - circuit->num_out_wires + i) * thread_params->num_bucket;
-          eval_gates_to_blocks.GetExecIDAndIndex(curr_output_pos, curr_output_block, curr_output_idx);
+      for (int batch_from = circ_from; batch_from < circ_to; batch_from += ONLINE_BATCH_SIZE) {
+        int batch_to = std::min(batch_from + ONLINE_BATCH_SIZE, circ_to);
+        OnlineBatch(thread_params, exec_id, batch_from, batch_to, circuits, inputs, eval_gates_to_blocks, eval_auths_to_blocks);
+      }
+    });
+  }
 
-          XOR_CodeWords(decommit_shares_out_0 + i * CODEWORD_BYTES, commit_snds[curr_output_block]->commit_shares0[thread_params->out_keys_start + curr_output_idx]);
+  for (std::future<void>& r : online_execs_finished) {
+    r.wait();
+  }
+  params.mux->SetBusyPoll(false);
 
-          XOR_128(decommit_shares_out_1 + i * CSEC_BYTES, commit_snds[curr_output_block]->commit_shares1[thread_params->out_keys_start + curr_output_idx]);
-        }
+  for (std::future<void>& r : online_execs_finished) {
+    r.get();
+  }
+}
+
+void TinyConstructor::OfflineOnline(std::vector<Circuit*>& circuits, std::vector<uint8_t*>& inputs, int num_execs, std::function<void(int)> circuit_done) {
+  ReserveCircuits(circuits);
+
+  //Soldering runs on the channels of the first num_tasks execs and evaluation on those of the next num_tasks, so the two can overlap
+  std::vector<int> circuits_from, circuits_to;
+  int num_tasks = SplitCircuits(circuits, num_execs, circuits_from, circuits_to);
+  EnsureExecs(2 * num_tasks);
 
-        //Send output decommits
-        thread_params->chan.Send(decommit_shares_out_0,  num_send_bytes_out);
+  params.mux->SetBusyPoll(true);
 
-        delete[] const_inp_keys; //Deletes everything
+  IDMap eval_gates_to_blocks(eval_gates_ids, thread_params_vec[0]->Q + thread_params_vec[0]->A, thread_params_vec[0]->out_keys_start);
+  IDMap eval_auths_to_blocks(eval_auths_ids, thread_params_vec[0]->Q + thread_params_vec[0]->A, thread_params_vec[0]->auth_start);
+
+  //Set once the solderings of a circuit have been sent
+  std::vector<std::promise<void>> soldered(circuits.size());
+  std::vector<std::future<void>> execs_finished;
+  for (int exec_id = 0; exec_id < num_tasks; ++exec_id) {
+    int circ_from = circuits_from[exec_id];
+    int circ_to = circuits_to[exec_id];
+    Params* solder_params = thread_params_vec[exec_id].get();
+    Params* online_params = thread_params_vec[num_tasks + exec_id].get();
+
+    //The soldering exec is pushed first, so an online exec never holds the last pool thread while the soldering it waits for is still queued
+    execs_finished.emplace_back(thread_pool.push([this, solder_params, exec_id, num_tasks, circ_from, circ_to, &circuits, &soldered, &eval_gates_to_blocks, &eval_auths_to_blocks] (int id) {
+      NodePin pin(NumaTopology::Get().NodeOfExec(exec_id, num_tasks));
+      int c = circ_from;
+      try {
+        ReserveSolderArena(exec_id, circuits, circ_from, circ_to);
+        for (; c < circ_to; ++c) {
+          SolderCircuit(solder_params, exec_id, c, circuits, eval_gates_to_blocks, eval_auths_to_blocks);
+          soldered[c].set_value();
+        }
+      } catch (...) {
+        for (; c < circ_to; ++c) {
+          soldered[c].set_exception(std::current_exception());
+        }
+        throw;
       }
-    });
+    }));
+
+    execs_finished.emplace_back(thread_pool.push([this, online_params, num_tasks, exec_id, circ_from, circ_to, &circuits, &inputs, &soldered, &circuit_done, &eval_gates_to_blocks, &eval_auths_to_blocks] (int id) {
+      NodePin pin(NumaTopology::Get().NodeOfExec(exec_id, num_tasks));
+      ReserveOnlineArena(num_tasks + exec_id, circuits, circ_from, circ_to, 1);
+      for (int c = circ_from; c < circ_to; ++c) {
+        soldered[c].get_future().get();
+        OnlineBatch(online_params, num_tasks + exec_id, c, c + 1, circuits, inputs, eval_gates_to_blocks, eval_auths_to_blocks);
+        if (circuit_done) {
+          circuit_done(c);
+        }
+      }
+    }));
   }
 
-  for (std::future<void>& r : online_execs_finished) {
+  for (std::future<void>& r : execs_finished) {
     r.wait();
   }
+  params.mux->SetBusyPoll(false);
+
+  //As in Offline and Online, failures inside the execs are passed on, so a circuit that fails its soldering check is never reported as evaluated
+  for (std::future<void>& r : execs_finished) {
+    r.get();
+  }
 }
 
 //The below function is essentially a mix of the two CommitSnd member functions ConsistencyCheck and BatchDecommit.
@@ -9,11 +9,19 @@
 class TinyConstructor : public Tiny {
 public:
   TinyConstructor(Params& params);
+  ~TinyConstructor();
 
   void Setup();
   void Preprocess();
   void Offline(std::vector<Circuit*>& circuits, int top_num_execs);
+  void AddExecs(int num_extra_execs);
+  int GetNumQueuedBatches();
+  void SavePreprocessed(std::string path);
+  void LoadPreprocessed(std::string path);
   void Online(std::vector<Circuit*>& circuits, std::vector<uint8_t*>& inputs, int eval_num_execs);
+
+  //Offline and Online in one pass. Each soldering task hands a circuit to its online task as soon as it is soldered and goes on with the next ones, so the first results are ready after a single circuit's offline time. The circuits are split into tasks as in Offline and every task pair uses two execs, which are added if needed. circuit_done, if set, is called with the index of every evaluated circuit from the exec that evaluated it
+  void OfflineOnline(std::vector<Circuit*>& circuits, std::vector<uint8_t*>& inputs, int num_execs, std::function<void(int)> circuit_done = nullptr);
   void BatchDecommitLSB(CommitSender* commit_snd, uint8_t decommit_shares0[], uint8_t decommit_shares1[], int num_values);
 
   ALSZDOTExtSnd ot_snd;
@@ -25,6 +33,38 @@ public:
   uint32_t* eval_gates_ids;
   uint32_t* eval_auths_ids;
   uint8_t* global_delta;
+
+  //Set if the batch was loaded from a file. The commitment shares point into it
+  std::shared_ptr<uint8_t> mapping;
+
+  //Preprocessed state of a queued batch. The active batch lives in the members above
+  struct Batch {
+    std::vector<std::unique_ptr<Params>> thread_params_vec;
+    std::vector<std::unique_ptr<CommitSender>> commit_snds;
+    std::unique_ptr<uint8_t[]> rot_seeds0;
+    std::unique_ptr<uint32_t[]> raw_eval_ids;
+    std::shared_ptr<uint8_t> mapping;
+  };
+  std::deque<std::unique_ptr<Batch>> queued_batches;
+
+  //Background mode only. Preprocesses on its own base OTs and channels and hands every finished batch to this instance
+  std::unique_ptr<Params> producer_params;
+  std::unique_ptr<TinyConstructor> producer;
+
+private:
+  void CreateProducer(int num_threads);
+  void ProduceBatch();
+  void CreateExecs(int num_new_execs);
+  void SolderCircuit(Params* thread_params, int exec_id, int c, std::vector<Circuit*>& circuits, IDMap& eval_gates_to_blocks, IDMap& eval_auths_to_blocks);
+  void OnlineBatch(Params* thread_params, int exec_id, int batch_from, int batch_to, std::vector<Circuit*>& circuits, std::vector<uint8_t*>& inputs, IDMap& eval_gates_to_blocks, IDMap& eval_auths_to_blocks);
+  uint64_t SolderScratchBytes(Circuit* circuit);
+  uint64_t OnlineScratchBytes(std::vector<Circuit*>& circuits, int batch_from, int batch_to);
+  void PreprocessBatch();
+  void InitBatch();
+  void SwapBatch(Batch& batch);
+  void ActivateNextBatch();
+  void SaveBatch(PreprocessedWriter& writer);
+  void LoadBatch(PreprocessedReader& reader);
 };
 
 #endif /* TINY_TINY_TINYCONST_H_ */
\ No newline at end of file
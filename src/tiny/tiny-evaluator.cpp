@@ -2,13 +2,51 @@
 
 TinyEvaluator::TinyEvaluator(Params& params) :
   Tiny(params),
-  ot_rec(params),
-  rot_seeds(std::make_unique<uint8_t[]>(CODEWORD_BITS * CSEC_BYTES)),
-  rot_choices(std::make_unique<uint8_t[]>(BITS_TO_BYTES(CODEWORD_BITS))),
-  verleak_bits(std::make_unique<uint8_t[]>(BITS_TO_BYTES(params.num_pre_outputs + params.num_pre_inputs))),
-  raw_eval_data(std::make_unique<uint8_t[]>(5 * CSEC_BYTES * params.num_eval_gates + 3 * CSEC_BYTES * params.num_eval_auths)),
-  raw_eval_ids(std::make_unique<uint32_t[]>(params.num_eval_gates + params.num_eval_auths)) {
+  ot_rec(params) {
 
+  InitBatch();
+}
+
+TinyEvaluator::~TinyEvaluator() {
+  StopBackground();
+}
+
+//Replaces the active batch with freshly allocated and empty state. The DOT outputs are part of a batch as the online phase reads the input OTs directly from them. Without alloc_eval_data the eval data is left empty, for LoadBatch to point into the mapping of a file
+void TinyEvaluator::InitBatch(bool alloc_eval_data) {
+  Batch batch;
+  batch.rot_seeds = std::make_unique<uint8_t[]>(CODEWORD_BITS * CSEC_BYTES);
+  batch.rot_choices = std::make_unique<uint8_t[]>(BITS_TO_BYTES(CODEWORD_BITS));
+  batch.verleak_bits = std::make_unique<uint8_t[]>(BITS_TO_BYTES(params.num_pre_outputs + params.num_pre_inputs));
+  if (alloc_eval_data) {
+    batch.raw_eval_data = std::shared_ptr<uint8_t>(new uint8_t[EvalDataSize()], std::default_delete<uint8_t[]>());
+    //The eval data and ids are read at random by all execs, so they are spread over the nodes before anything touches them
+    NumaTopology::Get().Interleave(batch.raw_eval_data.get(), EvalDataSize());
+    AdviseHugePages(batch.raw_eval_data.get(), EvalDataSize());
+    //The S_L and S_R solderings of the head gates are never written, only XOR'ed into by SolderCircuit, so those two rows must start out as zero. Everything else is written before it is read. They are large, so all pool threads zero them
+    ZeroPages(batch.raw_eval_data.get() + 3 * CSEC_BYTES * params.num_eval_gates, 2 * CSEC_BYTES * params.num_eval_gates, thread_pool);
+  }
+  batch.raw_eval_ids = MakeInterleaved<uint32_t>(params.num_eval_gates + params.num_eval_auths);
+  batch.choices_outer = std::make_unique<uint8_t[]>(BITS_TO_BYTES(params.num_OT));
+  batch.response_outer = std::make_unique<uint8_t[]>(params.num_OT * CSEC_BYTES);
+  SwapBatch(batch);
+}
+
+void TinyEvaluator::SwapBatch(Batch& batch) {
+  std::swap(thread_params_vec, batch.thread_params_vec);
+  std::swap(commit_recs, batch.commit_recs);
+  std::swap(rot_seeds, batch.rot_seeds);
+  std::swap(rot_choices, batch.rot_choices);
+  std::swap(verleak_bits, batch.verleak_bits);
+  std::swap(raw_eval_data, batch.raw_eval_data);
+  std::swap(raw_eval_ids, batch.raw_eval_ids);
+  std::swap(ot_rec.choices_outer, batch.choices_outer);
+  std::swap(ot_rec.response_outer, batch.response_outer);
+  std::swap(mapping, batch.mapping);
+
+  SetEvalPointers();
+}
+
+void TinyEvaluator::SetEvalPointers() {
   //Pointers for convenience to the raw data used for storing the produced eval gates and eval auths. Each exec will write to this array in seperate positions and thus filling it completely. Needs to be computed like this to avoid overflow of evla_data_size
   eval_gates.T_G = raw_eval_data.get();
   eval_gates.T_E = eval_gates.T_G + CSEC_BYTES * params.num_eval_gates;
@@ -24,8 +62,7 @@ TinyEvaluator::TinyEvaluator(Params& params) :
 }
 
 void TinyEvaluator::Setup() {
-  ot_rec.net.m_vSocket->ResetSndCnt();
-  ot_rec.net.m_vSocket->ResetRcvCnt();
+  ot_rec.net.ResetBytes();
   //============================Run DOT========================================
   auto baseOT_begin = GET_TIME();
   ot_rec.InitOTReceiver();
@@ -37,6 +74,25 @@ void TinyEvaluator::Setup() {
 }
 
 void TinyEvaluator::Preprocess() {
+  if (num_preprocessed == 0) {
+    PreprocessBatch();
+  } else {
+    //Keep the active batch aside while the new one is produced in fresh buffers, then queue the new one behind it
+    std::unique_ptr<Batch> active(std::make_unique<Batch>());
+    SwapBatch(*active);
+    InitBatch();
+    params.rnd.GenRnd(thread_seeds.get(), CSEC_BYTES * params.num_execs);
+
+    PreprocessBatch();
+
+    queued_batches.emplace_back(std::make_unique<Batch>());
+    SwapBatch(*queued_batches.back());
+    SwapBatch(*active);
+  }
+  ++num_preprocessed;
+}
+
+void TinyEvaluator::PreprocessBatch() {
 
   std::vector<std::vector<std::chrono::duration<long double, std::milli>>> durations(EVAL_NUM_TIMINGS);
 
@@ -100,6 +156,7 @@ void TinyEvaluator::Preprocess() {
   bucket_rnd.GenRnd(bucket_seeds, 2 * CSEC_BYTES);
 
   std::unique_ptr<uint32_t[]> permuted_eval_ids_ptr(new uint32_t[params.num_eval_gates + params.num_eval_auths]);
+  NumaTopology::Get().Interleave(permuted_eval_ids_ptr.get(), (params.num_eval_gates + params.num_eval_auths) * sizeof(uint32_t));
   uint32_t* permuted_eval_gates_ids = permuted_eval_ids_ptr.get();
   uint32_t* permuted_eval_auths_ids = permuted_eval_gates_ids + params.num_eval_gates;
 
@@ -110,8 +167,8 @@ void TinyEvaluator::Preprocess() {
   for (uint32_t i = 0; i < params.num_eval_auths; ++i) {
     permuted_eval_auths_ids[i] = i;
   }
-  PermuteArray(permuted_eval_gates_ids, params.num_eval_gates, bucket_seeds);
-  PermuteArray(permuted_eval_auths_ids, params.num_eval_auths, bucket_seeds + CSEC_BYTES);
+  ParallelPermuteArray(permuted_eval_gates_ids, params.num_eval_gates, bucket_seeds, thread_pool);
+  ParallelPermuteArray(permuted_eval_auths_ids, params.num_eval_auths, bucket_seeds + CSEC_BYTES, thread_pool);
 
   //store last exec_id as this execution performs the Delta-OT CnC step. This step is needed as we need to signal that the last thread execution ensures that the sender indeed committed to the global_delta used in DOT protocol. We do it in the last execution to avoid dealing with any prefix offset for all OT values, ie. we sacrifices the last SSEC OTs.
   int last_exec_id = params.num_execs - 1;
@@ -126,7 +183,7 @@ void TinyEvaluator::Preprocess() {
     int thread_num_pre_gates = gates_to[exec_id] - gates_from[exec_id];
 
     //Need to create a new params for each execution with the correct num_pre_gates and num_pre_inputs. The exec_id value decides which channel the execution is communicating on, so must match the constructor execution.
-    thread_params_vec.emplace_back(std::make_unique<Params>(params, thread_seeds.get() + exec_id * CSEC_BYTES, thread_num_pre_gates, thread_num_pre_inputs, thread_num_pre_outputs, exec_id));
+    thread_params_vec.emplace_back(std::make_unique<Params>(params, thread_seeds.get() + exec_id * CSEC_BYTES, thread_num_pre_gates, thread_num_pre_inputs, thread_num_pre_outputs, exec_chan_offset + exec_id));
     Params* thread_params = thread_params_vec[exec_id].get();
 
     //We store our local state in the containers as we need to access them for future use
@@ -141,6 +198,8 @@ void TinyEvaluator::Preprocess() {
 
     //Starts the current execution
     cnc_execs_finished[exec_id] = thread_pool.push([this, thread_params, commit_rec, delta_holder, exec_id, &cout_mutex, &delta_checks, ver_success, inp_from, inp_to, last_exec_id, permuted_eval_gates_ids, permuted_eval_auths_ids, &durations] (int id) {
+      //Pins the exec as in TinyConstructor::PreprocessBatch
+      NodePin pin(NumaTopology::Get().NodeOfExec(exec_id, params.num_execs));
       auto commit_begin = GET_TIME();
 
       // If it's the last execution then we commit to s extra OTs as these are to be used for CNC.
@@ -280,11 +339,8 @@ void TinyEvaluator::Preprocess() {
       uint8_t cnc_seed[CSEC_BYTES];
       thread_params->rnd.GenRnd(cnc_seed, CSEC_BYTES);
 
-      //Receive all garbling data. When received we send the CNC challenge seed
-      std::unique_ptr<uint8_t[]> raw_garbling_data(std::make_unique<uint8_t[]>(3 * thread_params->Q * CSEC_BYTES + 2 * thread_params->A * CSEC_BYTES));
-      thread_params->chan.ReceiveBlocking(raw_garbling_data.get(), 3 * thread_params->Q * CSEC_BYTES + 2 * thread_params->A * CSEC_BYTES);
-
-      thread_params->chan.Send(cnc_seed, CSEC_BYTES);
+      //Receive all garbling data. It arrives in chunks of GARBLING_CHUNK_SIZE matching how the constructor garbles and sends it. The eval positions are only known after the CNC challenge, so chunks are received in place in the background while we prepare the CNC below
+      std::unique_ptr<uint8_t[]> raw_garbling_data(MakeLarge<uint8_t>(3 * thread_params->Q * CSEC_BYTES + 2 * thread_params->A * CSEC_BYTES));
 
       //Assign pointers to the garbling data. Doing this relatively for clarity
       HalfGates gates_data;
@@ -296,25 +352,33 @@ void TinyEvaluator::Preprocess() {
       auths_data.H_0 = gates_data.S_O + thread_params->Q * CSEC_BYTES;
       auths_data.H_1 = auths_data.H_0 + thread_params->A * CSEC_BYTES;
 
-      auto receive_gates_auths_end = GET_TIME();
-      durations[EVAL_RECEIVE_GATES_AUTHS_TIME][exec_id] = receive_gates_auths_end - receive_gates_auths_begin;
+      ReceiveGroup garbling_receives;
+      for (uint32_t c = 0; c < thread_params->Q; c += GARBLING_CHUNK_SIZE) {
+        uint32_t chunk_size = std::min((uint64_t) GARBLING_CHUNK_SIZE, thread_params->Q - c);
+        garbling_receives.Add(thread_params->chan, gates_data.T_G + c * CSEC_BYTES, chunk_size * CSEC_BYTES);
+        garbling_receives.Add(thread_params->chan, gates_data.T_E + c * CSEC_BYTES, chunk_size * CSEC_BYTES);
+        garbling_receives.Add(thread_params->chan, gates_data.S_O + c * CSEC_BYTES, chunk_size * CSEC_BYTES);
+      }
+      for (uint32_t c = 0; c < thread_params->A; c += GARBLING_CHUNK_SIZE) {
+        uint32_t chunk_size = std::min((uint64_t) GARBLING_CHUNK_SIZE, thread_params->A - c);
+        garbling_receives.Add(thread_params->chan, auths_data.H_0 + c * CSEC_BYTES, chunk_size * CSEC_BYTES);
+        garbling_receives.Add(thread_params->chan, auths_data.H_1 + c * CSEC_BYTES, chunk_size * CSEC_BYTES);
+      }
 
       //========================Run Cut-and-Choose=============================
       auto cnc_begin = GET_TIME();
 
-      //Sample check gates and check auths along with the challenge inputs to these. SampleChallenges populates all these variables
-      int num_bytes_gates = BITS_TO_BYTES(thread_params->Q);
-      int num_bytes_auths = BITS_TO_BYTES(thread_params->A);
+      //The challenge and the check shares only depend on cnc_seed and the commitments, so they are computed while the garbling data is still arriving. The seed itself is not sent before all garbling data has been received
+
+      //Sample check gates and check auths along with the challenge inputs to these. The CnCChallenge objects hold the check and eval index lists
       PRNG cnc_rand;
       cnc_rand.SetSeed(cnc_seed);
 
-      std::unique_ptr<uint8_t[]> cnc_check_gates(std::make_unique<uint8_t[]>(num_bytes_gates + num_bytes_auths));
-      uint8_t* cnc_check_auths = cnc_check_gates.get() + num_bytes_gates;
-      WeightedRandomString(cnc_check_gates.get(), thread_params->p_g, num_bytes_gates, cnc_rand);
-      WeightedRandomString(cnc_check_auths, thread_params->p_a, num_bytes_auths, cnc_rand);
+      CnCChallenge gate_challenge(thread_params->Q, thread_params->p_g, cnc_rand);
+      CnCChallenge auth_challenge(thread_params->A, thread_params->p_a, cnc_rand);
 
-      int num_check_gates = countSetBits(cnc_check_gates.get(), 0, thread_params->Q - 1);
-      int num_check_auths = countSetBits(cnc_check_auths, 0, thread_params->A - 1);
+      int num_check_gates = gate_challenge.num_checks;
+      int num_check_auths = auth_challenge.num_checks;
 
       std::unique_ptr<uint8_t[]> left_cnc_input(std::make_unique<uint8_t[]>(3 * BITS_TO_BYTES(num_check_gates) + BITS_TO_BYTES(num_check_auths)));
       uint8_t* right_cnc_input = left_cnc_input.get() + BITS_TO_BYTES(num_check_gates);
@@ -333,92 +397,81 @@ void TinyEvaluator::Preprocess() {
       int num_checks = 3 * num_check_gates + num_check_auths;
       std::unique_ptr<uint8_t[]> cnc_computed_shares(std::make_unique<uint8_t[]>(num_checks * CODEWORD_BYTES));
 
-      int current_check_auth_num = 0;
-      int current_eval_auth_num = 0;
       std::unique_ptr<uint32_t[]> check_auth_ids(std::make_unique<uint32_t[]>(num_check_auths));
 
-      //Development dirty check. Can be deleted once we have computed the correct slack bounds in params.
-      bool filled_eval_auths = false;
-      for (uint32_t i = 0; i < thread_params->A; ++i) {
-        if (GetBit(i, cnc_check_auths)) {
-          check_auth_ids[current_check_auth_num] = exec_id * (thread_params->Q + thread_params->A) + thread_params->auth_start + i;
-          std::copy(commit_rec->commit_shares[thread_params->auth_start + i], commit_rec->commit_shares[thread_params->auth_start + i] + CODEWORD_BYTES, cnc_computed_shares.get() + current_check_auth_num * CODEWORD_BYTES);
-          if (GetBit(current_check_auth_num, auth_cnc_input)) {
-            XOR_CodeWords(cnc_computed_shares.get() + current_check_auth_num * CODEWORD_BYTES, commit_rec->commit_shares[thread_params->delta_pos]);
-          }
-          ++current_check_auth_num;
-        } else {
-          //Only write to num_eval_auths if it is not yet filled up. Might be wasteful, but easier to handle
-          if (current_eval_auth_num < thread_params->num_eval_auths) {
-
-            uint32_t target_pos = permuted_eval_auths_ids[thread_params->num_eval_auths * exec_id + current_eval_auth_num];
-            std::copy(auths_data.H_0 + i * CSEC_BYTES, auths_data.H_0 + i * CSEC_BYTES + CSEC_BYTES, eval_auths.H_0 + target_pos * CSEC_BYTES);
-            std::copy(auths_data.H_1 + i * CSEC_BYTES, auths_data.H_1 + i * CSEC_BYTES + CSEC_BYTES, eval_auths.H_1 + target_pos * CSEC_BYTES);
-
-            //Write the actual auth ID to eval_gates_ids in target_pos, which is determined by permuted_eval_auths_ids
-            eval_auths_ids[target_pos] = exec_id * (thread_params->Q + thread_params->A) + thread_params->auth_start + i;
-          } else {
-            //Development dirty check. Can be deleted once we have computed the correct slack bounds in params.
-            filled_eval_auths = true;
-          }
-
-          ++current_eval_auth_num;
+      //Each check and eval item only depends on its position in the index lists, so the loops below have no carried state. The check loops only read commitments, the eval loops further down read the garbling data
+      for (int current_check_auth_num = 0; current_check_auth_num < num_check_auths; ++current_check_auth_num) {
+        uint32_t i = auth_challenge.check_ids[current_check_auth_num];
+        check_auth_ids[current_check_auth_num] = exec_id * (thread_params->Q + thread_params->A) + thread_params->auth_start + i;
+        std::copy(commit_rec->commit_shares[thread_params->auth_start + i], commit_rec->commit_shares[thread_params->auth_start + i] + CODEWORD_BYTES, cnc_computed_shares.get() + current_check_auth_num * CODEWORD_BYTES);
+        if (GetBit(current_check_auth_num, auth_cnc_input)) {
+          XOR_CodeWords(cnc_computed_shares.get() + current_check_auth_num * CODEWORD_BYTES, commit_rec->commit_shares[thread_params->delta_pos]);
         }
       }
 
       //Now for the gates
       std::unique_ptr<uint32_t[]> check_gate_ids(std::make_unique<uint32_t[]>(num_check_gates));
 
-      bool filled_eval_gates = false;
-      int current_check_gate_num = 0;
-      int current_eval_gate_num = 0;
-      for (uint32_t i = 0; i < thread_params->Q; ++i) {
-        if (GetBit(i, cnc_check_gates.get())) {
-          check_gate_ids[current_check_gate_num] = exec_id * (thread_params->Q + thread_params->A) + thread_params->out_keys_start + i;
-
-          //Left
-          std::copy(commit_rec->commit_shares[thread_params->left_keys_start + i], commit_rec->commit_shares[thread_params->left_keys_start + i] + CODEWORD_BYTES, cnc_computed_shares.get() + (num_check_auths + current_check_gate_num) * CODEWORD_BYTES);
-          if (GetBit(current_check_gate_num, left_cnc_input.get())) {
-            XOR_CodeWords(cnc_computed_shares.get() + (num_check_auths + current_check_gate_num) * CODEWORD_BYTES, commit_rec->commit_shares[thread_params->delta_pos]);
-          }
-          //Right
-          std::copy(commit_rec->commit_shares[thread_params->right_keys_start + i], commit_rec->commit_shares[thread_params->right_keys_start + i] + CODEWORD_BYTES, cnc_computed_shares.get() + (num_check_auths + num_check_gates + current_check_gate_num) * CODEWORD_BYTES);
-          if (GetBit(current_check_gate_num, right_cnc_input)) {
-            XOR_CodeWords(cnc_computed_shares.get() + (num_check_auths + num_check_gates + current_check_gate_num) * CODEWORD_BYTES, commit_rec->commit_shares[thread_params->delta_pos]);
-          }
-          //Out
-          std::copy(commit_rec->commit_shares[thread_params->out_keys_start + i], commit_rec->commit_shares[thread_params->out_keys_start + i] + CODEWORD_BYTES, cnc_computed_shares.get() + (num_check_auths + 2 * num_check_gates + current_check_gate_num) * CODEWORD_BYTES);
+      for (int current_check_gate_num = 0; current_check_gate_num < num_check_gates; ++current_check_gate_num) {
+        uint32_t i = gate_challenge.check_ids[current_check_gate_num];
+        check_gate_ids[current_check_gate_num] = exec_id * (thread_params->Q + thread_params->A) + thread_params->out_keys_start + i;
 
-          if (GetBit(current_check_gate_num, out_cnc_input)) {
-            XOR_CodeWords(cnc_computed_shares.get() + (num_check_auths + 2 * num_check_gates + current_check_gate_num) * CODEWORD_BYTES, commit_rec->commit_shares[thread_params->delta_pos]);
-          }
-          ++current_check_gate_num;
-        } else {
-          //Only write to num_eval_gates if it is not yet filled up. Might be wasteful, but easier to handle
-          if (current_eval_gate_num < thread_params->num_eval_gates) {
+        //Left
+        std::copy(commit_rec->commit_shares[thread_params->left_keys_start + i], commit_rec->commit_shares[thread_params->left_keys_start + i] + CODEWORD_BYTES, cnc_computed_shares.get() + (num_check_auths + current_check_gate_num) * CODEWORD_BYTES);
+        if (GetBit(current_check_gate_num, left_cnc_input.get())) {
+          XOR_CodeWords(cnc_computed_shares.get() + (num_check_auths + current_check_gate_num) * CODEWORD_BYTES, commit_rec->commit_shares[thread_params->delta_pos]);
+        }
+        //Right
+        std::copy(commit_rec->commit_shares[thread_params->right_keys_start + i], commit_rec->commit_shares[thread_params->right_keys_start + i] + CODEWORD_BYTES, cnc_computed_shares.get() + (num_check_auths + num_check_gates + current_check_gate_num) * CODEWORD_BYTES);
+        if (GetBit(current_check_gate_num, right_cnc_input)) {
+          XOR_CodeWords(cnc_computed_shares.get() + (num_check_auths + num_check_gates + current_check_gate_num) * CODEWORD_BYTES, commit_rec->commit_shares[thread_params->delta_pos]);
+        }
+        //Out
+        std::copy(commit_rec->commit_shares[thread_params->out_keys_start + i], commit_rec->commit_shares[thread_params->out_keys_start + i] + CODEWORD_BYTES, cnc_computed_shares.get() + (num_check_auths + 2 * num_check_gates + current_check_gate_num) * CODEWORD_BYTES);
 
-            int target_pos = permuted_eval_gates_ids[thread_params->num_eval_gates * exec_id + current_eval_gate_num];
-            std::copy(gates_data.T_G + i * CSEC_BYTES, gates_data.T_G + i * CSEC_BYTES + CSEC_BYTES, eval_gates.T_G + target_pos * CSEC_BYTES);
-            std::copy(gates_data.T_E + i * CSEC_BYTES, gates_data.T_E + i * CSEC_BYTES + CSEC_BYTES, eval_gates.T_E + target_pos * CSEC_BYTES);
-            std::copy(gates_data.S_O + i * CSEC_BYTES, gates_data.S_O + i * CSEC_BYTES + CSEC_BYTES, eval_gates.S_O + target_pos * CSEC_BYTES);
+        if (GetBit(current_check_gate_num, out_cnc_input)) {
+          XOR_CodeWords(cnc_computed_shares.get() + (num_check_auths + 2 * num_check_gates + current_check_gate_num) * CODEWORD_BYTES, commit_rec->commit_shares[thread_params->delta_pos]);
+        }
+      }
 
-            //Write the actual gate ID to eval_gates_ids in target_pos, which is determined by permuted_eval_gates_ids
-            eval_gates_ids[target_pos] = exec_id * (thread_params->Q + thread_params->A) + thread_params->out_keys_start + i;
-          } else {
-            //Development dirty check. Can be deleted once we have computed the correct slack bounds in params.
-            filled_eval_gates = true;
-          }
+      //All garbling data has to be received before the challenge is revealed
+      garbling_receives.WaitAll();
+      thread_params->chan.Send(cnc_seed, CSEC_BYTES);
 
-          ++current_eval_gate_num;
-        }
+      auto receive_gates_auths_end = GET_TIME();
+      durations[EVAL_RECEIVE_GATES_AUTHS_TIME][exec_id] = receive_gates_auths_end - receive_gates_auths_begin;
+
+      //Only the first num_eval_auths non-check auths are used. Might be wasteful, but easier to handle
+      uint32_t num_filled_eval_auths = std::min((uint64_t) auth_challenge.num_evals, thread_params->num_eval_auths);
+      for (uint32_t current_eval_auth_num = 0; current_eval_auth_num < num_filled_eval_auths; ++current_eval_auth_num) {
+        uint32_t i = auth_challenge.eval_ids[current_eval_auth_num];
+        uint32_t target_pos = permuted_eval_auths_ids[thread_params->num_eval_auths * exec_id + current_eval_auth_num];
+        std::copy(auths_data.H_0 + i * CSEC_BYTES, auths_data.H_0 + i * CSEC_BYTES + CSEC_BYTES, eval_auths.H_0 + target_pos * CSEC_BYTES);
+        std::copy(auths_data.H_1 + i * CSEC_BYTES, auths_data.H_1 + i * CSEC_BYTES + CSEC_BYTES, eval_auths.H_1 + target_pos * CSEC_BYTES);
+
+        //Write the actual auth ID to eval_gates_ids in target_pos, which is determined by permuted_eval_auths_ids
+        eval_auths_ids[target_pos] = exec_id * (thread_params->Q + thread_params->A) + thread_params->auth_start + i;
+      }
+
+      //Now for the gates
+      uint32_t num_filled_eval_gates = std::min((uint64_t) gate_challenge.num_evals, thread_params->num_eval_gates);
+      for (uint32_t current_eval_gate_num = 0; current_eval_gate_num < num_filled_eval_gates; ++current_eval_gate_num) {
+        uint32_t i = gate_challenge.eval_ids[current_eval_gate_num];
+        int target_pos = permuted_eval_gates_ids[thread_params->num_eval_gates * exec_id + current_eval_gate_num];
+        std::copy(gates_data.T_G + i * CSEC_BYTES, gates_data.T_G + i * CSEC_BYTES + CSEC_BYTES, eval_gates.T_G + target_pos * CSEC_BYTES);
+        std::copy(gates_data.T_E + i * CSEC_BYTES, gates_data.T_E + i * CSEC_BYTES + CSEC_BYTES, eval_gates.T_E + target_pos * CSEC_BYTES);
+        std::copy(gates_data.S_O + i * CSEC_BYTES, gates_data.S_O + i * CSEC_BYTES + CSEC_BYTES, eval_gates.S_O + target_pos * CSEC_BYTES);
+
+        //Write the actual gate ID to eval_gates_ids in target_pos, which is determined by permuted_eval_gates_ids
+        eval_gates_ids[target_pos] = exec_id * (thread_params->Q + thread_params->A) + thread_params->out_keys_start + i;
       }
 
       //Development dirty check. Can be deleted once we have computed the correct slack bounds in params.
-      if (!filled_eval_auths) {
+      if (auth_challenge.num_evals <= thread_params->num_eval_auths) {
         std::cout << "Exec_num: " << exec_id << " did not fill eval_auths" << std::endl;
         *ver_success = false;
       }
-      if (!filled_eval_gates) {
+      if (gate_challenge.num_evals <= thread_params->num_eval_gates) {
         std::cout << "Exec_num: " << exec_id << " did not fill eval_gates" << std::endl;
         *ver_success = false;
       }
@@ -475,6 +528,7 @@ void TinyEvaluator::Preprocess() {
     Params* thread_params = thread_params_vec[exec_id].get();
 
     pre_soldering_execs_finished[exec_id] = thread_pool.push([this, thread_params, exec_id, ver_success, inp_from, inp_to, ga_inp_from, ga_inp_to, ga_from, ga_to, &eval_gates_to_blocks, &eval_auths_to_blocks] (int id) {
+      NodePin pin(NumaTopology::Get().NodeOfExec(exec_id, params.num_execs));
 
       int num_gates = thread_params->num_pre_gates;
       int num_inputs = thread_params->num_pre_inputs;
@@ -486,7 +540,7 @@ void TinyEvaluator::Preprocess() {
       int num_pre_solderings = 3 * num_gate_solderings + num_auth_solderings + num_inp_auth_solderings;
 
       //Receive all preprocessed soldering data and point into this for convenience
-      std::unique_ptr<uint8_t[]> decommited_pre_solderings(std::make_unique<uint8_t[]>(num_pre_solderings * CSEC_BYTES));
+      std::unique_ptr<uint8_t[]> decommited_pre_solderings(MakeLarge<uint8_t>(num_pre_solderings * CSEC_BYTES));
       thread_params->chan.ReceiveBlocking(decommited_pre_solderings.get(), num_pre_solderings * CSEC_BYTES);
 
       uint8_t* left_wire_solderings = decommited_pre_solderings.get();
@@ -706,8 +760,8 @@ void TinyEvaluator::Preprocess() {
     thread_params->chan.ResetReceivedBytes();
     thread_params->chan.ResetSentBytes();
   }
-  cout << "OT Received " << ot_rec.net.m_vSocket->getRcvCnt() << " bytes" << endl;
-  cout << "OT Sent " << ot_rec.net.m_vSocket->getSndCnt() << " bytes" << endl;
+  cout << "OT Received " << ot_rec.net.GetBytesReceived() << " bytes" << endl;
+  cout << "OT Sent " << ot_rec.net.GetBytesSent() << " bytes" << endl;
 
   std::cout << "Received " << bytes_received << " Bytes" << std::endl;
   std::cout << "Sent " << bytes_sent << " Bytes" << std::endl;
@@ -732,161 +786,315 @@ void TinyEvaluator::Preprocess() {
 #endif
 }
 
-void TinyEvaluator::Offline(std::vector<Circuit*>& circuits, int top_num_execs) {
-  // int top_num_execs = std::min((int)circuits.size(), params.num_execs);
-  std::vector<std::future<void>> top_soldering_execs_finished(top_num_execs);
-  std::vector<std::unique_ptr<bool>> thread_ver_successes;
+void TinyEvaluator::AddExecs(int num_extra_execs) {
+  num_added_execs += num_extra_execs;
+  if (!thread_params_vec.empty()) {
+    CreateExecs(num_extra_execs);
+  }
+}
 
-  //Split the number of preprocessed gates and inputs into top_num_execs executions
-  std::vector<int> circuits_from, circuits_to;
-  PartitionBufferFixedNum(circuits_from, circuits_to, top_num_execs, circuits.size());
-
-  int num_gates_needed = 0;
-  int num_inp_gates_needed = 0;
-  int num_inps_needed = 0;
-  int num_outs_needed = 0;
-  for (int i = 0; i < circuits.size(); ++i) {
-    gates_offset.emplace_back(num_gates_used + num_gates_needed);
-    inp_gates_offset.emplace_back(num_inputs_used / 2 + num_inp_gates_needed);
-    inputs_offset.emplace_back(num_inputs_used + num_inps_needed);
-    outputs_offset.emplace_back(num_outputs_used + num_outs_needed);
-    num_gates_needed += circuits[i]->num_and_gates;
-    num_inp_gates_needed += circuits[i]->num_const_inp_wires / 2;
-    num_inps_needed += circuits[i]->num_inp_wires;
-    num_outs_needed += circuits[i]->num_out_wires;
+void TinyEvaluator::CreateExecs(int num_new_execs) {
+  int num_current_execs = thread_params_vec.size();
+  if (num_current_execs + num_new_execs > BATCH_CHAN_STRIDE) {
+    throw std::runtime_error("More execs than channels reserved pr. batch");
   }
 
-  if ((params.num_pre_gates - num_gates_used) < num_gates_needed) {
-    throw std::runtime_error("Not enough garbled gates");
-  } else {
-    num_gates_used += num_gates_needed;
+  uint32_t first_chan = thread_params_vec[0]->exec_id + num_current_execs;
+  std::unique_ptr<uint8_t[]> extra_thread_seeds(std::make_unique<uint8_t[]>(num_new_execs * CSEC_BYTES));
+  params.rnd.GenRnd(extra_thread_seeds.get(), num_new_execs * CSEC_BYTES);
+  for (int i = 0; i < num_new_execs; ++i) {
+    thread_params_vec.emplace_back(std::make_unique<Params>(params, extra_thread_seeds.get() + i * CSEC_BYTES, thread_params_vec[0]->num_pre_gates, thread_params_vec[0]->num_pre_inputs, thread_params_vec[0]->num_pre_outputs, first_chan + i));
+    commit_recs.emplace_back(std::make_unique<CommitReceiver>(*thread_params_vec[num_current_execs + i], rot_seeds.get(), rot_choices.get()));
   }
+}
 
-  //Due to the way we choose our parameters, if there are enough num_inps, then there are also enough for inp_gates.
-  if ((params.num_pre_inputs - num_inputs_used) < num_inps_needed) {
-    throw std::runtime_error("Not enough input authenticators");
-  } else {
-    num_inputs_used += num_inps_needed;
+int TinyEvaluator::GetNumQueuedBatches() {
+  std::lock_guard<std::mutex> lock(batches_mutex);
+  return queued_batches.size();
+}
+
+void TinyEvaluator::ActivateNextBatch() {
+  {
+    std::lock_guard<std::mutex> lock(batches_mutex);
+    SwapBatch(*queued_batches.front());
+    queued_batches.pop_front();
+    ++num_activated;
   }
+  batches_changed.notify_all();
 
-  if ((params.num_pre_outputs - num_outputs_used) < num_outs_needed) {
-    throw std::runtime_error("Not enough output wires");
-  } else {
-    num_outputs_used += num_outs_needed;
+  num_gates_used = 0;
+  num_inputs_used = 0;
+  num_outputs_used = 0;
+
+  int num_missing_execs = params.num_execs + num_added_execs - thread_params_vec.size();
+  if (num_missing_execs > 0) {
+    CreateExecs(num_missing_execs);
   }
+}
 
-  //Setup maps from eval_gates and eval_auths to commit_block and inner block commit index. Needed to construct decommits that span all executions
-  IDMap eval_gates_to_blocks(eval_gates_ids, thread_params_vec[0]->Q + thread_params_vec[0]->A, thread_params_vec[0]->out_keys_start);
-  IDMap eval_auths_to_blocks(eval_auths_ids, thread_params_vec[0]->Q + thread_params_vec[0]->A, thread_params_vec[0]->auth_start);
+void TinyEvaluator::CreateProducer(int num_threads) {
+  std::unique_ptr<uint8_t[]> producer_seed(std::make_unique<uint8_t[]>(CSEC_BYTES));
+  params.rnd.GenRnd(producer_seed.get(), CSEC_BYTES);
+  producer_params = std::make_unique<Params>(params, producer_seed.get(), params.num_pre_gates, params.num_pre_inputs, params.num_pre_outputs, PRODUCER_PARAMS_CHAN);
+  producer = std::make_unique<TinyEvaluator>(*producer_params);
+  producer->thread_pool.resize(num_threads);
 
-  auto topo_soldering_begin = GET_TIME();
-  for (int exec_id = 0; exec_id < top_num_execs; ++exec_id) {
-    int circ_from = circuits_from[exec_id];
-    int circ_to = circuits_to[exec_id];
-    Params* thread_params = thread_params_vec[exec_id].get();
-    thread_ver_successes.emplace_back(std::make_unique<bool>(true));
-    bool* ver_success = thread_ver_successes[exec_id].get();
+  //Normally set by Preprocess, which this instance never runs
+  rot_start_pos = params.num_OT - CODEWORD_BITS;
+}
 
-    top_soldering_execs_finished[exec_id] = thread_pool.push([this, thread_params, exec_id, circ_from, circ_to, &circuits, &eval_gates_to_blocks, &eval_auths_to_blocks, ver_success] (int id) {
+void TinyEvaluator::ProduceBatch() {
+  if (num_produced == 0) {
+    producer->Setup();
+  }
 
-      for (int c = circ_from; c < circ_to; ++c) {
-        Circuit* circuit = circuits[c];
-        int gate_offset = gates_offset[c];
-        int inp_gate_offset = inp_gates_offset[c];
-        int inp_offset = inputs_offset[c];
-        int num_top_solderings = 2 * circuit->num_and_gates + circuit->num_const_inp_wires; //the 2* factor cancels out as we can check two inputs pr. input bucket.
-
-        std::unique_ptr<uint8_t[]> topsolder_computed_shares(std::make_unique<uint8_t[]>(num_top_solderings * CODEWORD_BYTES + circuit->num_wires * CODEWORD_BYTES));
-        uint8_t* topsolder_computed_shares_tmp = topsolder_computed_shares.get() + num_top_solderings * CODEWORD_BYTES;
-
-        int curr_auth_inp_head_pos, curr_inp_head_block, curr_inp_head_idx, curr_head_pos, curr_head_block, curr_head_idx;
-        for (int i = 0; i < circuit->num_inp_wires; ++i) {
-          curr_auth_inp_head_pos = params.num_pre_gates * thread_params->num_auth + (inp_offset + i) * thread_params->num_inp_auth;
-          eval_auths_to_blocks.GetExecIDAndIndex(curr_auth_inp_head_pos, curr_inp_head_block, curr_inp_head_idx);
-
-          //Build decommit_info
-          std::copy(commit_recs[curr_inp_head_block]->commit_shares[thread_params->auth_start + curr_inp_head_idx], commit_recs[curr_inp_head_block]->commit_shares[thread_params->auth_start + curr_inp_head_idx] + CODEWORD_BYTES, topsolder_computed_shares_tmp + i * CODEWORD_BYTES);
-        }
+  //Must match the slot the constructor's producer uses for the same batch
+  uint32_t chan_offset = BATCH_CHAN_STRIDE * (1 + num_produced % NUM_BATCH_CHAN_SLOTS);
+  SetBackgroundExecs(chan_offset, true);
+  producer->exec_chan_offset = chan_offset;
+  producer->InitBatch();
+  producer->params.rnd.GenRnd(producer->thread_seeds.get(), CSEC_BYTES * params.num_execs);
+  producer->PreprocessBatch();
+  SetBackgroundExecs(chan_offset, false);
+
+  //The DOT outputs move along with the batch, so the producer's next ot_rec.Receive writes into the fresh buffers of InitBatch
+  std::unique_ptr<Batch> batch(std::make_unique<Batch>());
+  producer->SwapBatch(*batch);
+  {
+    std::lock_guard<std::mutex> lock(batches_mutex);
+    queued_batches.emplace_back(std::move(batch));
+    ++num_produced;
+    ++num_preprocessed;
+  }
+  batches_changed.notify_all();
+}
 
-        int left_inp_start = circuit->num_and_gates;
-        int right_inp_start = 2 * circuit->num_and_gates + circuit->num_const_inp_wires / 2;
-        for (int i = 0; i < circuit->num_const_inp_wires / 2; ++i) {
-          curr_head_pos = params.num_pre_gates * params.num_bucket + (inp_gate_offset + i) * params.num_inp_bucket;
-          eval_gates_to_blocks.GetExecIDAndIndex(curr_head_pos, curr_head_block, curr_head_idx);
+uint64_t TinyEvaluator::EvalDataSize() {
+  return 5 * CSEC_BYTES * params.num_eval_gates + 3 * CSEC_BYTES * params.num_eval_auths;
+}
 
-          std::copy(commit_recs[curr_head_block]->commit_shares[thread_params->left_keys_start + curr_head_idx], commit_recs[curr_head_block]->commit_shares[thread_params->left_keys_start + curr_head_idx] + CODEWORD_BYTES, topsolder_computed_shares.get() + (left_inp_start + i) * CODEWORD_BYTES);
-          XOR_CodeWords(topsolder_computed_shares.get() + (left_inp_start + i) * CODEWORD_BYTES, topsolder_computed_shares_tmp + i * CODEWORD_BYTES);
-          std::copy(commit_recs[curr_head_block]->commit_shares[thread_params->right_keys_start + curr_head_idx], commit_recs[curr_head_block]->commit_shares[thread_params->right_keys_start + curr_head_idx] + CODEWORD_BYTES, topsolder_computed_shares.get() + (right_inp_start + i) * CODEWORD_BYTES);
-          XOR_CodeWords(topsolder_computed_shares.get() + (right_inp_start + i) * CODEWORD_BYTES, topsolder_computed_shares_tmp + (circuit->num_const_inp_wires / 2 + i) * CODEWORD_BYTES);
-        }
+void TinyEvaluator::SavePreprocessed(std::string path) {
+  PreprocessedWriter writer(path);
+  WritePreprocessedHeader(writer);
 
-        int curr_and_gate = 0;
-        int left_gate_start = 0;
-        int right_gate_start = circuit->num_and_gates + circuit->num_const_inp_wires / 2;
-        for (int i = 0; i < circuit->num_gates; ++i) {
-          Gate g = circuit->gates[i];
-          if (g.type == NOT) {
-            //Build decommit_info
-            std::copy(topsolder_computed_shares_tmp + g.left_wire * CODEWORD_BYTES, topsolder_computed_shares_tmp + g.left_wire * CODEWORD_BYTES + CODEWORD_BYTES, topsolder_computed_shares_tmp + g.out_wire * CODEWORD_BYTES);
+  SaveBatch(writer);
+  for (std::unique_ptr<Batch>& batch : queued_batches) {
+    SwapBatch(*batch);
+    SaveBatch(writer);
+    SwapBatch(*batch);
+  }
+}
 
-            XOR_CodeWords(topsolder_computed_shares_tmp + g.out_wire * CODEWORD_BYTES, commit_recs[0]->commit_shares[thread_params->delta_pos]);
+void TinyEvaluator::LoadPreprocessed(std::string path) {
+  PreprocessedReader reader(path);
+  int num_batches = ReadPreprocessedHeader(reader);
+  rot_start_pos = params.num_OT - CODEWORD_BITS;
 
-          } else if (g.type == XOR) {
-            //Build decommit_info
-            std::copy(topsolder_computed_shares_tmp + g.left_wire * CODEWORD_BYTES, topsolder_computed_shares_tmp + g.left_wire * CODEWORD_BYTES + CODEWORD_BYTES, topsolder_computed_shares_tmp + g.out_wire * CODEWORD_BYTES);
+  //Load every batch into the queue and then make the first one active
+  for (int b = 0; b < num_batches; ++b) {
+    InitBatch(false);
+    LoadBatch(reader);
+    queued_batches.emplace_back(std::make_unique<Batch>());
+    SwapBatch(*queued_batches.back());
+  }
+  SwapBatch(*queued_batches.front());
+  queued_batches.pop_front();
+  num_preprocessed = num_batches;
+}
 
-            XOR_CodeWords(topsolder_computed_shares_tmp + g.out_wire * CODEWORD_BYTES, topsolder_computed_shares_tmp + g.right_wire * CODEWORD_BYTES);
+void TinyEvaluator::SaveBatch(PreprocessedWriter& writer) {
+  WriteThreadParams(writer);
+  writer.Write(rot_seeds.get(), CODEWORD_BITS * CSEC_BYTES);
+  writer.Write(rot_choices.get(), BITS_TO_BYTES(CODEWORD_BITS));
+  writer.Write(verleak_bits.get(), BITS_TO_BYTES(params.num_pre_outputs + params.num_pre_inputs));
+  writer.Write(ot_rec.choices_outer.get(), BITS_TO_BYTES(params.num_OT));
+  writer.Write(ot_rec.response_outer.get(), params.num_OT * CSEC_BYTES);
+  writer.WriteAligned(raw_eval_ids.get(), (params.num_eval_gates + params.num_eval_auths) * sizeof(uint32_t));
+  writer.WriteAligned(raw_eval_data.get(), EvalDataSize());
 
-          } else if (g.type == AND) {
-            curr_head_pos = (gate_offset + curr_and_gate) * thread_params->num_bucket;
-            eval_gates_to_blocks.GetExecIDAndIndex(curr_head_pos, curr_head_block, curr_head_idx);
-            //Build decommit_info
-            std::copy(commit_recs[curr_head_block]->commit_shares[thread_params->out_keys_start + curr_head_idx], commit_recs[curr_head_block]->commit_shares[thread_params->out_keys_start + curr_head_idx] + CODEWORD_BYTES, topsolder_computed_shares_tmp + g.out_wire * CODEWORD_BYTES);
+  for (int exec_id = 0; exec_id < params.num_execs; ++exec_id) {
+    writer.Write<int>(commit_recs[exec_id]->num_chosen_commits);
+    writer.Write(commit_recs[exec_id]->chosen_commit_values.get(), commit_recs[exec_id]->num_chosen_commits * CSEC_BYTES);
+    writer.WriteBlocks(commit_recs[exec_id]->matrices, commit_recs[exec_id]->num_blocks, commit_recs[exec_id]->transpose_matrix_size);
+  }
+  for (int exec_id = 0; exec_id < params.num_execs; ++exec_id) {
+    writer.WriteShares(commit_recs[exec_id]->commit_shares);
+  }
+}
 
-            std::copy(commit_recs[curr_head_block]->commit_shares[thread_params->left_keys_start + curr_head_idx], commit_recs[curr_head_block]->commit_shares[thread_params->left_keys_start + curr_head_idx] + CODEWORD_BYTES, topsolder_computed_shares.get() + (left_gate_start + curr_and_gate) * CODEWORD_BYTES);
+void TinyEvaluator::LoadBatch(PreprocessedReader& reader) {
+  ReadThreadParams(reader);
+  reader.Read(rot_seeds.get(), CODEWORD_BITS * CSEC_BYTES);
+  reader.Read(rot_choices.get(), BITS_TO_BYTES(CODEWORD_BITS));
+  reader.Read(verleak_bits.get(), BITS_TO_BYTES(params.num_pre_outputs + params.num_pre_inputs));
+  reader.Read(ot_rec.choices_outer.get(), BITS_TO_BYTES(params.num_OT));
+  reader.Read(ot_rec.response_outer.get(), params.num_OT * CSEC_BYTES);
+  uint64_t ids_bytes = (params.num_eval_gates + params.num_eval_auths) * sizeof(uint32_t);
+  uint8_t* ids = reader.ReadAligned(ids_bytes);
+  std::copy(ids, ids + ids_bytes, (uint8_t*) raw_eval_ids.get());
+
+  //The garbled gates are by far the largest part, so they are used directly from the mapping
+  raw_eval_data = std::shared_ptr<uint8_t>(reader.mapping, reader.ReadAligned(EvalDataSize()));
+  SetEvalPointers();
+
+  for (int exec_id = 0; exec_id < (int) thread_params_vec.size(); ++exec_id) {
+    commit_recs.emplace_back(std::make_unique<CommitReceiver>(*thread_params_vec[exec_id], rot_seeds.get(), rot_choices.get()));
+    CommitReceiver* commit_rec = commit_recs[exec_id].get();
+    commit_rec->num_chosen_commits = reader.Read<int>();
+    commit_rec->chosen_commit_values = std::make_unique<uint8_t[]>(commit_rec->num_chosen_commits * CSEC_BYTES);
+    reader.Read(commit_rec->chosen_commit_values.get(), commit_rec->num_chosen_commits * CSEC_BYTES);
+    reader.SkipBlocks();
+  }
+  for (std::unique_ptr<CommitReceiver>& commit_rec : commit_recs) {
+    reader.ReadShares(commit_rec->commit_shares);
+    commit_rec->num_commits_produced = commit_rec->commit_shares.size();
+  }
+  mapping = reader.mapping;
+}
 
-            std::copy(commit_recs[curr_head_block]->commit_shares[thread_params->right_keys_start + curr_head_idx], commit_recs[curr_head_block]->commit_shares[thread_params->right_keys_start + curr_head_idx] + CODEWORD_BYTES, topsolder_computed_shares.get() + (right_gate_start + curr_and_gate) * CODEWORD_BYTES);
+//Returns false if the decommitment of the solderings failed. The solderings are applied either way
+bool TinyEvaluator::SolderCircuit(Params* thread_params, int exec_id, int c, std::vector<Circuit*>& circuits, IDMap& eval_gates_to_blocks, IDMap& eval_auths_to_blocks) {
+  Circuit* circuit = circuits[c];
+  int gate_offset = gates_offset[c];
+  int inp_gate_offset = inp_gates_offset[c];
+  int inp_offset = inputs_offset[c];
+  int num_top_solderings = 2 * circuit->num_and_gates + circuit->num_const_inp_wires; //the 2* factor cancels out as we can check two inputs pr. input bucket.
+
+  //Every row is written with a copy before it is XOR'ed into, so the arena's uninitialized memory is fine
+  ExecArena* arena = exec_arenas[exec_id].get();
+  arena->Reset();
+  uint8_t* topsolder_computed_shares = arena->Alloc<uint8_t>(num_top_solderings * CODEWORD_BYTES + circuit->num_wires * CODEWORD_BYTES);
+  uint8_t* topsolder_computed_shares_tmp = topsolder_computed_shares + num_top_solderings * CODEWORD_BYTES;
+
+  int curr_auth_inp_head_pos, curr_inp_head_block, curr_inp_head_idx, curr_head_pos, curr_head_block, curr_head_idx;
+  for (int i = 0; i < (int) circuit->num_inp_wires; ++i) {
+    curr_auth_inp_head_pos = params.num_pre_gates * thread_params->num_auth + (inp_offset + i) * thread_params->num_inp_auth;
+    eval_auths_to_blocks.GetExecIDAndIndex(curr_auth_inp_head_pos, curr_inp_head_block, curr_inp_head_idx);
+
+    //Build decommit_info
+    std::copy(commit_recs[curr_inp_head_block]->commit_shares[thread_params->auth_start + curr_inp_head_idx], commit_recs[curr_inp_head_block]->commit_shares[thread_params->auth_start + curr_inp_head_idx] + CODEWORD_BYTES, topsolder_computed_shares_tmp + i * CODEWORD_BYTES);
+  }
 
-            XOR_CodeWords(topsolder_computed_shares.get() + (left_gate_start + curr_and_gate) * CODEWORD_BYTES, topsolder_computed_shares_tmp + g.left_wire * CODEWORD_BYTES);
+  int left_inp_start = circuit->num_and_gates;
+  int right_inp_start = 2 * circuit->num_and_gates + circuit->num_const_inp_wires / 2;
+  for (int i = 0; i < (int) circuit->num_const_inp_wires / 2; ++i) {
+    curr_head_pos = params.num_pre_gates * params.num_bucket + (inp_gate_offset + i) * params.num_inp_bucket;
+    eval_gates_to_blocks.GetExecIDAndIndex(curr_head_pos, curr_head_block, curr_head_idx);
 
-            XOR_CodeWords(topsolder_computed_shares.get() + (right_gate_start + curr_and_gate) * CODEWORD_BYTES, topsolder_computed_shares_tmp + g.right_wire * CODEWORD_BYTES);
+    std::copy(commit_recs[curr_head_block]->commit_shares[thread_params->left_keys_start + curr_head_idx], commit_recs[curr_head_block]->commit_shares[thread_params->left_keys_start + curr_head_idx] + CODEWORD_BYTES, topsolder_computed_shares + (left_inp_start + i) * CODEWORD_BYTES);
+    XOR_CodeWords(topsolder_computed_shares + (left_inp_start + i) * CODEWORD_BYTES, topsolder_computed_shares_tmp + i * CODEWORD_BYTES);
+    std::copy(commit_recs[curr_head_block]->commit_shares[thread_params->right_keys_start + curr_head_idx], commit_recs[curr_head_block]->commit_shares[thread_params->right_keys_start + curr_head_idx] + CODEWORD_BYTES, topsolder_computed_shares + (right_inp_start + i) * CODEWORD_BYTES);
+    XOR_CodeWords(topsolder_computed_shares + (right_inp_start + i) * CODEWORD_BYTES, topsolder_computed_shares_tmp + (circuit->num_const_inp_wires / 2 + i) * CODEWORD_BYTES);
+  }
 
-            ++curr_and_gate;
-          }
-        }
+  int curr_and_gate = 0;
+  int left_gate_start = 0;
+  int right_gate_start = circuit->num_and_gates + circuit->num_const_inp_wires / 2;
+  for (int i = 0; i < (int) circuit->num_gates; ++i) {
+    Gate g = circuit->gates[i];
+    if (g.type == NOT) {
+      //Build decommit_info
+      std::copy(topsolder_computed_shares_tmp + g.left_wire * CODEWORD_BYTES, topsolder_computed_shares_tmp + g.left_wire * CODEWORD_BYTES + CODEWORD_BYTES, topsolder_computed_shares_tmp + g.out_wire * CODEWORD_BYTES);
 
-        std::unique_ptr<uint8_t[]> topological_solderings(std::make_unique<uint8_t[]>(num_top_solderings * CSEC_BYTES));
+      XOR_CodeWords(topsolder_computed_shares_tmp + g.out_wire * CODEWORD_BYTES, commit_recs[0]->commit_shares[thread_params->delta_pos]);
 
-        thread_params->chan.ReceiveBlocking(topological_solderings.get(), num_top_solderings * CSEC_BYTES);
-        if (!commit_recs[exec_id]->BatchDecommit(topsolder_computed_shares.get(), num_top_solderings, topological_solderings.get())) {
-          *ver_success = false;
-          std::cout << "Topological soldering decommit failed" << std::endl;
-        }
+    } else if (g.type == XOR) {
+      //Build decommit_info
+      std::copy(topsolder_computed_shares_tmp + g.left_wire * CODEWORD_BYTES, topsolder_computed_shares_tmp + g.left_wire * CODEWORD_BYTES + CODEWORD_BYTES, topsolder_computed_shares_tmp + g.out_wire * CODEWORD_BYTES);
 
-        for (int i = 0; i < circuit->num_and_gates; ++i) {
-          for (int j = 0; j < thread_params->num_bucket; ++j) {
-            curr_head_pos = (gate_offset + i) * thread_params->num_bucket + j;
-            XOR_128(eval_gates.S_L + curr_head_pos * CSEC_BYTES, topological_solderings.get() + (left_gate_start + i) * CSEC_BYTES);
+      XOR_CodeWords(topsolder_computed_shares_tmp + g.out_wire * CODEWORD_BYTES, topsolder_computed_shares_tmp + g.right_wire * CODEWORD_BYTES);
 
-            XOR_128(eval_gates.S_R + curr_head_pos * CSEC_BYTES, topological_solderings.get() + (right_gate_start + i) * CSEC_BYTES);
-          }
-        }
+    } else if (g.type == AND) {
+      curr_head_pos = (gate_offset + curr_and_gate) * thread_params->num_bucket;
+      eval_gates_to_blocks.GetExecIDAndIndex(curr_head_pos, curr_head_block, curr_head_idx);
+      //Build decommit_info
+      std::copy(commit_recs[curr_head_block]->commit_shares[thread_params->out_keys_start + curr_head_idx], commit_recs[curr_head_block]->commit_shares[thread_params->out_keys_start + curr_head_idx] + CODEWORD_BYTES, topsolder_computed_shares_tmp + g.out_wire * CODEWORD_BYTES);
 
-        for (int i = 0; i < circuit->num_const_inp_wires / 2; ++i) {
-          for (int j = 0; j < thread_params->num_inp_bucket; ++j) {
-            curr_head_pos = params.num_pre_gates * params.num_bucket + (inp_gate_offset + i) * params.num_inp_bucket;
-            XOR_128(eval_gates.S_L + (curr_head_pos + j) * CSEC_BYTES, topological_solderings.get() + (left_inp_start + i) * CSEC_BYTES);
+      std::copy(commit_recs[curr_head_block]->commit_shares[thread_params->left_keys_start + curr_head_idx], commit_recs[curr_head_block]->commit_shares[thread_params->left_keys_start + curr_head_idx] + CODEWORD_BYTES, topsolder_computed_shares + (left_gate_start + curr_and_gate) * CODEWORD_BYTES);
 
-            XOR_128(eval_gates.S_R + (curr_head_pos + j) * CSEC_BYTES, topological_solderings.get() + (right_inp_start + i) * CSEC_BYTES);
-          }
+      std::copy(commit_recs[curr_head_block]->commit_shares[thread_params->right_keys_start + curr_head_idx], commit_recs[curr_head_block]->commit_shares[thread_params->right_keys_start + curr_head_idx] + CODEWORD_BYTES, topsolder_computed_shares + (right_gate_start + curr_and_gate) * CODEWORD_BYTES);
+
+      XOR_CodeWords(topsolder_computed_shares + (left_gate_start + curr_and_gate) * CODEWORD_BYTES, topsolder_computed_shares_tmp + g.left_wire * CODEWORD_BYTES);
+
+      XOR_CodeWords(topsolder_computed_shares + (right_gate_start + curr_and_gate) * CODEWORD_BYTES, topsolder_computed_shares_tmp + g.right_wire * CODEWORD_BYTES);
+
+      ++curr_and_gate;
+    }
+  }
+
+  uint8_t* topological_solderings = arena->Alloc<uint8_t>(num_top_solderings * CSEC_BYTES);
+
+  thread_params->chan.ReceiveBlocking(topological_solderings, num_top_solderings * CSEC_BYTES);
+  bool ver_success = commit_recs[exec_id]->BatchDecommit(topsolder_computed_shares, num_top_solderings, topological_solderings);
+  if (!ver_success) {
+    std::cout << "Topological soldering decommit failed" << std::endl;
+  }
+
+  for (int i = 0; i < (int) circuit->num_and_gates; ++i) {
+    for (int j = 0; j < thread_params->num_bucket; ++j) {
+      curr_head_pos = (gate_offset + i) * thread_params->num_bucket + j;
+      XOR_128(eval_gates.S_L + curr_head_pos * CSEC_BYTES, topological_solderings + (left_gate_start + i) * CSEC_BYTES);
+
+      XOR_128(eval_gates.S_R + curr_head_pos * CSEC_BYTES, topological_solderings + (right_gate_start + i) * CSEC_BYTES);
+    }
+  }
+
+  for (int i = 0; i < (int) circuit->num_const_inp_wires / 2; ++i) {
+    for (int j = 0; j < thread_params->num_inp_bucket; ++j) {
+      curr_head_pos = params.num_pre_gates * params.num_bucket + (inp_gate_offset + i) * params.num_inp_bucket;
+      XOR_128(eval_gates.S_L + (curr_head_pos + j) * CSEC_BYTES, topological_solderings + (left_inp_start + i) * CSEC_BYTES);
+
+      XOR_128(eval_gates.S_R + (curr_head_pos + j) * CSEC_BYTES, topological_solderings + (right_inp_start + i) * CSEC_BYTES);
+    }
+  }
+  return ver_success;
+}
+
+uint64_t TinyEvaluator::SolderScratchBytes(Circuit* circuit) {
+  uint64_t num_top_solderings = 2 * circuit->num_and_gates + circuit->num_const_inp_wires;
+  return ExecArena::SliceBytes(num_top_solderings * CODEWORD_BYTES + circuit->num_wires * CODEWORD_BYTES) + ExecArena::SliceBytes(num_top_solderings * CSEC_BYTES);
+}
+
+void TinyEvaluator::Offline(std::vector<Circuit*>& circuits, int top_num_execs) {
+  ReserveCircuits(circuits);
+
+  std::vector<int> circuits_from, circuits_to;
+  int num_tasks = SplitCircuits(circuits, top_num_execs, circuits_from, circuits_to);
+  EnsureExecs(num_tasks);
+  std::vector<std::future<void>> top_soldering_execs_finished(num_tasks);
+  std::vector<std::unique_ptr<bool>> thread_ver_successes;
+
+  //Setup maps from eval_gates and eval_auths to commit_block and inner block commit index. Needed to construct decommits that span all executions
+  IDMap eval_gates_to_blocks(eval_gates_ids, thread_params_vec[0]->Q + thread_params_vec[0]->A, thread_params_vec[0]->out_keys_start);
+  IDMap eval_auths_to_blocks(eval_auths_ids, thread_params_vec[0]->Q + thread_params_vec[0]->A, thread_params_vec[0]->auth_start);
+
+  auto topo_soldering_begin = GET_TIME();
+  for (int exec_id = 0; exec_id < num_tasks; ++exec_id) {
+    int circ_from = circuits_from[exec_id];
+    int circ_to = circuits_to[exec_id];
+    Params* thread_params = thread_params_vec[exec_id].get();
+    thread_ver_successes.emplace_back(std::make_unique<bool>(true));
+    bool* ver_success = thread_ver_successes[exec_id].get();
+
+    top_soldering_execs_finished[exec_id] = thread_pool.push([this, thread_params, exec_id, num_tasks, circ_from, circ_to, &circuits, &eval_gates_to_blocks, &eval_auths_to_blocks, ver_success] (int id) {
+      NodePin pin(NumaTopology::Get().NodeOfExec(exec_id, num_tasks));
+      ReserveSolderArena(exec_id, circuits, circ_from, circ_to);
+
+      for (int c = circ_from; c < circ_to; ++c) {
+        if (!SolderCircuit(thread_params, exec_id, c, circuits, eval_gates_to_blocks, eval_auths_to_blocks)) {
+          *ver_success = false;
         }
       }
     });
   }
 
+  //All execs have to finish before a failure in one of them is passed on, as they use the maps above
   for (std::future<void>& r : top_soldering_execs_finished) {
     r.wait();
   }
+  for (std::future<void>& r : top_soldering_execs_finished) {
+    r.get();
+  }
   auto topo_soldering_end = GET_TIME();
 
   for (std::unique_ptr<bool>& b : thread_ver_successes) {
@@ -917,292 +1125,325 @@ void TinyEvaluator::Offline(std::vector<Circuit*>& circuits, int top_num_execs)
 #endif
 }
 
-void TinyEvaluator::Online(std::vector<Circuit*>& circuits, std::vector<uint8_t*>& inputs, std::vector<uint8_t*>& outputs, int eval_num_execs) {
-
-  std::vector<std::future<void>> online_execs_finished(eval_num_execs);
-  std::vector<int> circuits_from, circuits_to;
-
-  PartitionBufferFixedNum(circuits_from, circuits_to, eval_num_execs, circuits.size());
-
-  IDMap eval_auths_to_blocks(eval_auths_ids, thread_params_vec[0]->Q + thread_params_vec[0]->A, thread_params_vec[0]->auth_start);
-  IDMap eval_gates_to_blocks(eval_gates_ids, thread_params_vec[0]->Q + thread_params_vec[0]->A, thread_params_vec[0]->out_keys_start);
+//See TinyConstructor::OnlineBatch for the batching
+void TinyEvaluator::OnlineBatch(Params* thread_params, int exec_id, int batch_from, int batch_to, std::vector<Circuit*>& circuits, std::vector<uint8_t*>& inputs, std::vector<uint8_t*>& outputs, IDMap& eval_gates_to_blocks, IDMap& eval_auths_to_blocks) {
+  Circuit* circuit;
+  Gate g;
+  uint8_t* eval_input;
+  uint8_t* eval_outputs;
+  uint8_t* const_inp_keys;
+  uint8_t* eval_inp_keys;
+  uint8_t* out_decommit_values;
+  uint8_t* eval_computed_shares_inp;
+  uint8_t* eval_computed_shares_out;
+  uint8_t* decommit_shares_inp_0;
+  uint8_t* decommit_shares_inp_1;
+  uint8_t* decommit_shares_out_0;
+  uint8_t* decommit_shares_out_1;
+  uint8_t* e;
+  __m128i intrin_outs[thread_params->num_bucket];
+  __m128i intrin_auths[thread_params->num_auth];
+  int bucket_score[thread_params->num_bucket];
+  bool all_equal;
+
+  int gate_offset, inp_gate_offset, inp_offset, out_offset, curr_and_gate;
+  int curr_auth_inp_head_pos, curr_inp_head_block, curr_inp_head_idx, curr_head_pos, curr_output_pos, curr_output_block, curr_output_idx;
+
+  GarblingHandler gh(*thread_params);
+  int curr_input, curr_output, ot_commit_block, commit_id, chosen_val_id;
+
+  uint64_t num_batch_e_bytes = 0;
+  uint64_t num_batch_receiving_bytes = 0;
+  uint64_t max_online_buf_bytes = 0;
+  uint64_t max_wires = 0;
+  for (int c = batch_from; c < batch_to; ++c) {
+    num_batch_e_bytes += BITS_TO_BYTES(circuits[c]->num_eval_inp_wires);
+    num_batch_receiving_bytes += circuits[c]->num_const_inp_wires * CSEC_BYTES + (circuits[c]->num_eval_inp_wires + circuits[c]->num_out_wires) * (CODEWORD_BYTES + CSEC_BYTES);
+    max_online_buf_bytes = std::max(max_online_buf_bytes, (uint64_t) (circuits[c]->num_eval_inp_wires + circuits[c]->num_out_wires) * (CODEWORD_BYTES + CSEC_BYTES));
+    max_wires = std::max(max_wires, (uint64_t) circuits[c]->num_wires);
+  }
 
-  for (int exec_id = 0; exec_id < eval_num_execs; ++exec_id) {
+  //The pr. circuit buffers are sized for the largest circuit of the batch and reused by all of them
+  ExecArena* arena = exec_arenas[exec_id].get();
+  arena->Reset();
+  uint8_t* batch_e = arena->Alloc<uint8_t>(num_batch_e_bytes);
+  uint8_t* batch_received = arena->Alloc<uint8_t>(num_batch_receiving_bytes);
+  uint8_t* online_buf = arena->Alloc<uint8_t>(max_online_buf_bytes);
+  __m128i* intrin_values = arena->Alloc<__m128i>(max_wires); //using raw pointer due to ~25% increase in overall performance. Since the online phase is so computationally efficient even the slightest performance hit is immediately seen. It does not matter in the others phases as they operation on a very different running time scale.
+
+  auto t_0 = GET_TIME();
+  e = batch_e;
+  for (int c = batch_from; c < batch_to; ++c) {
+    circuit = circuits[c];
+    inp_offset = inputs_offset[c];
+
+    //e is the input masked with the random OT choices
+    for (int i = 0; i < (int) circuit->num_eval_inp_wires; ++i) {
+      SetBit(i, GetBit(inp_offset + i, ot_rec.choices_outer.get()), e);
+    }
+    XOR_UINT8_T(e, inputs[c], BITS_TO_BYTES(circuit->num_eval_inp_wires));
 
-    int circ_from = circuits_from[exec_id];
-    int circ_to = circuits_to[exec_id];
-    Params* thread_params = thread_params_vec[exec_id].get();
+    e += BITS_TO_BYTES(circuit->num_eval_inp_wires);
+  }
+  thread_params->chan.Send(batch_e, num_batch_e_bytes);
+
+  auto t_1 = GET_TIME();
+  thread_params->chan.ReceiveBlocking(batch_received, num_batch_receiving_bytes);
+  auto t_2 = GET_TIME();
+
+  e = batch_e;
+  const_inp_keys = batch_received;
+  for (int c = batch_from; c < batch_to; ++c) {
+    auto t0 = GET_TIME();
+    circuit = circuits[c];
+    eval_input = inputs[c];
+    eval_outputs = outputs[c];
+    gate_offset = gates_offset[c];
+    inp_gate_offset = inp_gates_offset[c];
+    inp_offset = inputs_offset[c];
+    out_offset = outputs_offset[c];
+
+    eval_computed_shares_inp = online_buf;
+    eval_computed_shares_out = eval_computed_shares_inp + circuit->num_eval_inp_wires * CODEWORD_BYTES;
+
+    eval_inp_keys = eval_computed_shares_out + circuit->num_out_wires * CODEWORD_BYTES;
+    out_decommit_values = eval_inp_keys + circuit->num_eval_inp_wires * CSEC_BYTES;
+
+    decommit_shares_inp_0 = const_inp_keys + circuit->num_const_inp_wires * CSEC_BYTES;
+    decommit_shares_inp_1 = decommit_shares_inp_0 + circuit->num_eval_inp_wires * CODEWORD_BYTES;
+    decommit_shares_out_0 = decommit_shares_inp_1 + circuit->num_eval_inp_wires * CSEC_BYTES;
+    decommit_shares_out_1 = decommit_shares_out_0 + circuit->num_out_wires * CODEWORD_BYTES;
+
+    for (int i = 0; i < (int) circuit->num_eval_inp_wires; ++i) {
+      curr_input = (inp_offset + i);
+      ot_commit_block = curr_input / thread_params->num_pre_inputs;
+      commit_id = thread_params->ot_chosen_start + curr_input % thread_params->num_pre_inputs;
+
+      std::copy(commit_recs[ot_commit_block]->commit_shares[commit_id], commit_recs[ot_commit_block]->commit_shares[commit_id] + CODEWORD_BYTES, eval_computed_shares_inp + i * CODEWORD_BYTES);
+
+      //Add the input key
+      curr_auth_inp_head_pos = params.num_pre_gates * thread_params->num_auth + (inp_offset + circuit->num_const_inp_wires + i) * thread_params->num_inp_auth;
+      eval_auths_to_blocks.GetExecIDAndIndex(curr_auth_inp_head_pos, curr_inp_head_block, curr_inp_head_idx);
+      XOR_CodeWords(eval_computed_shares_inp + i * CODEWORD_BYTES, commit_recs[curr_inp_head_block]->commit_shares[thread_params->auth_start + curr_inp_head_idx]);
+
+      if (GetBit(i, e)) {
+        XOR_CodeWords(eval_computed_shares_inp + i * CODEWORD_BYTES, commit_recs[ot_commit_block]->commit_shares[thread_params->delta_pos]);
+      }
+    }
 
-    online_execs_finished[exec_id] = thread_pool.push([this, thread_params, exec_id, circ_from, circ_to, &circuits, &inputs, &outputs, &eval_gates_to_blocks, &eval_auths_to_blocks] (int id) {
-
-      Circuit* circuit;
-      Gate g;
-      uint8_t* eval_input;
-      uint8_t* eval_outputs;
-      uint8_t* const_inp_keys;
-      uint8_t* eval_inp_keys;
-      uint8_t* out_decommit_values;
-      uint8_t* eval_computed_shares_inp;
-      uint8_t* eval_computed_shares_out;
-      uint8_t* decommit_shares_inp_0;
-      uint8_t* decommit_shares_inp_1;
-      uint8_t* decommit_shares_out_0;
-      uint8_t* decommit_shares_out_1;
-      uint8_t* e;
-      __m128i intrin_outs[thread_params->num_bucket];
-      __m128i intrin_auths[thread_params->num_auth];
-      int bucket_score[thread_params->num_bucket];
-      bool all_equal;
-
-      int gate_offset, inp_gate_offset, inp_offset, out_offset, curr_and_gate;
-      int curr_auth_inp_head_pos, curr_inp_head_block, curr_inp_head_idx, curr_head_pos, curr_head_block, curr_head_idx, curr_output_pos, curr_output_block, curr_output_idx;
+    auto t = GET_TIME();
 
-      GarblingHandler gh(*thread_params);
-      int curr_input, curr_output, ot_commit_block, commit_id, chosen_val_id;
-      for (int c = circ_from; c < circ_to; ++c) {
-        auto t_0 = GET_TIME();
-        circuit = circuits[c];
-        eval_input = inputs[c];
-        eval_outputs = outputs[c];
-        gate_offset = gates_offset[c];
-        inp_gate_offset = inp_gates_offset[c];
-        inp_offset = inputs_offset[c];
-        out_offset = outputs_offset[c];
+    if (!VerifyDecommits(decommit_shares_inp_0, decommit_shares_inp_1, eval_computed_shares_inp, eval_inp_keys, rot_choices.get(), commit_recs[exec_id]->code.get(), circuit->num_eval_inp_wires)) {
+      throw std::runtime_error("Abort: Wrong eval keys sent!");
+    }
 
-        uint8_t* ot_input = new uint8_t[2 * BITS_TO_BYTES(circuit->num_eval_inp_wires) + (circuit->num_eval_inp_wires + circuit->num_out_wires) * CODEWORD_BYTES + circuit->num_const_inp_wires * CSEC_BYTES + (circuit->num_eval_inp_wires + circuit->num_out_wires) * (CODEWORD_BYTES + 2 * CSEC_BYTES)];
+    auto t3 = GET_TIME();
 
-        e = ot_input + BITS_TO_BYTES(circuit->num_eval_inp_wires);
+    for (int i = 0; i < (int) circuit->num_eval_inp_wires; ++i) {
+      curr_input = (inp_offset + i);
+      ot_commit_block = curr_input / thread_params->num_pre_inputs;
+      chosen_val_id = curr_input % thread_params->num_pre_inputs;
+      XOR_128(eval_inp_keys + i * CSEC_BYTES, commit_recs[ot_commit_block]->chosen_commit_values.get() + chosen_val_id * CSEC_BYTES);
 
-        eval_computed_shares_inp = e + BITS_TO_BYTES(circuit->num_eval_inp_wires);
-        eval_computed_shares_out = eval_computed_shares_inp + circuit->num_eval_inp_wires * CODEWORD_BYTES;
+      //XOR out lsb(K^i_0)
+      uint8_t lsb_zero_key = GetLSB(eval_inp_keys + i * CSEC_BYTES) ^ GetBit(params.num_pre_outputs + inp_offset + i, verleak_bits.get()) ^ GetBit(i, e);
 
-        const_inp_keys = eval_computed_shares_out + circuit->num_out_wires * CODEWORD_BYTES;
+      //XOR out K^i_y_i
+      XOR_128(eval_inp_keys + i * CSEC_BYTES, ot_rec.response_outer.get() + curr_input * CSEC_BYTES);
 
-        decommit_shares_inp_0 = const_inp_keys + circuit->num_const_inp_wires * CSEC_BYTES;
-        decommit_shares_inp_1 = decommit_shares_inp_0 + circuit->num_eval_inp_wires * CODEWORD_BYTES;
+      //Check using lsb(K^i_0) that we received the correct key according to eval_input
+      if ((GetLSB(eval_inp_keys + i * CSEC_BYTES) ^ lsb_zero_key) != GetBit(i, eval_input)) {
+        throw std::runtime_error("Abort: Wrong eval value keys sent!");
+      }
 
-        eval_inp_keys = decommit_shares_inp_1 + circuit->num_eval_inp_wires * CSEC_BYTES;
+      intrin_values[circuit->num_const_inp_wires + i] = _mm_lddqu_si128((__m128i *) (eval_inp_keys + i * CSEC_BYTES));
+    }
 
-        decommit_shares_out_0 = eval_inp_keys + circuit->num_eval_inp_wires * CSEC_BYTES;
-        decommit_shares_out_1 = decommit_shares_out_0 + circuit->num_out_wires * CODEWORD_BYTES;
+    auto t4 = GET_TIME();
 
-        out_decommit_values = decommit_shares_out_1 + circuit->num_eval_inp_wires * CSEC_BYTES;
+    //Ensure that constructor sends valid keys. Implemented different than in paper as we here require that ALL input authenticators accept. This has no influence on security as if we abort here it does not leak anything about the evaluators input. Also, the sender knows if the evaluator is going to abort before sending the bad keys, so it leaks nothing.
+    for (int i = 0; i < (int) circuit->num_const_inp_wires; ++i) {
+      intrin_values[i] = _mm_lddqu_si128((__m128i *) (const_inp_keys + i * CSEC_BYTES));
+    }
 
-        uint32_t num_receiving_bytes_inp = circuit->num_const_inp_wires * CSEC_BYTES + circuit->num_eval_inp_wires * (CODEWORD_BYTES + CSEC_BYTES);
-        uint32_t num_receiving_bytes_out = circuit->num_out_wires * (CODEWORD_BYTES + CSEC_BYTES);
+    for (int i = 0; i < (int) circuit->num_inp_wires; ++i) {
+      curr_auth_inp_head_pos = params.num_pre_gates * thread_params->num_auth + (inp_offset + i) * thread_params->num_inp_auth;
 
-        for (int i = 0; i < circuit->num_eval_inp_wires; ++i) {
-          curr_input = (inp_offset + i);
-          if (GetBit(curr_input, ot_rec.choices_outer.get())) {
-            SetBit(i, 1, ot_input);
-          } else {
-            SetBit(i, 0, ot_input);
-          }
+      for (int j = 0; j < thread_params->num_inp_auth; ++j) {
+        if (!IntrinVerifyAuths(eval_auths, curr_auth_inp_head_pos + j, intrin_values[i], eval_auths_ids[curr_auth_inp_head_pos + j], gh.key_schedule)) {
+          throw std::runtime_error("Abort: Inp auth fail!");
         }
+      }
+    }
 
-        XOR_UINT8_T(e, eval_input, ot_input, BITS_TO_BYTES(circuit->num_eval_inp_wires));
-        thread_params->chan.Send(e, BITS_TO_BYTES(circuit->num_eval_inp_wires));
-
-        auto t0 = GET_TIME();
-
-        __m128i* intrin_values = new __m128i[circuit->num_wires]; //using raw pointer due to ~25% increase in overall performance. Since the online phase is so computationally efficient even the slightest performance hit is immediately seen. It does not matter in the others phases as they operation on a very different running time scale.
-
-        for (int i = 0; i < circuit->num_eval_inp_wires; ++i) {
-          curr_input = (inp_offset + i);
-          ot_commit_block = curr_input / thread_params->num_pre_inputs;
-          commit_id = thread_params->ot_chosen_start + curr_input % thread_params->num_pre_inputs;
-
-          std::copy(commit_recs[ot_commit_block]->commit_shares[commit_id], commit_recs[ot_commit_block]->commit_shares[commit_id] + CODEWORD_BYTES, eval_computed_shares_inp + i * CODEWORD_BYTES);
-
-          //Add the input key
-          curr_auth_inp_head_pos = params.num_pre_gates * thread_params->num_auth + (inp_offset + circuit->num_const_inp_wires + i) * thread_params->num_inp_auth;
-          eval_auths_to_blocks.GetExecIDAndIndex(curr_auth_inp_head_pos, curr_inp_head_block, curr_inp_head_idx);
-          XOR_CodeWords(eval_computed_shares_inp + i * CODEWORD_BYTES, commit_recs[curr_inp_head_block]->commit_shares[thread_params->auth_start + curr_inp_head_idx]);
-
-          if (GetBit(i, e)) {
-            XOR_CodeWords(eval_computed_shares_inp + i * CODEWORD_BYTES, commit_recs[ot_commit_block]->commit_shares[thread_params->delta_pos]);
-          }
+/////////////////////////////// DEBUG Input buckets////////////////////////////
+#ifdef DEBUG_SOLDERINGS_INP_BUCKETS
+    __m128i out_keys[2];
+    for (int i = 0; i < circuit->num_const_inp_wires / 2; ++i) {
+      int curr_inp_gate_head = params.num_pre_gates * params.num_bucket + (inp_gate_offset + i) * params.num_inp_bucket;
+      IntrinShiftEvaluateGates(eval_gates, curr_inp_gate_head, intrin_values[i], intrin_values[circuit->num_const_inp_wires / 2 + i], out_keys[0], eval_gates_ids[curr_inp_gate_head], gh.key_schedule);
+
+      for (int j = 1; j < params.num_inp_bucket; ++j) {
+        IntrinShiftEvaluateGates(eval_gates, curr_inp_gate_head + j, intrin_values[i], intrin_values[circuit->num_const_inp_wires / 2 + i], out_keys[1], eval_gates_ids[curr_inp_gate_head + j], gh.key_schedule);
+        if (!compare128(out_keys[0], out_keys[1])) {
+          std::cout << "input gate fail pos:" << i << std::endl;
         }
+      }
+    }
+#endif
+/////////////////////////////// DEBUG Input buckets////////////////////////////
 
-        auto t = GET_TIME();
-        thread_params->chan.ReceiveBlocking(const_inp_keys, num_receiving_bytes_inp);
-        auto t2 = GET_TIME();
-
-        decommit_shares_inp_0 = const_inp_keys + circuit->num_const_inp_wires * CSEC_BYTES;
-        decommit_shares_inp_1 = decommit_shares_inp_0 + circuit->num_eval_inp_wires * CODEWORD_BYTES;
-        decommit_shares_out_0 = decommit_shares_inp_1 + circuit->num_eval_inp_wires * CSEC_BYTES;
-        decommit_shares_out_1 = decommit_shares_out_0 + circuit->num_out_wires * CODEWORD_BYTES;
-        if (!VerifyDecommits(decommit_shares_inp_0, decommit_shares_inp_1, eval_computed_shares_inp, eval_inp_keys, rot_choices.get(), commit_recs[exec_id]->code.get(), circuit->num_eval_inp_wires)) {
-          throw std::runtime_error("Abort: Wrong eval keys sent!");
+    auto t5 = GET_TIME();
+    curr_and_gate = 0;
+    for (int i = 0; i < (int) circuit->num_gates; ++i) {
+      g = circuit->gates[i];
+      if (g.type == NOT) {
+        intrin_values[g.out_wire] = intrin_values[g.left_wire];
+      } else if (g.type == XOR) {
+        intrin_values[g.out_wire] = _mm_xor_si128(intrin_values[g.left_wire], intrin_values[g.right_wire]);
+      } else if (g.type == AND) {
+        curr_head_pos = (gate_offset + curr_and_gate) * thread_params->num_bucket;
+
+        IntrinShiftEvaluateGates(eval_gates, curr_head_pos, intrin_values[g.left_wire], intrin_values[g.right_wire], intrin_values[g.out_wire], eval_gates_ids[curr_head_pos], gh.key_schedule);
+
+        all_equal = true;
+        for (int j = 1; j < thread_params->num_bucket; ++j) {
+          IntrinShiftEvaluateGates(eval_gates, curr_head_pos + j, intrin_values[g.left_wire], intrin_values[g.right_wire], intrin_outs[j - 1], eval_gates_ids[curr_head_pos + j], gh.key_schedule);
+          all_equal &= compare128(intrin_values[g.out_wire], intrin_outs[j - 1]);
         }
 
-        auto t3 = GET_TIME();
-
-        for (int i = 0; i < circuit->num_eval_inp_wires; ++i) {
-          curr_input = (inp_offset + i);
-          ot_commit_block = curr_input / thread_params->num_pre_inputs;
-          chosen_val_id = curr_input % thread_params->num_pre_inputs;
-          XOR_128(eval_inp_keys + i * CSEC_BYTES, commit_recs[ot_commit_block]->chosen_commit_values.get() + chosen_val_id * CSEC_BYTES);
-
-          //XOR out lsb(K^i_0)
-          uint8_t lsb_zero_key = GetLSB(eval_inp_keys + i * CSEC_BYTES) ^ GetBit(params.num_pre_outputs + inp_offset + i, verleak_bits.get()) ^ GetBit(i, e);
-
-          //XOR out K^i_y_i
-          XOR_128(eval_inp_keys + i * CSEC_BYTES, ot_rec.response_outer.get() + curr_input * CSEC_BYTES);
-
-          //Check using lsb(K^i_0) that we received the correct key according to eval_input
-          if ((GetLSB(eval_inp_keys + i * CSEC_BYTES) ^ lsb_zero_key) != GetBit(i, eval_input)) {
-            throw std::runtime_error("Abort: Wrong eval value keys sent!");
+        if (!all_equal) {
+          std::cout << "all outputs not equal for " << curr_and_gate << std::endl;
+          std::fill(bucket_score, bucket_score + thread_params->num_bucket * sizeof(uint32_t), 0);
+          intrin_outs[thread_params->num_bucket - 1] = intrin_values[g.out_wire]; //now all keys are in intrin_outs.
+          intrin_auths[0] = intrin_outs[0];
+          ++bucket_score[0];
+          int candidates = 1;
+          for (int j = 1; j < thread_params->num_bucket; ++j) {
+            int comp = 0;
+            for (int k = 0; k < candidates; k++) {
+              comp = !compare128(intrin_outs[j], intrin_outs[k]);
+              if (comp == 0) {
+                ++bucket_score[k];
+                break;
+              }
+            }
+            if (comp != 0) {
+              intrin_auths[candidates] = intrin_outs[j];
+              ++candidates;
+            }
           }
 
-          intrin_values[circuit->num_const_inp_wires + i] = _mm_lddqu_si128((__m128i *) (eval_inp_keys + i * CSEC_BYTES));
-        }
-
-        auto t4 = GET_TIME();
+          //Check the candidates
+          for (int j = 0; j < thread_params->num_auth; j++) {
+            curr_auth_inp_head_pos = params.num_pre_gates * thread_params->num_auth + (inp_offset + curr_and_gate) * thread_params->num_inp_auth;
 
-        //Ensure that constructor sends valid keys. Implemented different than in paper as we here require that ALL input authenticators accept. This has no influence on security as if we abort here it does not leak anything about the evaluators input. Also, the sender knows if the evaluator is going to abort before sending the bad keys, so it leaks nothing.
-        for (int i = 0; i < circuit->num_const_inp_wires; ++i) {
-          intrin_values[i] = _mm_lddqu_si128((__m128i *) (const_inp_keys + i * CSEC_BYTES));
-        }
-
-        for (int i = 0; i < circuit->num_inp_wires; ++i) {
-          curr_auth_inp_head_pos = params.num_pre_gates * thread_params->num_auth + (inp_offset + i) * thread_params->num_inp_auth;
-
-          for (int j = 0; j < thread_params->num_inp_auth; ++j) {
-            if (!IntrinVerifyAuths(eval_auths, curr_auth_inp_head_pos + j, intrin_values[i], eval_auths_ids[curr_auth_inp_head_pos + j], gh.key_schedule)) {
-              throw std::runtime_error("Abort: Inp auth fail!");
+            for (uint32_t k = 0; k < (uint32_t) candidates; k++) {
+              int res = IntrinVerifyAuths(eval_auths, curr_auth_inp_head_pos + k, intrin_auths[k], eval_auths_ids[curr_auth_inp_head_pos + k], gh.key_schedule);
+              if (res == 1) { // The key is good
+                ++bucket_score[k];
+              }
             }
           }
-        }
-
-/////////////////////////////// DEBUG Input buckets////////////////////////////
-#ifdef DEBUG_SOLDERINGS_INP_BUCKETS
-        __m128i out_keys[2];
-        for (int i = 0; i < circuit->num_const_inp_wires / 2; ++i) {
-          int curr_inp_gate_head = params.num_pre_gates * params.num_bucket + (inp_gate_offset + i) * params.num_inp_bucket;
-          IntrinShiftEvaluateGates(eval_gates, curr_inp_gate_head, intrin_values[i], intrin_values[circuit->num_const_inp_wires / 2 + i], out_keys[0], eval_gates_ids[curr_inp_gate_head], gh.key_schedule);
-
-          for (int j = 1; j < params.num_inp_bucket; ++j) {
-            IntrinShiftEvaluateGates(eval_gates, curr_inp_gate_head + j, intrin_values[i], intrin_values[circuit->num_const_inp_wires / 2 + i], out_keys[1], eval_gates_ids[curr_inp_gate_head + j], gh.key_schedule);
-            if (!compare128(out_keys[0], out_keys[1])) {
-              std::cout << "input gate fail pos:" << i << std::endl;
+          // Find the winner
+          int winner_idx = -1;
+          int curr_high_score = -1;
+          for (int j = 0; j < candidates; j++) {
+            if (bucket_score[j] > curr_high_score) {
+              winner_idx = j;
+              curr_high_score = bucket_score[j];
             }
           }
+
+          intrin_values[g.out_wire] = intrin_auths[winner_idx];
         }
-#endif
-/////////////////////////////// DEBUG Input buckets////////////////////////////
+        ++curr_and_gate;
+      }
+    }
 
-        auto t5 = GET_TIME();
-        curr_and_gate = 0;
-        for (int i = 0; i < circuit->num_gates; ++i) {
-          g = circuit->gates[i];
-          if (g.type == NOT) {
-            intrin_values[g.out_wire] = intrin_values[g.left_wire];
-          } else if (g.type == XOR) {
-            intrin_values[g.out_wire] = _mm_xor_si128(intrin_values[g.left_wire], intrin_values[g.right_wire]);
-          } else if (g.type == AND) {
-            curr_head_pos = (gate_offset + curr_and_gate) * thread_params->num_bucket;
-
-            IntrinShiftEvaluateGates(eval_gates, curr_head_pos, intrin_values[g.left_wire], intrin_values[g.right_wire], intrin_values[g.out_wire], eval_gates_ids[curr_head_pos], gh.key_schedule);
-
-            all_equal = true;
-            for (int j = 1; j < thread_params->num_bucket; ++j) {
-              IntrinShiftEvaluateGates(eval_gates, curr_head_pos + j, intrin_values[g.left_wire], intrin_values[g.right_wire], intrin_outs[j - 1], eval_gates_ids[curr_head_pos + j], gh.key_schedule);
-              all_equal &= compare128(intrin_values[g.out_wire], intrin_outs[j - 1]);
-            }
+    for (int i = 0; i < (int) circuit->num_out_wires; ++i) {
+      curr_output = (out_offset + i);
+      ot_commit_block = curr_output / thread_params->num_pre_outputs;
+      commit_id = thread_params->out_lsb_blind_start + curr_output % thread_params->num_pre_outputs;
 
-            if (!all_equal) {
-              std::cout << "all outputs not equal for " << curr_and_gate << std::endl;
-              std::fill(bucket_score, bucket_score + thread_params->num_bucket * sizeof(uint32_t), 0);
-              intrin_outs[thread_params->num_bucket - 1] = intrin_values[g.out_wire]; //now all keys are in intrin_outs.
-              intrin_auths[0] = intrin_outs[0];
-              ++bucket_score[0];
-              int candidates = 1;
-              for (int j = 1; j < thread_params->num_bucket; ++j) {
-                int comp = 0;
-                for (int k = 0; k < candidates; k++) {
-                  comp = !compare128(intrin_outs[j], intrin_outs[k]);
-                  if (comp == 0) {
-                    ++bucket_score[k];
-                    break;
-                  }
-                }
-                if (comp != 0) {
-                  intrin_auths[candidates] = intrin_outs[j];
-                  ++candidates;
-                }
-              }
+      std::copy(commit_recs[ot_commit_block]->commit_shares[commit_id], commit_recs[ot_commit_block]->commit_shares[commit_id] + CODEWORD_BYTES, eval_computed_shares_out + i * CODEWORD_BYTES);
 
-              //Check the candidates
-              for (int j = 0; j < thread_params->num_auth; j++) {
-                curr_auth_inp_head_pos = params.num_pre_gates * thread_params->num_auth + (inp_offset + curr_and_gate) * thread_params->num_inp_auth;
+      //Add the output key
+      curr_output_pos = (gate_offset + circuit->num_and_gates - circuit->num_out_wires + i) * thread_params->num_bucket;
+      eval_gates_to_blocks.GetExecIDAndIndex(curr_output_pos, curr_output_block, curr_output_idx);
 
-                for (uint32_t k = 0; k < candidates; k++) {
-                  int res = IntrinVerifyAuths(eval_auths, curr_auth_inp_head_pos + k, intrin_auths[k], eval_auths_ids[curr_auth_inp_head_pos + k], gh.key_schedule);
-                  if (res == 1) { // The key is good
-                    ++bucket_score[k];
-                  }
-                }
-              }
-              // Find the winner
-              int winner_idx = -1;
-              int curr_high_score = -1;
-              for (int j = 0; j < candidates; j++) {
-                if (bucket_score[j] > curr_high_score) {
-                  winner_idx = j;
-                  curr_high_score = bucket_score[j];
-                }
-              }
+      XOR_CodeWords(eval_computed_shares_out + i * CODEWORD_BYTES, commit_recs[curr_output_block]->commit_shares[thread_params->out_keys_start + curr_output_idx]);
+    }
 
-              intrin_values[g.out_wire] = intrin_auths[winner_idx];
-            }
-            ++curr_and_gate;
-          }
-        }
+    if (!VerifyDecommits(decommit_shares_out_0, decommit_shares_out_1, eval_computed_shares_out, out_decommit_values, rot_choices.get(), commit_recs[exec_id]->code.get(), circuit->num_out_wires)) {
+      throw std::runtime_error("Abort: Wrong eval keys sent!");
+    }
 
-        for (int i = 0; i < circuit->num_out_wires; ++i) {
-          curr_output = (out_offset + i);
-          ot_commit_block = curr_output / thread_params->num_pre_outputs;
-          commit_id = thread_params->out_lsb_blind_start + curr_output % thread_params->num_pre_outputs;
+    auto t6 = GET_TIME();
+    for (int i = 0; i < (int) circuit->num_out_wires; ++i) {
+      SetBit(i, GetLSB(out_decommit_values + i * CSEC_BYTES) ^ GetBit(out_offset + i, verleak_bits.get()) ^ GetLSB(intrin_values[circuit->num_wires - circuit->num_out_wires + i]), eval_outputs);
+    }
 
-          std::copy(commit_recs[ot_commit_block]->commit_shares[commit_id], commit_recs[ot_commit_block]->commit_shares[commit_id] + CODEWORD_BYTES, eval_computed_shares_out + i * CODEWORD_BYTES);
+    auto t7 = GET_TIME();
 
-          //Add the output key
-          curr_output_pos = (gate_offset + circuit->num_and_gates - circuit->num_out_wires + i) * thread_params->num_bucket;
-          eval_gates_to_blocks.GetExecIDAndIndex(curr_output_pos, curr_output_block, curr_output_idx);
+#ifdef TINY_PRINT
+    //Could also report average as in preprocessing
+    if ((exec_id == 0) && (c == 0)) {
+      PRINT_TIME_NANO(t_1, t_0, "inp_prep");
+      PRINT_TIME_NANO(t_2, t_1, "key_wait");
+      PRINT_TIME_NANO(t, t0, "commit_share");
+      PRINT_TIME_NANO(t3, t, "commit");
+      PRINT_TIME_NANO(t4, t3, "eval inp");
+      PRINT_TIME_NANO(t5, t4, "const inp");
+      PRINT_TIME_NANO(t6, t5, "eval circ");
+      PRINT_TIME_NANO(t7, t6, "output decoding");
+    }
+#endif
 
-          XOR_CodeWords(eval_computed_shares_out + i * CODEWORD_BYTES, commit_recs[curr_output_block]->commit_shares[thread_params->out_keys_start + curr_output_idx]);
-        }
+    e += BITS_TO_BYTES(circuit->num_eval_inp_wires);
+    const_inp_keys = decommit_shares_out_1 + circuit->num_out_wires * CSEC_BYTES;
+  }
+}
 
-        thread_params->chan.ReceiveBlocking(decommit_shares_out_0, num_receiving_bytes_out);
+uint64_t TinyEvaluator::OnlineScratchBytes(std::vector<Circuit*>& circuits, int batch_from, int batch_to) {
+  uint64_t num_batch_e_bytes = 0;
+  uint64_t num_batch_receiving_bytes = 0;
+  uint64_t max_online_buf_bytes = 0;
+  uint64_t max_wires = 0;
+  for (int c = batch_from; c < batch_to; ++c) {
+    num_batch_e_bytes += BITS_TO_BYTES(circuits[c]->num_eval_inp_wires);
+    num_batch_receiving_bytes += circuits[c]->num_const_inp_wires * CSEC_BYTES + (circuits[c]->num_eval_inp_wires + circuits[c]->num_out_wires) * (CODEWORD_BYTES + CSEC_BYTES);
+    max_online_buf_bytes = std::max(max_online_buf_bytes, (uint64_t) (circuits[c]->num_eval_inp_wires + circuits[c]->num_out_wires) * (CODEWORD_BYTES + CSEC_BYTES));
+    max_wires = std::max(max_wires, (uint64_t) circuits[c]->num_wires);
+  }
+  return ExecArena::SliceBytes(num_batch_e_bytes) + ExecArena::SliceBytes(num_batch_receiving_bytes) + ExecArena::SliceBytes(max_online_buf_bytes) + ExecArena::SliceBytes(max_wires * sizeof(__m128i));
+}
 
-        if (!VerifyDecommits(decommit_shares_out_0, decommit_shares_out_1, eval_computed_shares_out, out_decommit_values, rot_choices.get(), commit_recs[exec_id]->code.get(), circuit->num_out_wires)) {
-          throw std::runtime_error("Abort: Wrong eval keys sent!");
-        }
+void TinyEvaluator::Online(std::vector<Circuit*>& circuits, std::vector<uint8_t*>& inputs, std::vector<uint8_t*>& outputs, int eval_num_execs) {
 
-        auto t6 = GET_TIME();
-        for (int i = 0; i < circuit->num_out_wires; ++i) {
-          SetBit(i, GetLSB(out_decommit_values + i * CSEC_BYTES) ^ GetBit(out_offset + i, verleak_bits.get()) ^ GetLSB(intrin_values[circuit->num_wires - circuit->num_out_wires + i]), eval_outputs);
-        }
+  //The online phase is a few round trips of small messages, so poll for them instead of paying for wakeups
+  params.mux->SetBusyPoll(true);
+
+  std::vector<int> circuits_from, circuits_to;
+  int num_tasks = SplitCircuits(circuits, eval_num_execs, circuits_from, circuits_to);
+  EnsureExecs(num_tasks);
+  std::vector<std::future<void>> online_execs_finished(num_tasks);
 
-        auto t7 = GET_TIME();
+  IDMap eval_auths_to_blocks(eval_auths_ids, thread_params_vec[0]->Q + thread_params_vec[0]->A, thread_params_vec[0]->auth_start);
+  IDMap eval_gates_to_blocks(eval_gates_ids, thread_params_vec[0]->Q + thread_params_vec[0]->A, thread_params_vec[0]->out_keys_start);
 
-        delete[] ot_input;
-        delete[] intrin_values;
+  for (int exec_id = 0; exec_id < num_tasks; ++exec_id) {
 
-#ifdef TINY_PRINT
-        //Could also report average as in preprocessing
-        if ((exec_id == 0) && (c == 0)) {
-          PRINT_TIME_NANO(t0, t_0, "inp_prep");
-          PRINT_TIME_NANO(t, t0, "commit_share");
-          PRINT_TIME_NANO(t2, t, "key_wait");
-          PRINT_TIME_NANO(t3, t2, "commit");
-          PRINT_TIME_NANO(t4, t3, "eval inp");
-          PRINT_TIME_NANO(t5, t4, "const inp");
-          PRINT_TIME_NANO(t6, t5, "eval circ");
-          PRINT_TIME_NANO(t7, t6, "output decoding");
-        }
-#endif
+    int circ_from = circuits_from[exec_id];
+    int circ_to = circuits_to[exec_id];
+    Params* thread_params = thread_params_vec[exec_id].get();
+
+    online_execs_finished[exec_id] = thread_pool.push([this, thread_params, exec_id, num_tasks, circ_from, circ_to, &circuits, &inputs, &outputs, &eval_gates_to_blocks, &eval_auths_to_blocks] (int id) {
+      NodePin pin(NumaTopology::Get().NodeOfExec(exec_id, num_tasks));
+      ReserveOnlineArena(exec_id, circuits, circ_from, circ_to, ONLINE_BATCH_SIZE);
+      for (int batch_from = circ_from; batch_from < circ_to; batch_from += ONLINE_BATCH_SIZE) {
+        int batch_to = std::min(batch_from + ONLINE_BATCH_SIZE, circ_to);
+        OnlineBatch(thread_params, exec_id, batch_from, batch_to, circuits, inputs, outputs, eval_gates_to_blocks, eval_auths_to_blocks);
       }
     });
   }
@@ -1210,6 +1451,11 @@ void TinyEvaluator::Online(std::vector<Circuit*>& circuits, std::vector<uint8_t*
   for (std::future<void>& r : online_execs_finished) {
     r.wait();
   }
+  params.mux->SetBusyPoll(false);
+
+  for (std::future<void>& r : online_execs_finished) {
+    r.get();
+  }
 
 #ifdef PRINT_COM
   uint64_t bytes_received = params.chan.GetCurrentBytesReceived();
@@ -1229,6 +1475,74 @@ void TinyEvaluator::Online(std::vector<Circuit*>& circuits, std::vector<uint8_t*
 #endif
 }
 
+void TinyEvaluator::OfflineOnline(std::vector<Circuit*>& circuits, std::vector<uint8_t*>& inputs, std::vector<uint8_t*>& outputs, int num_execs, std::function<void(int)> circuit_done) {
+  ReserveCircuits(circuits);
+
+  //See TinyConstructor::OfflineOnline for the execs
+  std::vector<int> circuits_from, circuits_to;
+  int num_tasks = SplitCircuits(circuits, num_execs, circuits_from, circuits_to);
+  EnsureExecs(2 * num_tasks);
+
+  params.mux->SetBusyPoll(true);
+
+  IDMap eval_gates_to_blocks(eval_gates_ids, thread_params_vec[0]->Q + thread_params_vec[0]->A, thread_params_vec[0]->out_keys_start);
+  IDMap eval_auths_to_blocks(eval_auths_ids, thread_params_vec[0]->Q + thread_params_vec[0]->A, thread_params_vec[0]->auth_start);
+
+  //Set once the solderings of a circuit have been verified
+  std::vector<std::promise<void>> soldered(circuits.size());
+  std::vector<std::future<void>> execs_finished;
+  for (int exec_id = 0; exec_id < num_tasks; ++exec_id) {
+    int circ_from = circuits_from[exec_id];
+    int circ_to = circuits_to[exec_id];
+    Params* solder_params = thread_params_vec[exec_id].get();
+    Params* online_params = thread_params_vec[num_tasks + exec_id].get();
+
+    //The soldering exec is pushed first, so an online exec never holds the last pool thread while the soldering it waits for is still queued
+    execs_finished.emplace_back(thread_pool.push([this, solder_params, exec_id, num_tasks, circ_from, circ_to, &circuits, &soldered, &eval_gates_to_blocks, &eval_auths_to_blocks] (int id) {
+      NodePin pin(NumaTopology::Get().NodeOfExec(exec_id, num_tasks));
+      int c = circ_from;
+      try {
+        ReserveSolderArena(exec_id, circuits, circ_from, circ_to);
+        for (; c < circ_to; ++c) {
+          if (SolderCircuit(solder_params, exec_id, c, circuits, eval_gates_to_blocks, eval_auths_to_blocks)) {
+            soldered[c].set_value();
+          } else {
+            //Later circuits are still soldered, so the channel stays in step with the constructor
+            soldered[c].set_exception(std::make_exception_ptr(std::runtime_error("Abort, topological soldering failed. Cheating detected")));
+          }
+        }
+      } catch (...) {
+        for (; c < circ_to; ++c) {
+          soldered[c].set_exception(std::current_exception());
+        }
+        throw;
+      }
+    }));
+
+    execs_finished.emplace_back(thread_pool.push([this, online_params, num_tasks, exec_id, circ_from, circ_to, &circuits, &inputs, &outputs, &soldered, &circuit_done, &eval_gates_to_blocks, &eval_auths_to_blocks] (int id) {
+      NodePin pin(NumaTopology::Get().NodeOfExec(exec_id, num_tasks));
+      ReserveOnlineArena(num_tasks + exec_id, circuits, circ_from, circ_to, 1);
+      for (int c = circ_from; c < circ_to; ++c) {
+        soldered[c].get_future().get();
+        OnlineBatch(online_params, num_tasks + exec_id, c, c + 1, circuits, inputs, outputs, eval_gates_to_blocks, eval_auths_to_blocks);
+        if (circuit_done) {
+          circuit_done(c);
+        }
+      }
+    }));
+  }
+
+  for (std::future<void>& r : execs_finished) {
+    r.wait();
+  }
+  params.mux->SetBusyPoll(false);
+
+  //As in Offline and Online, failures inside the execs are passed on, so a circuit that fails its soldering check is never reported as evaluated
+  for (std::future<void>& r : execs_finished) {
+    r.get();
+  }
+}
+
 //The below function is essentially a mix of the three CommitRec member functions ConsistencyCheck, BatchDecommit and VerifyTransposedDecommits.
 bool TinyEvaluator::BatchDecommitLSB(CommitReceiver* commit_rec, uint8_t decommit_shares[], int num_values, uint8_t values[]) {
 
@@ -9,11 +9,19 @@
 class TinyEvaluator : public Tiny {
 public:
   TinyEvaluator(Params& params);
+  ~TinyEvaluator();
 
   void Setup();
   void Preprocess();
   void Offline(std::vector<Circuit*>& circuits, int top_num_execs);
+  void AddExecs(int num_extra_execs);
+  int GetNumQueuedBatches();
+  void SavePreprocessed(std::string path);
+  void LoadPreprocessed(std::string path);
   void Online(std::vector<Circuit*>& circuits, std::vector<uint8_t*>& inputs, std::vector<uint8_t*>& outputs, int eval_num_execs);
+
+  //See TinyConstructor::OfflineOnline. A circuit only goes online once its solderings have been verified, and outputs[c] is final when circuit_done(c) is called
+  void OfflineOnline(std::vector<Circuit*>& circuits, std::vector<uint8_t*>& inputs, std::vector<uint8_t*>& outputs, int num_execs, std::function<void(int)> circuit_done = nullptr);
   bool BatchDecommitLSB(CommitReceiver* commit_rec, uint8_t decommit_shares[], int num_values, uint8_t values[]);
   
   ALSZDOTExtRec ot_rec;
@@ -21,15 +29,54 @@ public:
   std::unique_ptr<uint8_t[]> rot_choices;
   int rot_start_pos;
   std::unique_ptr<uint8_t[]> verleak_bits;
-  std::unique_ptr<uint8_t[]> raw_eval_data;
+  std::shared_ptr<uint8_t> raw_eval_data; //Points into mapping if the batch was loaded from a file
   std::unique_ptr<uint32_t[]> raw_eval_ids;
   std::vector<std::unique_ptr<CommitReceiver>> commit_recs;
+
+  //Set if the batch was loaded from a file. The commitment shares point into it
+  std::shared_ptr<uint8_t> mapping;
   
   //Convenience pointers
   uint32_t* eval_gates_ids;
   uint32_t* eval_auths_ids;
   HalfGates eval_gates;
   Auths eval_auths;
+
+  //Preprocessed state of a queued batch. The active batch lives in the members above
+  struct Batch {
+    std::vector<std::unique_ptr<Params>> thread_params_vec;
+    std::vector<std::unique_ptr<CommitReceiver>> commit_recs;
+    std::unique_ptr<uint8_t[]> rot_seeds;
+    std::unique_ptr<uint8_t[]> rot_choices;
+    std::unique_ptr<uint8_t[]> verleak_bits;
+    std::shared_ptr<uint8_t> raw_eval_data;
+    std::unique_ptr<uint32_t[]> raw_eval_ids;
+    std::unique_ptr<uint8_t[]> choices_outer;
+    std::unique_ptr<uint8_t[]> response_outer;
+    std::shared_ptr<uint8_t> mapping;
+  };
+  std::deque<std::unique_ptr<Batch>> queued_batches;
+
+  //Set in background mode, where all batches come from the producer
+  std::unique_ptr<Params> producer_params;
+  std::unique_ptr<TinyEvaluator> producer;
+
+private:
+  void CreateProducer(int num_threads);
+  void ProduceBatch();
+  void CreateExecs(int num_new_execs);
+  bool SolderCircuit(Params* thread_params, int exec_id, int c, std::vector<Circuit*>& circuits, IDMap& eval_gates_to_blocks, IDMap& eval_auths_to_blocks);
+  void OnlineBatch(Params* thread_params, int exec_id, int batch_from, int batch_to, std::vector<Circuit*>& circuits, std::vector<uint8_t*>& inputs, std::vector<uint8_t*>& outputs, IDMap& eval_gates_to_blocks, IDMap& eval_auths_to_blocks);
+  uint64_t SolderScratchBytes(Circuit* circuit);
+  uint64_t OnlineScratchBytes(std::vector<Circuit*>& circuits, int batch_from, int batch_to);
+  void PreprocessBatch();
+  void InitBatch(bool alloc_eval_data = true);
+  void SwapBatch(Batch& batch);
+  void SetEvalPointers();
+  uint64_t EvalDataSize();
+  void ActivateNextBatch();
+  void SaveBatch(PreprocessedWriter& writer);
+  void LoadBatch(PreprocessedReader& reader);
 };
 
 #endif /* TINY_TINY_TINYEVAL_H_ */
\ No newline at end of file
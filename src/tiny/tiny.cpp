@@ -12,20 +12,293 @@ Tiny::Tiny(Params& params) : params(params), thread_pool(params.num_cpus), threa
 
   params.ComputeGateAndAuthNumbers(num_gates_rounded, num_inputs_rounded, num_outputs_rounded);
 
+  num_preprocessed = 0;
+  exec_chan_offset = 0;
+  num_added_execs = 0;
+  num_produced = 0;
+  num_activated = 0;
+  producing = false;
+  stopping = false;
   num_gates_used = 0;
   num_inputs_used = 0;
   num_outputs_used = 0;
 }
 
-void Tiny::WeightedRandomString(uint8_t res[], int weight, int res_length, PRNG& rnd) {
+void Tiny::StartBackground(int num_threads, double mbit, int low_watermark, int high_watermark) {
+  if (num_preprocessed != 0 || background_thread.joinable()) {
+    throw std::runtime_error("Background preprocessing needs a fresh instance");
+  }
+  if (num_threads < 1 || low_watermark < 0 || high_watermark <= low_watermark) {
+    throw std::runtime_error("Background preprocessing needs a thread and a high watermark above the low watermark");
+  }
+  //Queued batches, the active one and the one being produced all need their own channels
+  if (high_watermark + 2 > NUM_BATCH_CHAN_SLOTS) {
+    throw std::runtime_error("High watermark too large for the number of batch channels");
+  }
+
+  CreateProducer(num_threads);
+
+  params.mux->SetBackgroundRate(mbit);
+  params.mux->SetBackground(PRODUCER_PARAMS_CHAN, true);
+  params.mux->SetBackground(OT_EXT_CHAN + PRODUCER_PARAMS_CHAN, true);
 
-  uint8_t temp[res_length];
-  std::fill(res, res + res_length, 0xFF);
-  while (weight > 0) {
-    rnd.GenRnd(temp, res_length);
-    for (unsigned int i = 0; i < res_length; ++i) {
-      res[i] &= temp[i];
+  //There is no active batch yet. Marking the empty one as used up makes the first Offline wait for the producer
+  num_gates_used = params.num_pre_gates;
+  num_inputs_used = params.num_pre_inputs;
+  num_outputs_used = params.num_pre_outputs;
+
+  producing = true;
+  background_thread = std::thread(&Tiny::BackgroundLoop, this, low_watermark, high_watermark);
+}
+
+void Tiny::BackgroundLoop(int low_watermark, int high_watermark) {
+  //Refills are decided only from the number of activated batches, which both parties agree on, so their producers always run the same number of Preprocess rounds. That is also why a refill is never interrupted
+  int target = high_watermark;
+  try {
+    while (true) {
+      if (num_produced < target) {
+        ProduceBatch();
+        continue;
+      }
+
+      std::unique_lock<std::mutex> lock(batches_mutex);
+      batches_changed.wait(lock, [this, target, low_watermark] { return stopping || num_activated >= target - low_watermark; });
+      if (num_activated < target - low_watermark) {
+        break;
+      }
+      target += high_watermark - low_watermark;
     }
-    weight--;
+  } catch (std::exception& e) {
+    std::cerr << "Background preprocessing failed: " << e.what() << std::endl;
+  }
+
+  std::lock_guard<std::mutex> lock(batches_mutex);
+  producing = false;
+  batches_changed.notify_all();
+}
+
+void Tiny::StopBackground() {
+  if (!background_thread.joinable()) {
+    return;
+  }
+  {
+    std::lock_guard<std::mutex> lock(batches_mutex);
+    stopping = true;
+  }
+  batches_changed.notify_all();
+  background_thread.join();
+}
+
+bool Tiny::IsBackgroundRunning() {
+  std::lock_guard<std::mutex> lock(batches_mutex);
+  return producing;
+}
+
+bool Tiny::WaitForQueuedBatch() {
+  if (background_thread.joinable()) {
+    std::unique_lock<std::mutex> lock(batches_mutex);
+    batches_changed.wait(lock, [this] { return num_produced > num_activated || !producing; });
+  }
+  return GetNumQueuedBatches() > 0;
+}
+
+void Tiny::SetBackgroundExecs(uint32_t exec_chan_offset, bool enable) {
+  for (int exec_id = 0; exec_id < params.num_execs; ++exec_id) {
+    params.mux->SetBackground(exec_chan_offset + exec_id, enable);
+  }
+}
+
+//Takes room for circuits from the active batch and sets the offsets of each circuit in it
+void Tiny::ReserveCircuits(std::vector<Circuit*>& circuits) {
+  uint64_t num_gates_needed = 0;
+  uint64_t num_inp_gates_needed = 0;
+  uint64_t num_inps_needed = 0;
+  uint64_t num_outs_needed = 0;
+  for (size_t i = 0; i < circuits.size(); ++i) {
+    num_gates_needed += circuits[i]->num_and_gates;
+    num_inp_gates_needed += circuits[i]->num_const_inp_wires / 2;
+    num_inps_needed += circuits[i]->num_inp_wires;
+    num_outs_needed += circuits[i]->num_out_wires;
+  }
+
+  //Circuits are never split across batches. If the active batch cannot hold them all we move on to the next queued batch. Both parties take this decision on the same public counters and queue length, so they always agree
+  if (((params.num_pre_gates - num_gates_used) < num_gates_needed || (params.num_pre_inputs - num_inputs_used) < num_inps_needed || (params.num_pre_outputs - num_outputs_used) < num_outs_needed) && WaitForQueuedBatch()) {
+    ActivateNextBatch();
+  }
+
+  gates_offset.clear();
+  inp_gates_offset.clear();
+  inputs_offset.clear();
+  outputs_offset.clear();
+  int curr_gates = 0;
+  int curr_inp_gates = 0;
+  int curr_inps = 0;
+  int curr_outs = 0;
+  for (size_t i = 0; i < circuits.size(); ++i) {
+    gates_offset.emplace_back(num_gates_used + curr_gates);
+    inp_gates_offset.emplace_back(num_inputs_used / 2 + curr_inp_gates);
+    inputs_offset.emplace_back(num_inputs_used + curr_inps);
+    outputs_offset.emplace_back(num_outputs_used + curr_outs);
+    curr_gates += circuits[i]->num_and_gates;
+    curr_inp_gates += circuits[i]->num_const_inp_wires / 2;
+    curr_inps += circuits[i]->num_inp_wires;
+    curr_outs += circuits[i]->num_out_wires;
+  }
+
+  if ((params.num_pre_gates - num_gates_used) < num_gates_needed) {
+    throw std::runtime_error("Not enough garbled gates");
+  } else {
+    num_gates_used += num_gates_needed;
+  }
+
+  //Due to the way we choose our parameters, if there are enough num_inps, then there are also enough for inp_gates.
+  if ((params.num_pre_inputs - num_inputs_used) < num_inps_needed) {
+    throw std::runtime_error("Not enough input authenticators");
+  } else {
+    num_inputs_used += num_inps_needed;
+  }
+
+  if ((params.num_pre_outputs - num_outputs_used) < num_outs_needed) {
+    throw std::runtime_error("Not enough output wires");
+  } else {
+    num_outputs_used += num_outs_needed;
+  }
+}
+
+int Tiny::SplitCircuits(std::vector<Circuit*>& circuits, int num_execs, std::vector<int>& circuits_from, std::vector<int>& circuits_to) {
+  //A single exec has no other thread to hand work to
+  int num_tasks = num_execs;
+  if (num_execs > 1) {
+    num_tasks = std::min(num_execs * TASKS_PR_EXEC, BATCH_CHAN_STRIDE / 2);
+  }
+  num_tasks = std::max(std::min(num_tasks, (int) circuits.size()), 1);
+
+  std::vector<uint64_t> weights;
+  for (Circuit* circuit : circuits) {
+    weights.emplace_back(circuit->num_and_gates + circuit->num_inp_wires);
   }
-}
\ No newline at end of file
+  PartitionByWeight(circuits_from, circuits_to, num_tasks, weights);
+  return num_tasks;
+}
+
+void Tiny::EnsureExecs(int num_execs) {
+  int num_missing_execs = num_execs - thread_params_vec.size();
+  if (num_missing_execs > 0) {
+    AddExecs(num_missing_execs);
+  }
+  while (exec_arenas.size() < thread_params_vec.size()) {
+    exec_arenas.emplace_back(std::make_unique<ExecArena>());
+  }
+}
+
+void Tiny::ReserveSolderArena(int exec_id, std::vector<Circuit*>& circuits, int circ_from, int circ_to) {
+  uint64_t scratch_bytes = 0;
+  for (int c = circ_from; c < circ_to; ++c) {
+    scratch_bytes = std::max(scratch_bytes, SolderScratchBytes(circuits[c]));
+  }
+  exec_arenas[exec_id]->Reserve(scratch_bytes);
+}
+
+void Tiny::ReserveOnlineArena(int exec_id, std::vector<Circuit*>& circuits, int circ_from, int circ_to, int online_batch_size) {
+  uint64_t scratch_bytes = 0;
+  for (int batch_from = circ_from; batch_from < circ_to; batch_from += online_batch_size) {
+    int batch_to = std::min(batch_from + online_batch_size, circ_to);
+    scratch_bytes = std::max(scratch_bytes, OnlineScratchBytes(circuits, batch_from, batch_to));
+  }
+  exec_arenas[exec_id]->Reserve(scratch_bytes);
+}
+
+uint64_t Tiny::GetFreeGates() {
+  if (num_preprocessed == 0) {
+    return 0;
+  }
+  return params.num_pre_gates - num_gates_used + GetNumQueuedBatches() * params.num_pre_gates;
+}
+
+uint64_t Tiny::GetFreeInputs() {
+  if (num_preprocessed == 0) {
+    return 0;
+  }
+  return params.num_pre_inputs - num_inputs_used + GetNumQueuedBatches() * params.num_pre_inputs;
+}
+
+uint64_t Tiny::GetFreeOutputs() {
+  if (num_preprocessed == 0) {
+    return 0;
+  }
+  return params.num_pre_outputs - num_outputs_used + GetNumQueuedBatches() * params.num_pre_outputs;
+}
+
+void Tiny::WritePreprocessedHeader(PreprocessedWriter& writer) {
+  if (num_preprocessed == 0) {
+    throw std::runtime_error("Nothing has been preprocessed");
+  }
+
+  writer.Write<uint8_t>(params.net_role);
+  writer.Write<uint64_t>(params.num_pre_gates);
+  writer.Write<uint64_t>(params.num_pre_inputs);
+  writer.Write<uint64_t>(params.num_pre_outputs);
+  writer.Write<int>(params.num_bucket);
+  writer.Write<int>(params.num_auth);
+  writer.Write<int>(params.num_inp_bucket);
+  writer.Write<int>(params.num_inp_auth);
+  writer.Write<int>(params.num_execs);
+
+  writer.Write<int>(GetNumQueuedBatches() + 1);
+  writer.Write<int>(num_gates_used);
+  writer.Write<int>(num_inputs_used);
+  writer.Write<int>(num_outputs_used);
+}
+
+int Tiny::ReadPreprocessedHeader(PreprocessedReader& reader) {
+  if (num_preprocessed != 0) {
+    throw std::runtime_error("Preprocessed state can only be loaded into a fresh instance");
+  }
+
+  if (reader.Read<uint8_t>() != params.net_role) {
+    throw std::runtime_error("Preprocessed file belongs to the other party");
+  }
+  if (reader.Read<uint64_t>() != params.num_pre_gates ||
+      reader.Read<uint64_t>() != params.num_pre_inputs ||
+      reader.Read<uint64_t>() != params.num_pre_outputs ||
+      reader.Read<int>() != params.num_bucket ||
+      reader.Read<int>() != params.num_auth ||
+      reader.Read<int>() != params.num_inp_bucket ||
+      reader.Read<int>() != params.num_inp_auth ||
+      reader.Read<int>() != params.num_execs) {
+    throw std::runtime_error("Preprocessed file was produced with different parameters");
+  }
+
+  int num_batches = reader.Read<int>();
+  num_gates_used = reader.Read<int>();
+  num_inputs_used = reader.Read<int>();
+  num_outputs_used = reader.Read<int>();
+  return num_batches;
+}
+
+void Tiny::WriteThreadParams(PreprocessedWriter& writer) {
+  //Execs added after Preprocess hold no preprocessed material and are left out
+  writer.Write<int>(params.num_execs);
+  for (int exec_id = 0; exec_id < params.num_execs; ++exec_id) {
+    writer.Write<uint64_t>(thread_params_vec[exec_id]->num_pre_gates);
+    writer.Write<uint64_t>(thread_params_vec[exec_id]->num_pre_inputs);
+    writer.Write<uint64_t>(thread_params_vec[exec_id]->num_pre_outputs);
+    writer.Write<uint64_t>(thread_params_vec[exec_id]->num_commits);
+  }
+}
+
+void Tiny::ReadThreadParams(PreprocessedReader& reader) {
+  int num_execs = reader.Read<int>();
+  std::unique_ptr<uint8_t[]> seeds(std::make_unique<uint8_t[]>(num_execs * CSEC_BYTES));
+  params.rnd.GenRnd(seeds.get(), num_execs * CSEC_BYTES);
+
+  for (int exec_id = 0; exec_id < num_execs; ++exec_id) {
+    uint64_t num_pre_gates = reader.Read<uint64_t>();
+    uint64_t num_pre_inputs = reader.Read<uint64_t>();
+    uint64_t num_pre_outputs = reader.Read<uint64_t>();
+    thread_params_vec.emplace_back(std::make_unique<Params>(params, seeds.get() + exec_id * CSEC_BYTES, num_pre_gates, num_pre_inputs, num_pre_outputs, exec_id));
+
+    //The CnC exec commits to SSEC extra OTs
+    thread_params_vec[exec_id]->num_commits = reader.Read<uint64_t>();
+  }
+}
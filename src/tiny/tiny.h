@@ -4,19 +4,51 @@
 #include "tiny/params.h"
 #include "garbling/garbling-handler.h"
 #include "circuit/circuit.h"
+#include "tiny/cnc-challenge.h"
+#include "tiny/preprocessed-file.h"
+#include "util/numa.h"
+#include "util/exec-arena.h"
+
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
 
 class Tiny {
 public:
   Tiny(Params& params);
 
-  void WeightedRandomString(uint8_t res[], int weight, int res_length, PRNG& rnd);
-
   virtual void Setup() = 0;
+
+  //Can be called any number of times after Setup. Each call preprocesses a batch of params.num_pre_gates gates, params.num_pre_inputs inputs and params.num_pre_outputs outputs using the same base OTs and global delta. Offline uses the active batch and moves on to the next queued one when the circuits do not fit in what is left, so circuits never span two batches.
   virtual void Preprocess() = 0;
   virtual void Offline(std::vector<Circuit*>& circuits, int top_num_execs) = 0;
-  
+
+  //Adds executions to the active batch for Offline and Online phases that use more executions than Preprocess
+  virtual void AddExecs(int num_extra_execs) = 0;
+  virtual int GetNumQueuedBatches() = 0;
+
+  //Writes all preprocessed batches to path. A later process with the same parameters can then run Offline and Online on them with LoadPreprocessed instead of Setup and Preprocess, the other party doing the same with its own file.
+  virtual void SavePreprocessed(std::string path) = 0;
+  virtual void LoadPreprocessed(std::string path) = 0;
+
+  //Keeps the pool filled while Offline and Online run, instead of Setup and Preprocess. A second instance with its own base OTs, channels and a thread pool of num_threads threads, in addition to thread_pool, preprocesses batches and queues them here, limited to an absolute mbit Mbit/s regardless of foreground traffic (0 for no limit). It starts with high_watermark batches and makes another high_watermark - low_watermark each time the queue drops to low_watermark, so both parties must use the same watermarks. Offline waits for the producer whenever the circuits do not fit and nothing is queued yet.
+  void StartBackground(int num_threads, double mbit, int low_watermark, int high_watermark);
+
+  //Lets a refill that has already been triggered finish, as the other party will finish it too
+  void StopBackground();
+  bool IsBackgroundRunning();
+
+  //Unused part of the active batch plus all queued batches
+  uint64_t GetFreeGates();
+  uint64_t GetFreeInputs();
+  uint64_t GetFreeOutputs();
+
   Params& params;
   ctpl::thread_pool thread_pool;
+  int num_preprocessed;
+
+  //Usage of the active batch
   int num_gates_used;
   int num_inputs_used;
   int num_outputs_used;
@@ -25,6 +57,66 @@ public:
 
   std::vector<std::unique_ptr<Params>> thread_params_vec;
   std::unique_ptr<uint8_t[]> thread_seeds;
+
+protected:
+  //Used by Offline and OfflineOnline before any soldering
+  void ReserveCircuits(std::vector<Circuit*>& circuits);
+  virtual void ActivateNextBatch() = 0;
+
+  //Splits circuits into contiguous tasks for Offline and Online with about the same number of AND gates plus inputs each, and returns the number of tasks. Every task gets its own exec, so it is bound to one channel, but tasks are queued on the thread pool in order and taken by whichever thread is free. With TASKS_PR_EXEC tasks pr. requested exec a slow thread holds up a small task instead of a num_execs'th of the work. The split only depends on the circuits and num_execs, so both parties agree on the circuits and channel of each task
+  int SplitCircuits(std::vector<Circuit*>& circuits, int num_execs, std::vector<int>& circuits_from, std::vector<int>& circuits_to);
+
+  //Adds execs until there are at least num_execs, and gives each its arena
+  void EnsureExecs(int num_execs);
+
+  //Scratch memory of each exec in Offline and Online, indexed like thread_params_vec. Kept across calls, so later calls with circuits of the same size allocate nothing
+  std::vector<std::unique_ptr<ExecArena>> exec_arenas;
+
+  //Arena bytes SolderCircuit needs for a circuit, and OnlineBatch for the circuits from batch_from to batch_to
+  virtual uint64_t SolderScratchBytes(Circuit* circuit) = 0;
+  virtual uint64_t OnlineScratchBytes(std::vector<Circuit*>& circuits, int batch_from, int batch_to) = 0;
+
+  //Called by an exec before its loop over the circuits from circ_from to circ_to. Sizes its arena for the largest circuit, or online batch of online_batch_size circuits, so the loop never grows it
+  void ReserveSolderArena(int exec_id, std::vector<Circuit*>& circuits, int circ_from, int circ_to);
+  void ReserveOnlineArena(int exec_id, std::vector<Circuit*>& circuits, int circ_from, int circ_to, int online_batch_size);
+
+  //Creates the producer instance on its own params and channels
+  virtual void CreateProducer(int num_threads) = 0;
+
+  //Runs on the background thread. Preprocesses the next batch on the producer and queues it
+  virtual void ProduceBatch() = 0;
+
+  //Returns true if a batch is queued, first waiting for the producer if it is running
+  bool WaitForQueuedBatch();
+
+  //Marks the channels of the batch being produced as background traffic
+  void SetBackgroundExecs(uint32_t exec_chan_offset, bool enable);
+
+  //Added to the exec ids of Preprocess to get the exec channels. Only the producer of background mode uses more than one
+  uint32_t exec_chan_offset;
+
+  //Execs requested with AddExecs. Each newly activated batch gets the same number
+  int num_added_execs;
+
+  //Guards the batch queue and the counters below once the producer is running
+  std::mutex batches_mutex;
+  std::condition_variable batches_changed;
+  int num_produced;
+  int num_activated;
+  bool producing;
+  bool stopping;
+  std::thread background_thread;
+
+  //The parameters and batch usage shared by both parties' files. Reading checks them against params and returns the number of batches in the file
+  void WritePreprocessedHeader(PreprocessedWriter& writer);
+  int ReadPreprocessedHeader(PreprocessedReader& reader);
+
+  //Recreates the exec params of a loaded batch. The PRNGs are reseeded from params.rnd as the saved process has already used its streams
+  void WriteThreadParams(PreprocessedWriter& writer);
+  void ReadThreadParams(PreprocessedReader& reader);
+
+private:
+  void BackgroundLoop(int low_watermark, int high_watermark);
 };
 
 #endif /* TINY_TINY_TINY_H_ */
\ No newline at end of file
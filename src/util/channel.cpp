@@ -1,38 +1,89 @@
 #include "util/channel.h"
 
-Channel::Channel(std::string ip_address, uint16_t port_push, uint16_t port_pull, uint8_t net_role, zmq::context_t& context) : receive_socket(context, ZMQ_PULL), send_socket(context, ZMQ_PUSH), bytes_received_vec(1), received_pointer(0), bytes_sent_vec(1), sent_pointer(0), net_role(net_role) {
-  if (net_role) { //client
-    receive_s = "tcp://" + ip_address + ":" + std::to_string(port_pull);
-    receive_socket.connect(receive_s);
-    
-    send_s = "tcp://" + ip_address + ":" + std::to_string(port_push);
-    send_socket.connect(send_s);
-  } else { //server
-    receive_s = "tcp://*:" + std::to_string(port_push);
-    receive_socket.bind(receive_s);
-
-    send_s = "tcp://*:" + std::to_string(port_pull);
-    send_socket.bind(send_s);
-  }
+static void FreeSentBuffer(void* data, void* hint) {
+  delete[] (uint8_t*) data;
+}
+
+static void ReleaseSharedBuffer(void* data, void* hint) {
+  delete (std::shared_ptr<uint8_t>*) hint;
+}
+
+Channel::Channel(Multiplexer& mux, uint32_t channel_id) : bytes_received_vec(1), bytes_sent_vec(1), received_pointer(0), sent_pointer(0), mux(mux), channel_id(channel_id) {
 }
 
-void Channel::Receive(uint8_t* buf, uint64_t num_bytes) {
-  receive_socket.recv((void*) buf, num_bytes, ZMQ_DONTWAIT);
+bool Channel::Receive(uint8_t* buf, uint64_t num_bytes) {
+  if (!mux.TryReceive(channel_id, buf, num_bytes)) {
+    return false;
+  }
   bytes_received_vec[received_pointer] += num_bytes;
+  return true;
 }
 
 void Channel::ReceiveBlocking(uint8_t* buf, uint64_t num_bytes) {
-  receive_socket.recv((void*) buf, num_bytes, 0);
+  std::future<void> received = ReceiveAsync(buf, num_bytes);
+
+  //Spinning for a while avoids the scheduler wakeup on short round trips
+  if (mux.busy_poll) {
+    auto deadline = GET_TIME() + std::chrono::microseconds(BUSY_POLL_TIME);
+    while (received.wait_for(std::chrono::seconds(0)) != std::future_status::ready && GET_TIME() < deadline) {
+      _mm_pause();
+    }
+  }
+  received.wait();
+}
+
+std::future<void> Channel::ReceiveAsync(uint8_t* buf, uint64_t num_bytes) {
+  std::shared_ptr<std::promise<void>> received(std::make_shared<std::promise<void>>());
+  ReceiveAsync(buf, num_bytes, [received]() {
+    received->set_value();
+  });
+  return received->get_future();
+}
+
+void Channel::ReceiveAsync(uint8_t* buf, uint64_t num_bytes, std::function<void()> callback) {
   bytes_received_vec[received_pointer] += num_bytes;
+  mux.ReceiveAsync(channel_id, buf, num_bytes, std::move(callback));
 }
 
 void Channel::Send(uint8_t* buf, uint64_t num_bytes) {
-  send_socket.send((void*) buf, num_bytes, ZMQ_DONTWAIT);
+  zmq::message_t msg(buf, num_bytes);
+  mux.Send(channel_id, msg, ZMQ_DONTWAIT);
   bytes_sent_vec[sent_pointer] += num_bytes;
 }
 
 void Channel::SendBlocking(uint8_t* buf, uint64_t num_bytes) {
-  send_socket.send((void*) buf, num_bytes, 0);
+  zmq::message_t msg(buf, num_bytes);
+  mux.Send(channel_id, msg, 0);
+  bytes_sent_vec[sent_pointer] += num_bytes;
+}
+
+void Channel::Send(std::unique_ptr<uint8_t[]> buf, uint64_t num_bytes) {
+  SendOwned(std::move(buf), num_bytes, ZMQ_DONTWAIT);
+}
+
+void Channel::SendBlocking(std::unique_ptr<uint8_t[]> buf, uint64_t num_bytes) {
+  SendOwned(std::move(buf), num_bytes, 0);
+}
+
+void Channel::Send(std::shared_ptr<uint8_t> owner, uint8_t* buf, uint64_t num_bytes) {
+  if (num_bytes < ZERO_COPY_MIN_BYTES) {
+    Send(buf, num_bytes);
+    return;
+  }
+  zmq::message_t msg(buf, num_bytes, ReleaseSharedBuffer, new std::shared_ptr<uint8_t>(std::move(owner)));
+  mux.Send(channel_id, msg, ZMQ_DONTWAIT);
+  bytes_sent_vec[sent_pointer] += num_bytes;
+}
+
+void Channel::SendOwned(std::unique_ptr<uint8_t[]> buf, uint64_t num_bytes, int flags) {
+  if (num_bytes < ZERO_COPY_MIN_BYTES) {
+    zmq::message_t msg(buf.get(), num_bytes);
+    mux.Send(channel_id, msg, flags);
+  } else {
+    //ZMQ calls FreeSentBuffer from its IO thread when done with the message, also if the send fails
+    zmq::message_t msg(buf.release(), num_bytes, FreeSentBuffer);
+    mux.Send(channel_id, msg, flags);
+  }
   bytes_sent_vec[sent_pointer] += num_bytes;
 }
 
@@ -68,4 +119,32 @@ uint64_t Channel::GetTotalBytesSent() {
     res += t;
   }
   return res;
-}
\ No newline at end of file
+}
+ReceiveGroup::ReceiveGroup() : num_added(0), num_returned(0) {
+}
+
+int ReceiveGroup::Add(Channel& chan, uint8_t* buf, uint64_t num_bytes) {
+  int idx = num_added++;
+  chan.ReceiveAsync(buf, num_bytes, [this, idx]() {
+    std::lock_guard<std::mutex> lock(completed_mutex);
+    completed.push_back(idx);
+    completed_changed.notify_one();
+  });
+  return idx;
+}
+
+int ReceiveGroup::WaitAny() {
+  if (num_returned == num_added) {
+    return -1;
+  }
+  std::unique_lock<std::mutex> lock(completed_mutex);
+  completed_changed.wait(lock, [this] { return !completed.empty(); });
+  int idx = completed.front();
+  completed.pop_front();
+  ++num_returned;
+  return idx;
+}
+
+void ReceiveGroup::WaitAll() {
+  while (WaitAny() != -1);
+}
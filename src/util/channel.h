@@ -3,11 +3,13 @@
 
 #include "util/util.h"
 
-#include "zeromq/include/zmq.hpp"
+#include "util/multiplexer.h"
+
+#include <future>
 
 class Channel {
 public:
-  Channel(std::string ip_address, uint16_t port_push, uint16_t port_pull, uint8_t net_role, zmq::context_t& context);
+  Channel(Multiplexer& mux, uint32_t channel_id);
 
   std::vector<uint64_t> bytes_received_vec;
   std::vector<uint64_t> bytes_sent_vec;
@@ -15,11 +17,24 @@ public:
   uint64_t received_pointer;
   uint64_t sent_pointer;
 
-  void Receive(uint8_t* buf, uint64_t num_bytes);
+  //Returns false and leaves buf untouched if no message has arrived yet
+  bool Receive(uint8_t* buf, uint64_t num_bytes);
   void ReceiveBlocking(uint8_t* buf, uint64_t num_bytes);
+
+  //Receives the next message into buf without blocking the caller. buf must stay valid until the receive completes. The callback variant runs callback on the multiplexer receive thread if the message has not arrived yet, so it should only do light work.
+  std::future<void> ReceiveAsync(uint8_t* buf, uint64_t num_bytes);
+  void ReceiveAsync(uint8_t* buf, uint64_t num_bytes, std::function<void()> callback);
+  //Send blocks only while the channel's credit window is full, see Multiplexer
   void Send(uint8_t* buf, uint64_t num_bytes);
   void SendBlocking(uint8_t* buf, uint64_t num_bytes);
 
+  //Ownership of buf is handed to ZMQ, which frees it once written to the wire. Messages below ZERO_COPY_MIN_BYTES are copied as in Send.
+  void Send(std::unique_ptr<uint8_t[]> buf, uint64_t num_bytes);
+  void SendBlocking(std::unique_ptr<uint8_t[]> buf, uint64_t num_bytes);
+
+  //Sends num_bytes from buf, which must point into owner, without copying. Each message holds a reference to owner so slices of one buffer can be sent as they are produced.
+  void Send(std::shared_ptr<uint8_t> owner, uint8_t* buf, uint64_t num_bytes);
+
   void ResetSentBytes();
   void ResetReceivedBytes();
   uint64_t GetCurrentBytesReceived();
@@ -27,14 +42,30 @@ public:
   uint64_t GetCurrentBytesSent();
   uint64_t GetTotalBytesSent();
 
-  zmq::socket_t receive_socket;
-  zmq::socket_t send_socket;
+  Multiplexer& mux;
+  uint32_t channel_id;
+
+private:
+  void SendOwned(std::unique_ptr<uint8_t[]> buf, uint64_t num_bytes, int flags);
+};
+
+//Waits for async receives on any number of channels. Each Add returns an index, and WaitAny returns the indices in the order the receives complete. The group must outlive all receives added to it.
+class ReceiveGroup {
+public:
+  ReceiveGroup();
+
+  int Add(Channel& chan, uint8_t* buf, uint64_t num_bytes);
 
+  //Returns the index of a completed receive not returned before, or -1 if all have been returned
+  int WaitAny();
+  void WaitAll();
 
-  uint8_t net_role;
-  std::string receive_s;
-  std::string send_s;
-  
+private:
+  int num_added;
+  int num_returned;
+  std::mutex completed_mutex;
+  std::condition_variable completed_changed;
+  std::deque<int> completed;
 };
 
 #endif /* TINY_UTIL_CHANNEL_H_ */
\ No newline at end of file
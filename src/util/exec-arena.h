@@ -0,0 +1,66 @@
+#ifndef TINY_UTIL_EXECARENA_H_
+#define TINY_UTIL_EXECARENA_H_
+
+#include "util/large-buffer.h"
+
+#define ARENA_ALIGN 16 //Enough for __m128i
+
+//Scratch memory of one exec for the buffers of a single circuit or online batch. Alloc hands out consecutive slices of one block and Reset frees all of them at once, so once the block is as large as the largest circuit needs, the per-circuit loops do no heap allocation. A slice that does not fit gets a block of its own, which keeps the slices handed out before it valid, and the next Reset replaces all blocks with a single one large enough for everything used since the last Reset. Slices are uninitialized and only valid until the next Reset.
+class ExecArena {
+public:
+  ExecArena() : capacity(0), used(0), overflow_bytes(0) {
+  }
+
+  //Bytes taken from the arena by a slice of num_bytes, for computing what to Reserve
+  static uint64_t SliceBytes(uint64_t num_bytes) {
+    return PAD_TO_MULTIPLE(num_bytes, ARENA_ALIGN);
+  }
+
+  //Frees all slices
+  void Reset() {
+    if (!overflow.empty()) {
+      uint64_t needed = used + overflow_bytes;
+      overflow.clear();
+      overflow_bytes = 0;
+      Grow(needed);
+    }
+    used = 0;
+  }
+
+  //Frees all slices, as an exec leaves its last ones in use when it finishes, and grows the block to at least num_bytes
+  void Reserve(uint64_t num_bytes) {
+    Reset();
+    Grow(num_bytes);
+  }
+
+  template<typename T> T* Alloc(uint64_t num_elements) {
+    uint64_t num_bytes = SliceBytes(num_elements * sizeof(T));
+    if (used + num_bytes <= capacity) {
+      uint8_t* slice = block.get() + used;
+      used += num_bytes;
+      return (T*) slice;
+    }
+
+    overflow.emplace_back(MakeLarge<uint8_t>(num_bytes));
+    overflow_bytes += num_bytes;
+    return (T*) overflow.back().get();
+  }
+
+private:
+  void Grow(uint64_t num_bytes) {
+    if (num_bytes > capacity) {
+      block = MakeLarge<uint8_t>(num_bytes);
+      capacity = num_bytes;
+    }
+  }
+
+  std::unique_ptr<uint8_t[]> block;
+  uint64_t capacity;
+  uint64_t used;
+
+  //Blocks of the slices that did not fit since the last Reset
+  std::vector<std::unique_ptr<uint8_t[]>> overflow;
+  uint64_t overflow_bytes;
+};
+
+#endif /* TINY_UTIL_EXECARENA_H_ */
@@ -37,8 +37,18 @@ static uint8_t global_aes_key[AES_KEY_BYTES] = {0x2b, 0x7e, 0x15, 0x16, 0x28, 0x
 
 //Channels
 #define GLOBAL_PARAMS_CHAN OT_ADMIN_CHANNEL-1
+#define OT_EXT_CHAN (1 << 16) //OT extension traffic of the params with exec id x goes to OT_EXT_CHAN + x, above any 16 bit channel id
+#define PRODUCER_PARAMS_CHAN GLOBAL_PARAMS_CHAN-1 //Main params of the background preprocessing instance
+#define BATCH_CHAN_STRIDE 1024 //The execs of background batch k use the channels from BATCH_CHAN_STRIDE * (1 + k % NUM_BATCH_CHAN_SLOTS)
+#define NUM_BATCH_CHAN_SLOTS 16
 
-#define MAX_TOTAL_PARAMS 10000 //Can be up to 65532, but performance seems to decrease
+#define MUX_POLL_TIMEOUT 100 //ms between checks for shutdown in the multiplexer receive thread
+#define MUX_CREDIT_CHAN 0xFFFFFFFF //Carries the flow control credits of the multiplexer, never used by a Channel
+#define MUX_CHANNEL_WINDOW (1 << 27) //Bytes a channel may have sent but not yet read by the other party before its sends block
+#define SHM_RING_SIZE (1 << 24) //Bytes pr. direction for shm:// channels
+#define SHM_SPIN_ITERATIONS 4096 //Spins on an empty or full ring before sleeping
+#define BUSY_POLL_TIME 1000 //us to keep polling after a message in busy-poll mode
+#define ZERO_COPY_MIN_BYTES 65536 //Smaller owned sends are copied, the ZMQ free callback is not worth it
 
 //HACKS
 #define LLAN_MACHINE_CORES 8
@@ -50,6 +60,16 @@ static uint8_t global_aes_key[AES_KEY_BYTES] = {0x2b, 0x7e, 0x15, 0x16, 0x28, 0x
 #define NUM_IO_THREADS 4
 #define TP_MUL_FACTOR 8
 
+//Bucketing permutation
+#define PERMUTE_BUCKET_SIZE 65536 //Expected elements pr. local shuffle, keeps each shuffle in L2
+
+//Pipelined garbling
+#define GARBLING_CHUNK_SIZE 16384 //Gates or auths garbled pr. sent message
+
+//Online phase
+#define ONLINE_BATCH_SIZE 64 //Circuits pr. exec sharing one round trip
+#define TASKS_PR_EXEC 4 //Circuit tasks pr. requested exec in Offline and Online
+
 //Timings
 #define EVAL_COMMIT_TIME 0
 #define EVAL_VERLEAK_TIME 1
@@ -0,0 +1,51 @@
+#ifndef TINY_UTIL_LARGEBUFFER_H_
+#define TINY_UTIL_LARGEBUFFER_H_
+
+#include "util/util.h"
+
+#include <sys/mman.h>
+#include <unistd.h>
+
+#define HUGE_PAGE_SIZE 2097152
+#define SMALL_PAGE_SIZE 4096
+
+//Asks for transparent hugepages on the part of buf that is made up of whole aligned hugepages, which for the buffers this is used on is all but at most two of them. Without THP support, or in THP's "never" mode, this does nothing
+static inline void AdviseHugePages(void* buf, uint64_t num_bytes) {
+  uint64_t begin = PAD_TO_MULTIPLE((uint64_t) buf, HUGE_PAGE_SIZE);
+  uint64_t end = ((uint64_t) buf + num_bytes) / HUGE_PAGE_SIZE * HUGE_PAGE_SIZE;
+  if (end > begin) {
+    madvise((void*) begin, end - begin, MADV_HUGEPAGE);
+  }
+}
+
+//Zeroes buf from all threads of thread_pool, so the page faults and the zeroing run in parallel instead of in the thread that allocated buf. Pages follow the memory policy of buf, so an interleaved buf stays interleaved. The threads of thread_pool must not be busy running the caller
+static inline void ZeroPages(uint8_t* buf, uint64_t num_bytes, ctpl::thread_pool& thread_pool) {
+  uint64_t num_pages = CEIL_DIVIDE(num_bytes, SMALL_PAGE_SIZE);
+  int num_chunks = std::min((uint64_t) thread_pool.size(), num_pages);
+  std::vector<int> from, to;
+  PartitionBufferFixedNum(from, to, num_chunks, num_pages);
+
+  std::vector<std::future<void>> futures(num_chunks);
+  for (int c = 0; c < num_chunks; ++c) {
+    futures[c] = thread_pool.push([buf, num_bytes, &from, &to, c](int id) {
+      uint64_t begin = (uint64_t) from[c] * SMALL_PAGE_SIZE;
+      uint64_t end = std::min((uint64_t) to[c] * SMALL_PAGE_SIZE, num_bytes);
+      std::fill(buf + begin, buf + end, 0);
+    });
+  }
+  for (std::future<void>& f : futures) {
+    f.wait();
+  }
+}
+
+//For large protocol arrays that are written in full before they are read. Unlike make_unique the elements are left uninitialized, so no thread spends time zeroing memory that is overwritten anyway, and buffers of at least a hugepage are backed by hugepages to cut the TLB misses of the random accesses during soldering. Arrays that are read, or XOR'ed into, before being written must not use this
+template<typename T> std::unique_ptr<T[]> MakeLarge(uint64_t num_elements) {
+  std::unique_ptr<T[]> arr(new T[num_elements]);
+  uint64_t num_bytes = num_elements * sizeof(T);
+  if (num_bytes >= HUGE_PAGE_SIZE) {
+    AdviseHugePages(arr.get(), num_bytes);
+  }
+  return arr;
+}
+
+#endif /* TINY_UTIL_LARGEBUFFER_H_ */
@@ -0,0 +1,241 @@
+#include "util/multiplexer.h"
+
+#include <pthread.h>
+
+Multiplexer::Multiplexer(std::string address, uint16_t port, uint8_t net_role, zmq::context_t& context) : busy_poll(false), transport(Transport::Create(address, port, net_role, context)), has_background(false), background_ns_pr_byte(0), background_free(GET_TIME()), running(true) {
+  receive_thread = std::thread(&Multiplexer::ReceiveLoop, this);
+}
+
+Multiplexer::~Multiplexer() {
+  running = false;
+  receive_thread.join();
+}
+
+void Multiplexer::Send(uint32_t channel_id, zmq::message_t& msg, int flags) {
+  if (has_background) {
+    PaceBackground(channel_id, msg.size());
+  }
+
+  //Credits themselves are not limited. Neither are sends from handlers, as they run on the receive thread, which is the one that takes in the credit
+  if (channel_id != MUX_CREDIT_CHAN) {
+    std::unique_lock<std::mutex> credit_lock(credit_mutex);
+    uint64_t& sent = in_flight[channel_id];
+    if (std::this_thread::get_id() != receive_thread.get_id()) {
+      credit_returned.wait(credit_lock, [&sent] { return sent < MUX_CHANNEL_WINDOW; });
+    }
+    sent += msg.size();
+  }
+
+  std::lock_guard<std::mutex> lock(send_mutex);
+  transport->Send(channel_id, msg, flags);
+}
+
+static void CopyMessage(zmq::message_t& msg, uint8_t* buf, uint64_t num_bytes) {
+  //As with a plain ZMQ receive, a larger message is truncated to num_bytes
+  std::copy((uint8_t*) msg.data(), (uint8_t*) msg.data() + std::min((uint64_t) msg.size(), num_bytes), buf);
+}
+
+void Multiplexer::ReceiveAsync(uint32_t channel_id, uint8_t* buf, uint64_t num_bytes, std::function<void()> done) {
+  std::unique_lock<std::mutex> lock(receive_mutex);
+  ChannelQueue& queue = GetQueue(channel_id);
+  if (queue.messages.empty()) {
+    queue.pending.push_back({buf, num_bytes, std::move(done)});
+    return;
+  }
+
+  zmq::message_t msg(std::move(queue.messages.front()));
+  queue.messages.pop_front();
+  uint64_t credit = Consume(queue, msg.size());
+  lock.unlock();
+
+  CopyMessage(msg, buf, num_bytes);
+  SendCredit(channel_id, credit);
+  done();
+}
+
+bool Multiplexer::TryReceive(uint32_t channel_id, uint8_t* buf, uint64_t num_bytes) {
+  std::unique_lock<std::mutex> lock(receive_mutex);
+  ChannelQueue& queue = GetQueue(channel_id);
+  if (queue.messages.empty()) {
+    return false;
+  }
+
+  zmq::message_t msg(std::move(queue.messages.front()));
+  queue.messages.pop_front();
+  uint64_t credit = Consume(queue, msg.size());
+  lock.unlock();
+
+  CopyMessage(msg, buf, num_bytes);
+  SendCredit(channel_id, credit);
+  return true;
+}
+
+void Multiplexer::SetHandler(uint32_t channel_id, std::function<void(zmq::message_t&)> handler) {
+  std::unique_lock<std::mutex> lock(receive_mutex);
+  ChannelQueue& queue = GetQueue(channel_id);
+  handler_done.wait(lock, [&queue] { return queue.handler_calls == 0; });
+  queue.handler = std::move(handler);
+  if (!queue.handler || queue.messages.empty()) {
+    return;
+  }
+
+  ++queue.handler_calls;
+  RunHandler(lock, channel_id, queue, NULL);
+  --queue.handler_calls;
+  handler_done.notify_all();
+}
+
+void Multiplexer::RunHandler(std::unique_lock<std::mutex>& lock, uint32_t channel_id, ChannelQueue& queue, zmq::message_t* msg) {
+  //Messages that arrive during a call are queued by the receive thread, so they are taken from the queue in order until it is empty
+  if (msg != NULL) {
+    queue.messages.emplace_back(std::move(*msg));
+  }
+  std::function<void(zmq::message_t&)> handler = queue.handler;
+  while (!queue.messages.empty()) {
+    zmq::message_t next(std::move(queue.messages.front()));
+    queue.messages.pop_front();
+    uint64_t credit = Consume(queue, next.size());
+    lock.unlock();
+
+    handler(next);
+    SendCredit(channel_id, credit);
+    lock.lock();
+  }
+}
+
+void Multiplexer::SetBusyPoll(bool enable) {
+  cpu_set_t cpus;
+  CPU_ZERO(&cpus);
+  int num_cpus = std::thread::hardware_concurrency();
+  if (enable) {
+    CPU_SET(num_cpus - 1, &cpus);
+  } else {
+    for (int i = 0; i < num_cpus; ++i) {
+      CPU_SET(i, &cpus);
+    }
+  }
+  pthread_setaffinity_np(receive_thread.native_handle(), sizeof(cpu_set_t), &cpus);
+  busy_poll = enable;
+}
+
+void Multiplexer::SetBackgroundRate(double mbit) {
+  std::lock_guard<std::mutex> lock(background_mutex);
+  background_ns_pr_byte = mbit > 0 ? 8000 / mbit : 0;
+  has_background = background_ns_pr_byte > 0 && !background_channels.empty();
+}
+
+void Multiplexer::SetBackground(uint32_t channel_id, bool enable) {
+  std::lock_guard<std::mutex> lock(background_mutex);
+  if (enable) {
+    background_channels.insert(channel_id);
+  } else {
+    background_channels.erase(channel_id);
+  }
+  has_background = background_ns_pr_byte > 0 && !background_channels.empty();
+}
+
+void Multiplexer::PaceBackground(uint32_t channel_id, uint64_t num_bytes) {
+  std::unique_lock<std::mutex> lock(background_mutex);
+  if (background_ns_pr_byte == 0 || background_channels.count(channel_id) == 0) {
+    return;
+  }
+
+  //Same accounting as WANTransport, but the sender waits out its own slot instead of queueing the message
+  auto start = std::max(background_free, GET_TIME());
+  background_free = start + std::chrono::nanoseconds((int64_t) (num_bytes * background_ns_pr_byte));
+  lock.unlock();
+
+  std::this_thread::sleep_until(start);
+}
+
+uint64_t Multiplexer::Consume(ChannelQueue& queue, uint64_t num_bytes) {
+  //Credit is returned once half a window has been read. The sender only blocks with a full window outstanding, so at that point more than half of it is still unread here and reading it is certain to return credit
+  queue.unreported += num_bytes;
+  if (queue.unreported < MUX_CHANNEL_WINDOW / 2) {
+    return 0;
+  }
+  uint64_t credit = queue.unreported;
+  queue.unreported = 0;
+  return credit;
+}
+
+void Multiplexer::SendCredit(uint32_t channel_id, uint64_t num_bytes) {
+  if (num_bytes == 0) {
+    return;
+  }
+  zmq::message_t msg(sizeof(uint32_t) + sizeof(uint64_t));
+  std::copy((uint8_t*) &channel_id, (uint8_t*) &channel_id + sizeof(uint32_t), (uint8_t*) msg.data());
+  std::copy((uint8_t*) &num_bytes, (uint8_t*) &num_bytes + sizeof(uint64_t), (uint8_t*) msg.data() + sizeof(uint32_t));
+  Send(MUX_CREDIT_CHAN, msg, ZMQ_DONTWAIT);
+}
+
+void Multiplexer::ReceiveCredit(zmq::message_t& msg) {
+  uint32_t channel_id;
+  uint64_t num_bytes;
+  std::copy((uint8_t*) msg.data(), (uint8_t*) msg.data() + sizeof(uint32_t), (uint8_t*) &channel_id);
+  std::copy((uint8_t*) msg.data() + sizeof(uint32_t), (uint8_t*) msg.data() + sizeof(uint32_t) + sizeof(uint64_t), (uint8_t*) &num_bytes);
+
+  std::lock_guard<std::mutex> lock(credit_mutex);
+  in_flight[channel_id] -= num_bytes;
+  credit_returned.notify_all();
+}
+
+Multiplexer::ChannelQueue& Multiplexer::GetQueue(uint32_t channel_id) {
+  std::unique_ptr<ChannelQueue>& queue = queues[channel_id];
+  if (!queue) {
+    queue = std::make_unique<ChannelQueue>();
+  }
+  return *queue;
+}
+
+void Multiplexer::ReceiveLoop() {
+  auto last_message = GET_TIME();
+  while (running) {
+    //Wait with a timeout so the destructor can stop the thread before the transport is closed. In busy-poll mode we do not wait at all shortly after a message, as the next one is likely to follow soon
+    long timeout = MUX_POLL_TIMEOUT;
+    if (busy_poll && GET_TIME() - last_message < std::chrono::microseconds(BUSY_POLL_TIME)) {
+      timeout = 0;
+    }
+
+    uint32_t channel_id;
+    zmq::message_t msg;
+    if (!transport->Receive(channel_id, msg, timeout)) {
+      continue;
+    }
+    last_message = GET_TIME();
+
+    if (channel_id == MUX_CREDIT_CHAN) {
+      ReceiveCredit(msg);
+      continue;
+    }
+
+    std::unique_lock<std::mutex> lock(receive_mutex);
+    ChannelQueue& queue = GetQueue(channel_id);
+    if (queue.handler) {
+      //SetHandler is passing on queued messages, and will take this one too
+      if (queue.handler_calls > 0) {
+        queue.messages.emplace_back(std::move(msg));
+        continue;
+      }
+      ++queue.handler_calls;
+      RunHandler(lock, channel_id, queue, &msg);
+      --queue.handler_calls;
+      handler_done.notify_all();
+      continue;
+    }
+    if (queue.pending.empty()) {
+      queue.messages.emplace_back(std::move(msg));
+      continue;
+    }
+
+    //Someone is already waiting, so the message is copied straight into their buffer
+    PendingReceive request(std::move(queue.pending.front()));
+    queue.pending.pop_front();
+    uint64_t credit = Consume(queue, msg.size());
+    lock.unlock();
+
+    CopyMessage(msg, request.buf, request.num_bytes);
+    SendCredit(channel_id, credit);
+    request.done();
+  }
+}
@@ -0,0 +1,102 @@
+#ifndef TINY_UTIL_MULTIPLEXER_H_
+#define TINY_UTIL_MULTIPLEXER_H_
+
+#include "util/util.h"
+#include "util/transport.h"
+
+#include <mutex>
+#include <condition_variable>
+#include <deque>
+#include <unordered_map>
+#include <unordered_set>
+#include <functional>
+
+//Carries all Channels of a party over a single Transport, so only two TCP connections (or two shared memory rings) are needed regardless of the number of executions. Every message is tagged with the id of its channel. A dedicated thread receives all messages and queues them pr. channel, so a channel that is not being read never stalls the others.
+//Each channel has a credit window of MUX_CHANNEL_WINDOW bytes. The receiving party returns credit on MUX_CREDIT_CHAN as its side reads the messages of a channel, and a send on a channel that already has a full window unread at the other party blocks until credit comes back. This bounds the memory a channel that is not being read can take, without stalling the other channels the way a limit on the shared socket would.
+class Multiplexer {
+public:
+  Multiplexer(std::string address, uint16_t port, uint8_t net_role, zmq::context_t& context);
+  ~Multiplexer();
+
+  //flags are passed on to the transport. The wait for credit blocks regardless of them, so ZMQ_DONTWAIT is no longer non-blocking on a channel with a full window, as dropping or failing the message would break the protocol on top
+  void Send(uint32_t channel_id, zmq::message_t& msg, int flags);
+
+  //Copies the next message of channel_id into buf, truncated to num_bytes, and then calls done. If no message is queued the request is stored and completed by the receive thread as soon as the message arrives, so done might run on that thread and should be short. Requests on a channel complete in the order they are made.
+  void ReceiveAsync(uint32_t channel_id, uint8_t* buf, uint64_t num_bytes, std::function<void()> done);
+
+  //Only succeeds if a message is queued and no earlier request is waiting
+  bool TryReceive(uint32_t channel_id, uint8_t* buf, uint64_t num_bytes);
+
+  //All messages of channel_id, including those already queued, are passed to handler on the receive thread instead of being queued. Used for protocols that demultiplex their own traffic, such as the OT extension. An empty handler removes it again. Handlers run without any multiplexer lock held, so a slow handler only delays the messages behind it on the receive thread, but SetHandler waits for a running call to finish, so the handler never runs after it has been removed.
+  void SetHandler(uint32_t channel_id, std::function<void(zmq::message_t&)> handler);
+
+  //Latency mode for phases with few, small round trips. The receive thread is pinned to the last core and keeps polling the transport for BUSY_POLL_TIME after each message before it goes back to sleeping waits, and ReceiveBlocking spins for the same time before blocking.
+  void SetBusyPoll(bool enable);
+
+  //Sends on background channels are paced so together they use at most mbit Mbit/s, leaving the rest of the link to the other channels. This is an absolute rate, foreground traffic is not accounted against it. The caller is blocked until its message is due. A rate of 0 turns pacing off
+  void SetBackgroundRate(double mbit);
+  void SetBackground(uint32_t channel_id, bool enable);
+
+  std::atomic<bool> busy_poll;
+
+private:
+  struct PendingReceive {
+    uint8_t* buf;
+    uint64_t num_bytes;
+    std::function<void()> done;
+  };
+
+  //At most one of messages and pending is non-empty at any time, and both are empty if handler is set and no handler call is running
+  struct ChannelQueue {
+    std::deque<zmq::message_t> messages;
+    std::deque<PendingReceive> pending;
+    std::function<void(zmq::message_t&)> handler;
+
+    //Calls of handler in progress. While a call runs, arriving messages are queued and passed on by that call's thread in order
+    int handler_calls = 0;
+
+    //Bytes read on this side that have not been returned as credit yet
+    uint64_t unreported = 0;
+  };
+
+  //Needs receive_mutex to be held
+  ChannelQueue& GetQueue(uint32_t channel_id);
+
+  //Called with receive_mutex held on lock when num_bytes of the channel have been read. Returns the credit to send once the lock is released, or 0 if it is too little to be worth a message
+  uint64_t Consume(ChannelQueue& queue, uint64_t num_bytes);
+  void SendCredit(uint32_t channel_id, uint64_t num_bytes);
+  void ReceiveCredit(zmq::message_t& msg);
+
+  //Passes msg and then any messages queued meanwhile to the handler of channel_id. Needs lock to hold receive_mutex and handler_calls to be raised, and returns with both unchanged
+  void RunHandler(std::unique_lock<std::mutex>& lock, uint32_t channel_id, ChannelQueue& queue, zmq::message_t* msg);
+
+  void ReceiveLoop();
+  void PaceBackground(uint32_t channel_id, uint64_t num_bytes);
+
+  std::unique_ptr<Transport> transport;
+
+  //Transports are not thread safe, so all sends are serialized
+  std::mutex send_mutex;
+
+  std::mutex receive_mutex;
+  std::condition_variable handler_done;
+  std::unordered_map<uint32_t, std::unique_ptr<ChannelQueue>> queues;
+
+  //Bytes sent pr. channel that the other party has not returned as credit yet
+  std::mutex credit_mutex;
+  std::condition_variable credit_returned;
+  std::unordered_map<uint32_t, uint64_t> in_flight;
+
+  std::mutex background_mutex;
+  std::unordered_set<uint32_t> background_channels;
+  std::atomic<bool> has_background;
+  double background_ns_pr_byte;
+
+  //Time at which the background share of the link has finished all background sends so far
+  std::chrono::high_resolution_clock::time_point background_free;
+
+  std::atomic<bool> running;
+  std::thread receive_thread;
+};
+
+#endif /* TINY_UTIL_MULTIPLEXER_H_ */
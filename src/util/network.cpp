@@ -1,114 +1,54 @@
 #include "util/network.h"
 
-Network::Network(const char* m_nAddr, USHORT m_nPort) : m_nAddr(m_nAddr) {
-  m_vSocket = new CSocket();
-
-  sndthread = new SndThread(m_vSocket);
-  rcvthread = new RcvThread(m_vSocket);
-
-  this->m_nPort = m_nPort;
+MuxSndThread::MuxSndThread(Multiplexer& mux, uint32_t channel_id, std::atomic<uint64_t>& bytes_sent) : SndThread(NULL), mux(mux), channel_id(channel_id), bytes_sent(bytes_sent) {
 }
 
-void Network::ConnectAndStart() {
-  Connect();
-  sndthread->Start();
-  rcvthread->Start();
-}
+void MuxSndThread::push_task(uint16_t channelid, uint8_t* prefix, uint64_t prefixlen, uint8_t* sndbuf, uint64_t sndbytes) {
+  //The task is written straight into the message, so neither a slot nor the send thread is involved
+  zmq::message_t msg(sizeof(uint16_t) + prefixlen + sndbytes);
+  uint8_t* data = (uint8_t*) msg.data();
+  std::copy((uint8_t*) &channelid, (uint8_t*) &channelid + sizeof(uint16_t), data);
+  std::copy(prefix, prefix + prefixlen, data + sizeof(uint16_t));
+  std::copy(sndbuf, sndbuf + sndbytes, data + sizeof(uint16_t) + prefixlen);
+  bytes_sent += prefixlen + sndbytes;
 
-void Network::ListenAndStart() {
-  Listen();
-  sndthread->Start();
-  rcvthread->Start();
+  mux.Send(channel_id, msg, 0);
 }
 
-BOOL Network::Connect() {
-  bool bFail = FALSE;
-  uint64_t lTO = CONNECT_TIMEO_MILISEC;
-
-  for (int k = 0; k >= 0 ; k--)
-  {
-    for ( int i = 0; i < RETRY_CONNECT; i++ )
-    {
-      if ( !m_vSocket->Socket() )
-      {
-        printf("Socket failure: ");
-        goto connect_failure;
-      }
-
-      if ( m_vSocket->Connect( m_nAddr, m_nPort, lTO))
-      {
-        // send pid when connected
-        m_vSocket->Send( &k, sizeof(int) );
-        if (k == 0)
-        {
-          //std::cout << "connected" << std::endl;
-          return TRUE;
-        }
-        else
-        {
-          break;
-        }
-        SleepMiliSec(10);
-        m_vSocket->Close();
-      }
-      SleepMiliSec(20);
-      if (i + 1 == RETRY_CONNECT)
-        goto server_not_available;
-    }
-  }
-server_not_available:
-  printf("Server not available: ");
-connect_failure:
-  return FALSE;
-}
+Network::Network(Multiplexer& mux, uint32_t channel_id) : mux(mux), channel_id(channel_id), bytes_sent(0), bytes_received(0) {
+  sndthread = std::make_unique<MuxSndThread>(mux, channel_id, bytes_sent);
+  rcvthread = std::make_unique<RcvThread>((CSocket*) NULL);
 
-BOOL Network::Listen() {
-#ifdef TINY_PRINT
-  std::cout << "Listening: " << m_nAddr << ":" << m_nPort << ", with size: " << std::endl;
-#endif
-  if ( !m_vSocket->Socket() )
-  {
-    goto listen_failure;
-  }
-  if ( !m_vSocket->Bind(m_nPort, m_nAddr) )
-    goto listen_failure;
-  if ( !m_vSocket->Listen() )
-    goto listen_failure;
+  mux.SetHandler(channel_id, [this](zmq::message_t& msg) {
+    uint16_t ot_channel_id;
+    uint64_t num_bytes = msg.size() - sizeof(uint16_t);
+    std::copy((uint8_t*) msg.data(), (uint8_t*) msg.data() + sizeof(uint16_t), (uint8_t*) &ot_channel_id);
 
-  for ( int i = 0; i < 1; i++ ) //twice the actual number, due to double sockets for OT
-  {
-    CSocket sock;
-    //std::cout << "New round! " << std::endl;
-    if ( !m_vSocket->Accept(sock) )
-    {
-      std::cerr << "Error in accept" << std::endl;
-      goto listen_failure;
+    //The OT extension frees received buffers itself
+    uint8_t* buf = NULL;
+    if (num_bytes > 0) {
+      buf = (uint8_t*) malloc(num_bytes);
+      std::copy((uint8_t*) msg.data() + sizeof(uint16_t), (uint8_t*) msg.data() + msg.size(), buf);
     }
+    bytes_received += num_bytes;
 
-    UINT threadID;
-    sock.Receive(&threadID, sizeof(int));
+    rcvthread->deliver(ot_channel_id, buf, num_bytes);
+  });
+}
 
-    if ( threadID >= 1)
-    {
-      sock.Close();
-      i--;
-      continue;
-    }
+Network::~Network() {
+  mux.SetHandler(channel_id, nullptr);
+}
 
-#ifdef TINY_PRINT
-    std::cout <<  " (" << role << ") (" << threadID << ") connection accepted" << std::endl;
-#endif
-    // locate the socket appropriately
-    m_vSocket->AttachFrom(sock);
-    sock.Detach();
-  }
+uint64_t Network::GetBytesSent() {
+  return bytes_sent;
+}
 
-#ifdef TINY_PRINT
-  std::cout << "Listening finished"  << std::endl;
-#endif
-  return TRUE;
+uint64_t Network::GetBytesReceived() {
+  return bytes_received;
+}
 
-listen_failure:
-  std::cout << "Listen failed" << std::endl;
-  return FALSE;
-}
\ No newline at end of file
+void Network::ResetBytes() {
+  bytes_sent = 0;
+  bytes_received = 0;
+}
@@ -1,28 +1,44 @@
 #ifndef TINY_UTIL_NETWORK_H_
 #define TINY_UTIL_NETWORK_H_
 
-#include "OTExtension/util/socket.h"
+#include "util/multiplexer.h"
+
 #include "OTExtension/util/rcvthread.h"
 #include "OTExtension/util/sndthread.h"
 #include "OTExtension/util/channel.h"
 
-#define RETRY_CONNECT   1000
-#define CONNECT_TIMEO_MILISEC 10000
+//Sends OT extension tasks as multiplexer messages straight from the calling thread, so the send thread is never started
+class MuxSndThread : public SndThread {
+public:
+  MuxSndThread(Multiplexer& mux, uint32_t channel_id, std::atomic<uint64_t>& bytes_sent);
+
+  void push_task(uint16_t channelid, uint8_t* prefix, uint64_t prefixlen, uint8_t* sndbuf, uint64_t sndbytes);
+
+private:
+  Multiplexer& mux;
+  uint32_t channel_id;
+  std::atomic<uint64_t>& bytes_sent;
+};
 
+//Runs the OT extension over a channel of the Multiplexer, so it shares the connection, transport and receive thread with all other traffic. Each message carries the 16 bit id of its OT channel in front of the payload, and the multiplexer receive thread hands it directly to the RcvThread listeners.
 class Network {
 public:
-  Network(const char m_nAddr[], USHORT m_nPort);
-
-  void ConnectAndStart();
-  void ListenAndStart();
-  BOOL Connect();
-  BOOL Listen();
-
-  const char* m_nAddr;
-  USHORT m_nPort;
-  CSocket* m_vSocket;
-  SndThread* sndthread;
-  RcvThread* rcvthread;
+  Network(Multiplexer& mux, uint32_t channel_id);
+  ~Network();
+
+  uint64_t GetBytesSent();
+  uint64_t GetBytesReceived();
+  void ResetBytes();
+
+  Multiplexer& mux;
+  uint32_t channel_id;
+  std::unique_ptr<SndThread> sndthread;
+  std::unique_ptr<RcvThread> rcvthread;
+
+private:
+  //Payload bytes, counted like in Channel
+  std::atomic<uint64_t> bytes_sent;
+  std::atomic<uint64_t> bytes_received;
 };
 
-#endif /* TINY_UTIL_NETWORK_H_ */
\ No newline at end of file
+#endif /* TINY_UTIL_NETWORK_H_ */
@@ -0,0 +1,93 @@
+#include "util/numa.h"
+
+#include <linux/mempolicy.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#define NUMA_MAX_NODES 64 //Node ids that fit in the mask passed to mbind
+
+NumaTopology& NumaTopology::Get() {
+  static NumaTopology topology;
+  return topology;
+}
+
+NumaTopology::NumaTopology() : num_nodes(0) {
+  for (int node = 0; node < NUMA_MAX_NODES; ++node) {
+    std::string path = "/sys/devices/system/node/node" + std::to_string(node) + "/cpulist";
+    FILE* file = fopen(path.c_str(), "r");
+    if (file == NULL) {
+      continue;
+    }
+
+    //A list of ranges such as 0-17,36-53
+    cpu_set_t cpus;
+    CPU_ZERO(&cpus);
+    int first, last;
+    while (fscanf(file, "%d", &first) == 1) {
+      last = first;
+      if (fgetc(file) == '-') {
+        if (fscanf(file, "%d", &last) != 1) {
+          break;
+        }
+        fgetc(file);
+      }
+      for (int cpu = first; cpu <= last && cpu < CPU_SETSIZE; ++cpu) {
+        CPU_SET(cpu, &cpus);
+      }
+    }
+    fclose(file);
+
+    //Memory-only nodes get no execs
+    if (CPU_COUNT(&cpus) > 0) {
+      node_cpus.emplace_back(cpus);
+      node_ids.emplace_back(node);
+    }
+  }
+
+  num_nodes = node_cpus.size();
+  if (num_nodes <= 1) {
+    num_nodes = 1;
+    node_cpus.clear();
+    node_ids.clear();
+  }
+}
+
+int NumaTopology::NodeOfExec(int exec_id, int num_execs) {
+  return (int64_t) exec_id * num_nodes / std::max(num_execs, 1);
+}
+
+void NumaTopology::Interleave(void* buf, uint64_t num_bytes) {
+  if (num_nodes <= 1) {
+    return;
+  }
+
+  //mbind works on whole pages, so only the pages that lie entirely inside buf are placed
+  uint64_t page_size = sysconf(_SC_PAGESIZE);
+  uint64_t begin = PAD_TO_MULTIPLE((uint64_t) buf, page_size);
+  uint64_t end = ((uint64_t) buf + num_bytes) / page_size * page_size;
+  if (end <= begin) {
+    return;
+  }
+
+  unsigned long node_mask = 0;
+  for (int node_id : node_ids) {
+    node_mask |= 1UL << node_id;
+  }
+
+  //Placement is only a hint, so a failure leaves the pages to the default policy
+  syscall(SYS_mbind, begin, end - begin, MPOL_INTERLEAVE, &node_mask, sizeof(node_mask) * CHAR_BIT, 0);
+}
+
+NodePin::NodePin(int node) : pinned(false) {
+  NumaTopology& topology = NumaTopology::Get();
+  if (topology.num_nodes <= 1 || sched_getaffinity(0, sizeof(cpu_set_t), &prev_cpus) != 0) {
+    return;
+  }
+  pinned = sched_setaffinity(0, sizeof(cpu_set_t), &topology.node_cpus[node % topology.num_nodes]) == 0;
+}
+
+NodePin::~NodePin() {
+  if (pinned) {
+    sched_setaffinity(0, sizeof(cpu_set_t), &prev_cpus);
+  }
+}
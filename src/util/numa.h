@@ -0,0 +1,48 @@
+#ifndef TINY_UTIL_NUMA_H_
+#define TINY_UTIL_NUMA_H_
+
+#include "util/util.h"
+
+#include <sched.h>
+
+//The NUMA nodes of the host and their cpus, read once from sysfs. A host without NUMA, or whose sysfs can not be read, is a single node holding all cpus, and then nothing is pinned or placed. Memory policies are set with the raw syscalls, so libnuma is not needed.
+class NumaTopology {
+public:
+  static NumaTopology& Get();
+
+  //Node of exec exec_id out of num_execs. Execs are given to the nodes in contiguous runs, as neighbouring execs work on neighbouring ranges of the global arrays
+  int NodeOfExec(int exec_id, int num_execs);
+
+  //Spreads the pages of buf round robin over all nodes. Only pages that have not been touched yet are placed, so call it right after allocating
+  void Interleave(void* buf, uint64_t num_bytes);
+
+  int num_nodes;
+  std::vector<cpu_set_t> node_cpus;
+
+  //Ids of the nodes in node_cpus, as sysfs may skip some
+  std::vector<int> node_ids;
+
+private:
+  NumaTopology();
+};
+
+//Pins the calling thread to the cpus of node while it exists, so the memory the thread touches first is allocated on that node. The previous affinity is restored afterwards, as pool threads run the execs of every node.
+class NodePin {
+public:
+  NodePin(int node);
+  ~NodePin();
+
+private:
+  bool pinned;
+  cpu_set_t prev_cpus;
+};
+
+//Zero-initialized array with its pages interleaved over all nodes, for global arrays that every exec reads at random
+template<typename T> std::unique_ptr<T[]> MakeInterleaved(uint64_t num_elements) {
+  std::unique_ptr<T[]> arr(new T[num_elements]);
+  NumaTopology::Get().Interleave(arr.get(), num_elements * sizeof(T));
+  std::fill(arr.get(), arr.get() + num_elements, T());
+  return arr;
+}
+
+#endif /* TINY_UTIL_NUMA_H_ */
@@ -0,0 +1,176 @@
+#include "util/shm-ring.h"
+
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <random>
+
+#define SHM_RING_MAGIC 0x54696e79526e6721
+
+//Spins briefly as the other side is usually active, then backs off so an idle ring does not burn a core
+static void RingBackoff(uint64_t& spins) {
+  if (spins < SHM_SPIN_ITERATIONS) {
+    _mm_pause();
+  } else {
+    std::this_thread::sleep_for(std::chrono::microseconds(50));
+  }
+  ++spins;
+}
+
+ShmRing::ShmRing(std::string name, uint64_t capacity, bool create) : name(name), created(create), map_size(sizeof(Header) + capacity), mask(capacity - 1) {
+  if (capacity & (capacity - 1)) {
+    throw std::runtime_error("Shared memory ring capacity must be a power of two.");
+  }
+
+  if (create) {
+    shm_unlink(name.c_str());
+    int fd = shm_open(name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0600);
+    if (fd < 0 || ftruncate(fd, map_size) != 0) {
+      throw std::runtime_error("Could not create shared memory ring " + name);
+    }
+    Map(fd);
+
+    header->capacity = capacity;
+    header->head.store(0, std::memory_order_relaxed);
+    header->tail.store(0, std::memory_order_relaxed);
+    header->client_token.store(0, std::memory_order_relaxed);
+    header->confirmed_token.store(0, std::memory_order_relaxed);
+    header->initialized.store(SHM_RING_MAGIC, std::memory_order_release);
+
+    uint64_t token;
+    while ((token = header->client_token.load(std::memory_order_acquire)) == 0) {
+      std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    header->confirmed_token.store(token, std::memory_order_release);
+    return;
+  }
+
+  //A fresh token pr. attempt, so a confirmation left in a stale ring never matches
+  std::random_device rd;
+  while (true) {
+    uint64_t token = ((uint64_t) rd() << 32) | rd() | 1;
+
+    //The creating party might not have started yet
+    int fd;
+    while ((fd = shm_open(name.c_str(), O_RDWR, 0600)) < 0) {
+      std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    struct stat st;
+    while (fstat(fd, &st) == 0 && (uint64_t) st.st_size < map_size) {
+      std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    ino_t inode = Map(fd);
+
+    bool current = true;
+    while (current && header->initialized.load(std::memory_order_acquire) != SHM_RING_MAGIC) {
+      std::this_thread::sleep_for(std::chrono::milliseconds(10));
+      current = IsCurrent(inode);
+    }
+    if (current) {
+      if (header->capacity != capacity) {
+        throw std::runtime_error("Shared memory ring " + name + " has mismatching capacity.");
+      }
+      header->client_token.store(token, std::memory_order_release);
+      while ((current = IsCurrent(inode)) && header->confirmed_token.load(std::memory_order_acquire) != token) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+      }
+      if (current) {
+        return;
+      }
+    }
+
+    //The ring was replaced by the creating side, so attach to the new one
+    munmap(header, map_size);
+  }
+}
+
+ino_t ShmRing::Map(int fd) {
+  struct stat st;
+  fstat(fd, &st);
+  void* map = mmap(NULL, map_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  close(fd);
+  if (map == MAP_FAILED) {
+    throw std::runtime_error("Could not map shared memory ring " + name);
+  }
+  header = (Header*) map;
+  data = (uint8_t*) map + sizeof(Header);
+  return st.st_ino;
+}
+
+bool ShmRing::IsCurrent(ino_t inode) {
+  int fd = shm_open(name.c_str(), O_RDONLY, 0600);
+  if (fd < 0) {
+    return false;
+  }
+  struct stat st;
+  bool current = fstat(fd, &st) == 0 && st.st_ino == inode;
+  close(fd);
+  return current;
+}
+
+ShmRing::~ShmRing() {
+  munmap(header, map_size);
+  if (created) {
+    shm_unlink(name.c_str());
+  }
+}
+
+void ShmRing::Write(const uint8_t* buf, uint64_t num_bytes) {
+  uint64_t tail = header->tail.load(std::memory_order_relaxed);
+  uint64_t capacity = mask + 1;
+  while (num_bytes > 0) {
+    uint64_t spins = 0;
+    uint64_t head;
+    while (tail - (head = header->head.load(std::memory_order_acquire)) == capacity) {
+      RingBackoff(spins);
+    }
+
+    //Copy as much as fits, split in two if it wraps around the end of the ring
+    uint64_t len = std::min(num_bytes, capacity - (tail - head));
+    uint64_t pos = tail & mask;
+    uint64_t first = std::min(len, capacity - pos);
+    std::copy(buf, buf + first, data + pos);
+    std::copy(buf + first, buf + len, data);
+
+    tail += len;
+    buf += len;
+    num_bytes -= len;
+    header->tail.store(tail, std::memory_order_release);
+  }
+}
+
+void ShmRing::Read(uint8_t* buf, uint64_t num_bytes) {
+  uint64_t head = header->head.load(std::memory_order_relaxed);
+  uint64_t capacity = mask + 1;
+  while (num_bytes > 0) {
+    uint64_t spins = 0;
+    uint64_t tail;
+    while ((tail = header->tail.load(std::memory_order_acquire)) == head) {
+      RingBackoff(spins);
+    }
+
+    uint64_t len = std::min(num_bytes, tail - head);
+    uint64_t pos = head & mask;
+    uint64_t first = std::min(len, capacity - pos);
+    std::copy(data + pos, data + pos + first, buf);
+    std::copy(data, data + len - first, buf + first);
+
+    head += len;
+    buf += len;
+    num_bytes -= len;
+    header->head.store(head, std::memory_order_release);
+  }
+}
+
+bool ShmRing::WaitReadable(uint64_t num_bytes, long timeout) {
+  auto deadline = GET_TIME() + std::chrono::milliseconds(timeout);
+  uint64_t spins = 0;
+  while (header->tail.load(std::memory_order_acquire) - header->head.load(std::memory_order_relaxed) < num_bytes) {
+    if (GET_TIME() > deadline) {
+      return false;
+    }
+    RingBackoff(spins);
+  }
+  return true;
+}
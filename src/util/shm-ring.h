@@ -0,0 +1,48 @@
+#ifndef TINY_UTIL_SHMRING_H_
+#define TINY_UTIL_SHMRING_H_
+
+#include "util/util.h"
+
+#include <atomic>
+#include <sys/types.h>
+
+//Single-producer/single-consumer byte ring in POSIX shared memory. Works between threads of one process as well as between processes on the same host. head and tail only ever grow and are kept on separate cache lines, so the two sides never write the same line.
+class ShmRing {
+public:
+  //The creating side unlinks any stale ring of the same name, initializes a fresh one and waits until the other side has attached. The other side waits until it has been initialized and writes a token of its own that the creating side must echo, so a stale ring left by a crashed run, which it might open before the creating side unlinks it, is detected and reopened.
+  ShmRing(std::string name, uint64_t capacity, bool create);
+  ~ShmRing();
+
+  //Blocks while the ring is full. Messages larger than the ring are streamed through it.
+  void Write(const uint8_t* data, uint64_t num_bytes);
+
+  //Blocks until num_bytes have been read
+  void Read(uint8_t* data, uint64_t num_bytes);
+
+  //Waits up to timeout ms until at least num_bytes can be read
+  bool WaitReadable(uint64_t num_bytes, long timeout);
+
+private:
+  //Maps the ring behind fd and returns the inode it was opened from
+  ino_t Map(int fd);
+  //True while name still refers to the inode that is mapped
+  bool IsCurrent(ino_t inode);
+
+  struct Header {
+    std::atomic<uint64_t> initialized;
+    uint64_t capacity;
+    std::atomic<uint64_t> client_token; //Written by the attaching side
+    std::atomic<uint64_t> confirmed_token; //Echoed by the creating side
+    alignas(64) std::atomic<uint64_t> head; //Total bytes read
+    alignas(64) std::atomic<uint64_t> tail; //Total bytes written
+  };
+
+  std::string name;
+  bool created;
+  uint64_t map_size;
+  Header* header;
+  uint8_t* data;
+  uint64_t mask;
+};
+
+#endif /* TINY_UTIL_SHMRING_H_ */
@@ -0,0 +1,149 @@
+#include "util/transport.h"
+
+std::unique_ptr<Transport> Transport::Create(std::string address, uint16_t port, uint8_t net_role, zmq::context_t& context) {
+  if (address.find(WAN_SCHEME) == 0) {
+    size_t at = address.find('@');
+    double latency_ms, mbit, jitter_ms;
+    if (at == std::string::npos || sscanf(address.c_str() + strlen(WAN_SCHEME), "%lf,%lf,%lf", &latency_ms, &mbit, &jitter_ms) != 3) {
+      throw std::runtime_error("WAN address must be of the form wan://latency_ms,mbit,jitter_ms@address");
+    }
+    return std::make_unique<WANTransport>(Create(address.substr(at + 1), port, net_role, context), latency_ms, mbit, jitter_ms);
+  }
+  if (address.find(SHM_SCHEME) == 0) {
+    return std::make_unique<ShmTransport>(address.substr(strlen(SHM_SCHEME)), port, net_role);
+  }
+  return std::make_unique<ZMQTransport>(address, port, net_role, context);
+}
+
+ZMQTransport::ZMQTransport(std::string ip_address, uint16_t port, uint8_t net_role, zmq::context_t& context) : receive_socket(context, ZMQ_PULL), send_socket(context, ZMQ_PUSH) {
+  //All channels share these two sockets, so the default high water mark would make sends on one channel fail because of traffic on the others. Instead the multiplexer limits each channel with its own credit window
+  int hwm = 0;
+  send_socket.setsockopt(ZMQ_SNDHWM, &hwm, sizeof(hwm));
+  receive_socket.setsockopt(ZMQ_RCVHWM, &hwm, sizeof(hwm));
+
+  if (net_role) { //client
+    receive_socket.connect("tcp://" + ip_address + ":" + std::to_string(port + 1));
+    send_socket.connect("tcp://" + ip_address + ":" + std::to_string(port));
+  } else { //server
+    receive_socket.bind("tcp://*:" + std::to_string(port));
+    send_socket.bind("tcp://*:" + std::to_string(port + 1));
+  }
+}
+
+void ZMQTransport::Send(uint32_t channel_id, zmq::message_t& msg, int flags) {
+  //The parts of a multipart message are delivered atomically, so the id frame is never separated from its payload
+  send_socket.send((void*) &channel_id, sizeof(uint32_t), flags | ZMQ_SNDMORE);
+  send_socket.send(msg, flags);
+}
+
+bool ZMQTransport::Receive(uint32_t& channel_id, zmq::message_t& msg, long timeout) {
+  zmq::pollitem_t item = {(void*) receive_socket, 0, ZMQ_POLLIN, 0};
+  zmq::poll(&item, 1, timeout);
+  if (!(item.revents & ZMQ_POLLIN)) {
+    return false;
+  }
+
+  receive_socket.recv((void*) &channel_id, sizeof(uint32_t));
+  receive_socket.recv(&msg);
+  return true;
+}
+
+ShmTransport::ShmTransport(std::string name, uint16_t port, uint8_t net_role) {
+  //The server creates both rings. Ring names are fixed pr. direction so the client's send ring is the server's receive ring. The server waits for the client to attach to each ring, so both sides open them in the same order
+  std::string to_client = "/tiny-" + name + "-" + std::to_string(port) + "-0";
+  std::string to_server = "/tiny-" + name + "-" + std::to_string(port) + "-1";
+  bool create = !net_role;
+  if (net_role) { //client
+    receive_ring = std::make_unique<ShmRing>(to_client, SHM_RING_SIZE, create);
+    send_ring = std::make_unique<ShmRing>(to_server, SHM_RING_SIZE, create);
+  } else { //server
+    send_ring = std::make_unique<ShmRing>(to_client, SHM_RING_SIZE, create);
+    receive_ring = std::make_unique<ShmRing>(to_server, SHM_RING_SIZE, create);
+  }
+}
+
+void ShmTransport::Send(uint32_t channel_id, zmq::message_t& msg, int flags) {
+  uint8_t frame[sizeof(uint32_t) + sizeof(uint64_t)];
+  uint64_t size = msg.size();
+  std::copy((uint8_t*) &channel_id, (uint8_t*) &channel_id + sizeof(uint32_t), frame);
+  std::copy((uint8_t*) &size, (uint8_t*) &size + sizeof(uint64_t), frame + sizeof(uint32_t));
+
+  send_ring->Write(frame, sizeof(frame));
+  send_ring->Write((uint8_t*) msg.data(), size);
+}
+
+bool ShmTransport::Receive(uint32_t& channel_id, zmq::message_t& msg, long timeout) {
+  uint8_t frame[sizeof(uint32_t) + sizeof(uint64_t)];
+  if (!receive_ring->WaitReadable(sizeof(frame), timeout)) {
+    return false;
+  }
+  receive_ring->Read(frame, sizeof(frame));
+
+  uint64_t size;
+  std::copy(frame, frame + sizeof(uint32_t), (uint8_t*) &channel_id);
+  std::copy(frame + sizeof(uint32_t), frame + sizeof(frame), (uint8_t*) &size);
+
+  msg.rebuild(size);
+  receive_ring->Read((uint8_t*) msg.data(), size);
+  return true;
+}
+
+WANTransport::WANTransport(std::unique_ptr<Transport> inner, double latency_ms, double mbit, double jitter_ms) : inner(std::move(inner)), latency((int64_t) (latency_ms * 1000000)), ns_pr_byte(8000 / mbit), jitter_ns(jitter_ms * 1000000), link_free(GET_TIME()), last_release(link_free), stopping(false) {
+  jitter_rnd.SetSeed(constant_seeds[0]);
+  pace_thread = std::thread(&WANTransport::PaceLoop, this);
+}
+
+WANTransport::~WANTransport() {
+  //Messages already sent are still delivered before the inner transport is closed
+  {
+    std::lock_guard<std::mutex> lock(queue_mutex);
+    stopping = true;
+  }
+  queue_changed.notify_one();
+  pace_thread.join();
+}
+
+void WANTransport::Send(uint32_t channel_id, zmq::message_t& msg, int flags) {
+  auto now = GET_TIME();
+
+  std::lock_guard<std::mutex> lock(queue_mutex);
+
+  //The message occupies the link after everything queued before it, then travels for latency plus jitter
+  link_free = std::max(link_free, now) + std::chrono::nanoseconds((int64_t) (msg.size() * ns_pr_byte));
+  auto release = link_free + latency + std::chrono::nanoseconds((int64_t) (jitter_rnd.get_double() * jitter_ns));
+  last_release = std::max(last_release, release);
+
+  queue.emplace_back();
+  queue.back().release = last_release;
+  queue.back().channel_id = channel_id;
+  queue.back().flags = flags;
+  queue.back().msg.move(&msg);
+  queue_changed.notify_one();
+}
+
+bool WANTransport::Receive(uint32_t& channel_id, zmq::message_t& msg, long timeout) {
+  return inner->Receive(channel_id, msg, timeout);
+}
+
+void WANTransport::PaceLoop() {
+  std::unique_lock<std::mutex> lock(queue_mutex);
+  while (true) {
+    queue_changed.wait(lock, [this] { return stopping || !queue.empty(); });
+    if (queue.empty()) {
+      return;
+    }
+
+    //Release times are non-decreasing, so only the front needs to be waited for
+    auto release = queue.front().release;
+    if (GET_TIME() < release) {
+      queue_changed.wait_until(lock, release);
+      continue;
+    }
+
+    DelayedMessage delayed(std::move(queue.front()));
+    queue.pop_front();
+    lock.unlock();
+    inner->Send(delayed.channel_id, delayed.msg, delayed.flags);
+    lock.lock();
+  }
+}
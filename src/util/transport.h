@@ -0,0 +1,89 @@
+#ifndef TINY_UTIL_TRANSPORT_H_
+#define TINY_UTIL_TRANSPORT_H_
+
+#include "util/util.h"
+#include "util/shm-ring.h"
+
+#include "zeromq/include/zmq.hpp"
+
+#include <mutex>
+#include <condition_variable>
+#include <deque>
+
+#define SHM_SCHEME "shm://"
+#define WAN_SCHEME "wan://"
+
+//Moves channel-tagged messages between the two parties. Send is only called with the multiplexer's send lock held and Receive only from its receive thread, so implementations need no locking of their own.
+class Transport {
+public:
+  virtual ~Transport() {};
+
+  virtual void Send(uint32_t channel_id, zmq::message_t& msg, int flags) = 0;
+
+  //Returns false if no message arrived within timeout ms
+  virtual bool Receive(uint32_t& channel_id, zmq::message_t& msg, long timeout) = 0;
+
+  //Picks the transport from the scheme of address. shm://name gives shared memory rings named after name and port. wan://latency_ms,mbit,jitter_ms@address wraps the transport of address in a WANTransport. Anything else is treated as a host for ZMQ over TCP
+  static std::unique_ptr<Transport> Create(std::string address, uint16_t port, uint8_t net_role, zmq::context_t& context);
+};
+
+class ZMQTransport : public Transport {
+public:
+  ZMQTransport(std::string ip_address, uint16_t port, uint8_t net_role, zmq::context_t& context);
+
+  void Send(uint32_t channel_id, zmq::message_t& msg, int flags);
+  bool Receive(uint32_t& channel_id, zmq::message_t& msg, long timeout);
+
+  zmq::socket_t receive_socket;
+  zmq::socket_t send_socket;
+};
+
+//Uses one ShmRing pr. direction. Each message is written as its channel id and size followed by the payload, so ZMQ and the kernel are bypassed entirely.
+class ShmTransport : public Transport {
+public:
+  ShmTransport(std::string name, uint16_t port, uint8_t net_role);
+
+  void Send(uint32_t channel_id, zmq::message_t& msg, int flags);
+  bool Receive(uint32_t& channel_id, zmq::message_t& msg, long timeout);
+
+  std::unique_ptr<ShmRing> send_ring;
+  std::unique_ptr<ShmRing> receive_ring;
+};
+
+//Emulates a WAN link on top of another transport. Every message is delayed as if it was sent over a link with the given one-way latency and bandwidth, plus uniform jitter in [0, jitter_ms]. The jitter is drawn from a fixed seed and messages are never reordered, so runs are reproducible. Sends only compute the release time and queue the message, a pacing thread hands it to the inner transport once released.
+class WANTransport : public Transport {
+public:
+  WANTransport(std::unique_ptr<Transport> inner, double latency_ms, double mbit, double jitter_ms);
+  ~WANTransport();
+
+  void Send(uint32_t channel_id, zmq::message_t& msg, int flags);
+  bool Receive(uint32_t& channel_id, zmq::message_t& msg, long timeout);
+
+private:
+  struct DelayedMessage {
+    std::chrono::high_resolution_clock::time_point release;
+    uint32_t channel_id;
+    int flags;
+    zmq::message_t msg;
+  };
+
+  void PaceLoop();
+
+  std::unique_ptr<Transport> inner;
+  std::chrono::nanoseconds latency;
+  double ns_pr_byte;
+  double jitter_ns;
+  PRNG jitter_rnd;
+
+  //Time at which the emulated link has finished transmitting all queued messages, and release time of the last queued message
+  std::chrono::high_resolution_clock::time_point link_free;
+  std::chrono::high_resolution_clock::time_point last_release;
+
+  std::mutex queue_mutex;
+  std::condition_variable queue_changed;
+  std::deque<DelayedMessage> queue;
+  bool stopping;
+  std::thread pace_thread;
+};
+
+#endif /* TINY_UTIL_TRANSPORT_H_ */
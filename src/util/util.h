@@ -270,6 +270,26 @@ static inline void PartitionBufferFixedNum(std::vector<int>& from, std::vector<i
   }
 }
 
+//Constructs num_parts contiguous iterations with about the same total weight. Iteration i ends once the weights so far reach (i + 1) / num_parts of the total, so a single heavy element can leave later iterations empty
+static inline void PartitionByWeight(std::vector<int>& from, std::vector<int>& to, int num_parts, std::vector<uint64_t>& weights) {
+  uint64_t total_weight = 0;
+  for (uint64_t weight : weights) {
+    total_weight += weight;
+  }
+
+  int offset = 0;
+  uint64_t curr_weight = 0;
+  for (int i = 0; i < num_parts; ++i) {
+    from.emplace_back(offset);
+    uint64_t target_weight = total_weight * (i + 1) / num_parts;
+    while (offset < (int) weights.size() && (curr_weight < target_weight || i == num_parts - 1)) {
+      curr_weight += weights[offset];
+      ++offset;
+    }
+    to.emplace_back(offset);
+  }
+}
+
 //Constructs work_size / buffer_size + 1 iterations where the last iteration will not contain full workload
 static inline void PartitionBufferDynNum(std::vector<int>& from, std::vector<int>& to, int buffer_size, int work_size) {
   int num_iterations = work_size / buffer_size;
@@ -447,4 +467,106 @@ static inline void PermuteArray(uint32_t array[], int size, uint8_t seed[]) {
   }
 }
 
+//Bucket of a 32-bit random value when there are num_buckets buckets
+static inline uint32_t PermuteBucket(uint32_t rand, uint32_t num_buckets) {
+  return ((uint64_t) rand * num_buckets) >> 32;
+}
+
+//Cache friendly parallel alternative to PermuteArray. Each element is sent to a random bucket of expected size PERMUTE_BUCKET_SIZE, buckets are filled in a stable order and then shuffled locally. The bucket of element i is read from offset 4i of the seeded stream and the shuffle of a bucket starting at position p from offset 4size + 8p, so the result only depends on seed and size and not on how the work is split between threads.
+static inline void ParallelPermuteArray(uint32_t array[], uint32_t size, uint8_t seed[], ctpl::thread_pool& thread_pool) {
+  if (size == 0) {
+    return;
+  }
+  uint32_t num_buckets = CEIL_DIVIDE(size, PERMUTE_BUCKET_SIZE);
+  int num_chunks = std::min((uint32_t) thread_pool.size(), size);
+  std::vector<int> from, to;
+  PartitionBufferFixedNum(from, to, num_chunks, size);
+
+  std::unique_ptr<uint32_t[]> counts(new uint32_t[num_chunks * num_buckets]());
+  std::unique_ptr<uint32_t[]> bucket_start(new uint32_t[num_buckets + 1]);
+  std::unique_ptr<uint32_t[]> tmp(new uint32_t[size]);
+  std::vector<std::future<void>> futures(num_chunks);
+
+  //Runs f(i, bucket) for every element of chunk c, reading the bucket randomness PERMUTE_BUCKET_SIZE elements at a time
+  auto for_each_bucket = [&](int c, auto f) {
+    PRNG rnd;
+    rnd.SetSeed(seed);
+    rnd.Seek((uint64_t) from[c] * sizeof(uint32_t));
+    std::unique_ptr<uint32_t[]> rand(new uint32_t[PERMUTE_BUCKET_SIZE]);
+    for (uint32_t i = from[c]; i < (uint32_t) to[c]; i += PERMUTE_BUCKET_SIZE) {
+      uint32_t len = std::min((uint32_t) PERMUTE_BUCKET_SIZE, to[c] - i);
+      rnd.GenRnd((uint8_t*) rand.get(), len * sizeof(uint32_t));
+      for (uint32_t j = 0; j < len; ++j) {
+        f(i + j, PermuteBucket(rand[j], num_buckets));
+      }
+    }
+  };
+
+  //Count the number of elements each chunk sends to each bucket
+  for (int c = 0; c < num_chunks; ++c) {
+    futures[c] = thread_pool.push([&, c](int id) {
+      uint32_t* chunk_counts = counts.get() + c * num_buckets;
+      for_each_bucket(c, [chunk_counts](uint32_t i, uint32_t bucket) {
+        ++chunk_counts[bucket];
+      });
+    });
+  }
+  for (std::future<void>& r : futures) {
+    r.wait();
+  }
+
+  //Prefix sum in bucket-major order turns the counts into the position each chunk writes its next element of a bucket to
+  uint32_t sum = 0;
+  for (uint32_t b = 0; b < num_buckets; ++b) {
+    bucket_start[b] = sum;
+    for (int c = 0; c < num_chunks; ++c) {
+      uint32_t count = counts[c * num_buckets + b];
+      counts[c * num_buckets + b] = sum;
+      sum += count;
+    }
+  }
+  bucket_start[num_buckets] = size;
+
+  //Scatter the elements into their buckets
+  for (int c = 0; c < num_chunks; ++c) {
+    futures[c] = thread_pool.push([&, c](int id) {
+      uint32_t* chunk_pos = counts.get() + c * num_buckets;
+      uint32_t* tmp_ptr = tmp.get();
+      for_each_bucket(c, [chunk_pos, tmp_ptr, array](uint32_t i, uint32_t bucket) {
+        tmp_ptr[chunk_pos[bucket]++] = array[i];
+      });
+    });
+  }
+  for (std::future<void>& r : futures) {
+    r.wait();
+  }
+
+  //Shuffle each bucket locally and write it back
+  std::vector<int> bucket_from, bucket_to;
+  PartitionBufferFixedNum(bucket_from, bucket_to, std::min((uint32_t) num_chunks, num_buckets), num_buckets);
+  futures.resize(bucket_from.size());
+  for (size_t t = 0; t < bucket_from.size(); ++t) {
+    futures[t] = thread_pool.push([&, t](int id) {
+      PRNG rnd;
+      rnd.SetSeed(seed);
+      std::vector<uint64_t> randomness;
+      for (uint32_t b = bucket_from[t]; b < (uint32_t) bucket_to[t]; ++b) {
+        uint32_t start = bucket_start[b];
+        uint32_t bucket_size = bucket_start[b + 1] - start;
+        uint32_t* bucket = tmp.get() + start;
+        randomness.resize(bucket_size);
+        rnd.Seek((uint64_t) size * sizeof(uint32_t) + (uint64_t) start * sizeof(uint64_t));
+        rnd.GenRnd((uint8_t*) randomness.data(), bucket_size * sizeof(uint64_t));
+        for (uint32_t i = 0; i < bucket_size; ++i) {
+          std::swap(bucket[i], bucket[i + randomness[i] % (bucket_size - i)]);
+        }
+        std::copy(bucket, bucket + bucket_size, array + start);
+      }
+    });
+  }
+  for (std::future<void>& r : futures) {
+    r.wait();
+  }
+}
+
 #endif /* TINY_UTIL_UTIL_H_ */
\ No newline at end of file
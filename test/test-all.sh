@@ -3,4 +3,6 @@
 ./build/release/TestDOT
 ./build/release/TestDOTAndCommit
 ./build/release/TestParser
-./build/release/TestTiny
\ No newline at end of file
+./build/release/TestTiny
+./build/release/TestPRG
+./build/release/TestChannel
\ No newline at end of file
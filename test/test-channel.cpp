@@ -0,0 +1,173 @@
+#include "test.h"
+
+#include "util/channel.h"
+
+TEST(Channel, ShmRingStreaming) {
+  //Ring much smaller than the message so writes wrap around and block on the reader
+  //The creating side waits for the other side to attach
+  std::unique_ptr<ShmRing> writer_ptr;
+  std::thread create([&writer_ptr]() {
+    writer_ptr = std::make_unique<ShmRing>("/tiny-test-ring", 4096, true);
+  });
+  ShmRing reader("/tiny-test-ring", 4096, false);
+  create.join();
+  ShmRing& writer = *writer_ptr;
+
+  uint64_t num_bytes = 1000003;
+  std::unique_ptr<uint8_t[]> sent(std::make_unique<uint8_t[]>(num_bytes));
+  std::unique_ptr<uint8_t[]> received(std::make_unique<uint8_t[]>(num_bytes));
+  PRNG rnd;
+  rnd.SetSeed(constant_seeds[0]);
+  rnd.GenRnd(sent.get(), num_bytes);
+
+  std::thread t([&writer, &sent, num_bytes]() {
+    writer.Write(sent.get(), 17);
+    writer.Write(sent.get() + 17, num_bytes - 17);
+  });
+  ASSERT_TRUE(reader.WaitReadable(17, 10000));
+  reader.Read(received.get(), num_bytes);
+  t.join();
+
+  ASSERT_TRUE(std::equal(sent.get(), sent.get() + num_bytes, received.get()));
+  ASSERT_FALSE(reader.WaitReadable(1, 10));
+}
+
+TEST(Channel, ShmRingStale) {
+  //A ring that is still mapped but whose creating side no longer answers, as left behind by a crashed run
+  std::unique_ptr<ShmRing> stale_writer;
+  std::thread create_stale([&stale_writer]() {
+    stale_writer = std::make_unique<ShmRing>("/tiny-test-stale", 4096, true);
+  });
+  ShmRing stale_reader("/tiny-test-stale", 4096, false);
+  create_stale.join();
+
+  //The new client opens the stale ring first and must move on to the fresh one once it is created
+  std::unique_ptr<ShmRing> reader;
+  std::thread attach([&reader]() {
+    reader = std::make_unique<ShmRing>("/tiny-test-stale", 4096, false);
+  });
+  std::this_thread::sleep_for(std::chrono::milliseconds(50));
+  ShmRing writer("/tiny-test-stale", 4096, true);
+  attach.join();
+
+  uint8_t sent[3] = {1, 2, 3};
+  uint8_t received[3];
+  writer.Write(sent, 3);
+  ASSERT_TRUE(reader->WaitReadable(3, 10000));
+  reader->Read(received, 3);
+  ASSERT_TRUE(std::equal(sent, sent + 3, received));
+  ASSERT_FALSE(stale_reader.WaitReadable(1, 10));
+}
+
+TEST(Channel, ShmMultiplexed) {
+  zmq::context_t context(1);
+  std::unique_ptr<Multiplexer> mux_server;
+  std::thread create([&mux_server, &context]() {
+    mux_server = std::make_unique<Multiplexer>(std::string(SHM_SCHEME) + "test", default_port, 0, context);
+  });
+  Multiplexer mux_client(std::string(SHM_SCHEME) + "test", default_port, 1, context);
+  create.join();
+
+  Channel server0(*mux_server, 0);
+  Channel server1(*mux_server, 1);
+  Channel client0(mux_client, 0);
+  Channel client1(mux_client, 1);
+
+  uint8_t small[3] = {1, 2, 3};
+  std::unique_ptr<uint8_t[]> large(std::make_unique<uint8_t[]>(2 * ZERO_COPY_MIN_BYTES));
+  std::fill(large.get(), large.get() + 2 * ZERO_COPY_MIN_BYTES, 0xAB);
+
+  //Messages on different channels are delivered independently of the order they are read in
+  server0.Send(small, 3);
+  server1.Send(std::move(large), 2 * ZERO_COPY_MIN_BYTES);
+
+  std::unique_ptr<uint8_t[]> res(std::make_unique<uint8_t[]>(2 * ZERO_COPY_MIN_BYTES));
+  client1.ReceiveBlocking(res.get(), 2 * ZERO_COPY_MIN_BYTES);
+  ASSERT_TRUE(std::all_of(res.get(), res.get() + 2 * ZERO_COPY_MIN_BYTES, [](uint8_t b) { return b == 0xAB; }));
+  client0.ReceiveBlocking(res.get(), 3);
+  ASSERT_TRUE(std::equal(small, small + 3, res.get()));
+
+  client0.SendBlocking(small, 3);
+  server0.ReceiveBlocking(res.get(), 3);
+  ASSERT_TRUE(std::equal(small, small + 3, res.get()));
+}
+
+TEST(Channel, AsyncReceive) {
+  zmq::context_t context(1);
+  std::unique_ptr<Multiplexer> mux_server;
+  std::thread create([&mux_server, &context]() {
+    mux_server = std::make_unique<Multiplexer>(std::string(SHM_SCHEME) + "test-async", default_port, 0, context);
+  });
+  Multiplexer mux_client(std::string(SHM_SCHEME) + "test-async", default_port, 1, context);
+  create.join();
+
+  Channel server0(*mux_server, 0);
+  Channel server1(*mux_server, 1);
+  Channel client0(mux_client, 0);
+  Channel client1(mux_client, 1);
+
+  //Nothing has been sent yet
+  uint8_t res[2][4];
+  ASSERT_FALSE(client0.Receive(res[0], 4));
+
+  //Receives are posted before the data is sent and complete in arrival order
+  ReceiveGroup group;
+  int idx0 = group.Add(client0, res[0], 4);
+  int idx1 = group.Add(client1, res[1], 4);
+
+  uint8_t data[2][4] = {{1, 2, 3, 4}, {5, 6, 7, 8}};
+  server1.Send(data[1], 4);
+  ASSERT_EQ(group.WaitAny(), idx1);
+  ASSERT_TRUE(std::equal(data[1], data[1] + 4, res[1]));
+
+  server0.Send(data[0], 4);
+  ASSERT_EQ(group.WaitAny(), idx0);
+  ASSERT_TRUE(std::equal(data[0], data[0] + 4, res[0]));
+  ASSERT_EQ(group.WaitAny(), -1);
+
+  server0.Send(data[1], 4);
+  std::future<void> received = client0.ReceiveAsync(res[0], 4);
+  received.wait();
+  ASSERT_TRUE(std::equal(data[1], data[1] + 4, res[0]));
+}
+
+TEST(Channel, CreditWindow) {
+  zmq::context_t context(1);
+  std::unique_ptr<Multiplexer> mux_server;
+  std::thread create([&mux_server, &context]() {
+    mux_server = std::make_unique<Multiplexer>(std::string(SHM_SCHEME) + "test-credit", default_port, 0, context);
+  });
+  Multiplexer mux_client(std::string(SHM_SCHEME) + "test-credit", default_port, 1, context);
+  create.join();
+
+  Channel server0(*mux_server, 0);
+  Channel server1(*mux_server, 1);
+  Channel client0(mux_client, 0);
+  Channel client1(mux_client, 1);
+
+  uint64_t half_window = MUX_CHANNEL_WINDOW / 2;
+  std::unique_ptr<uint8_t[]> buf(std::make_unique<uint8_t[]>(half_window));
+
+  //A full window goes out without the client reading, but the next send on the channel has to wait for credit
+  server0.Send(buf.get(), half_window);
+  server0.Send(buf.get(), half_window);
+  std::future<void> third_sent = std::async(std::launch::async, [&server0, &buf]() {
+    uint8_t third[3] = {1, 2, 3};
+    server0.Send(third, 3);
+  });
+  ASSERT_EQ(third_sent.wait_for(std::chrono::milliseconds(200)), std::future_status::timeout);
+
+  //Other channels are not held up by it
+  uint8_t small[3] = {4, 5, 6};
+  uint8_t res[3];
+  server1.Send(small, 3);
+  client1.ReceiveBlocking(res, 3);
+  ASSERT_TRUE(std::equal(small, small + 3, res));
+
+  //Reading half a window returns credit
+  client0.ReceiveBlocking(buf.get(), half_window);
+  ASSERT_EQ(third_sent.wait_for(std::chrono::seconds(10)), std::future_status::ready);
+  client0.ReceiveBlocking(buf.get(), half_window);
+  client0.ReceiveBlocking(res, 3);
+  ASSERT_EQ(res[2], 3);
+}
@@ -0,0 +1,94 @@
+#include "test.h"
+
+#include "prg/seekable-prng.h"
+#include "util/util.h"
+#include "util/global-constants.h"
+
+TEST(PRNG, GenRndMatchesStream) {
+  PRNG rnd_bytes;
+  PRNG rnd_bulk;
+  rnd_bytes.SetSeed(constant_seeds[0]);
+  rnd_bulk.SetSeed(constant_seeds[0]);
+
+  //Mix short and long reads so both the buffered and the direct path are exercised
+  int lengths[] = {3, 125, 128, 1, 4096, 17, 1000, 0, 129, 16};
+  for (int len : lengths) {
+    std::unique_ptr<uint8_t[]> expected(std::make_unique<uint8_t[]>(len + 1));
+    std::unique_ptr<uint8_t[]> res(std::make_unique<uint8_t[]>(len + 1));
+    for (int i = 0; i < len; ++i) {
+      expected[i] = rnd_bytes.get_uchar();
+    }
+    rnd_bulk.GenRnd(res.get(), len);
+    ASSERT_TRUE(std::equal(res.get(), res.get() + len, expected.get()));
+  }
+  ASSERT_EQ(rnd_bytes.get_uint(), rnd_bulk.get_uint());
+}
+
+//get_uint and get_doubleword skip the end of the buffer when too few bytes are left, so GenRnd must leave the buffer where the byte-by-byte path does
+TEST(PRNG, GenRndMixedWithWords) {
+  PRNG rnd_bytes;
+  PRNG rnd_bulk;
+  rnd_bytes.SetSeed(constant_seeds[0]);
+  rnd_bulk.SetSeed(constant_seeds[0]);
+
+  int lengths[] = {126, 2000, 125, 33, 4096, 130, 7, 1000};
+  for (int len : lengths) {
+    std::unique_ptr<uint8_t[]> expected(std::make_unique<uint8_t[]>(len));
+    std::unique_ptr<uint8_t[]> res(std::make_unique<uint8_t[]>(len));
+    for (int i = 0; i < len; ++i) {
+      expected[i] = rnd_bytes.get_uchar();
+    }
+    rnd_bulk.GenRnd(res.get(), len);
+    ASSERT_TRUE(std::equal(res.get(), res.get() + len, expected.get()));
+
+    ASSERT_EQ(rnd_bytes.get_uint(), rnd_bulk.get_uint());
+    ASSERT_TRUE(compare128(rnd_bytes.get_doubleword(), rnd_bulk.get_doubleword()));
+  }
+}
+
+TEST(PRNG, Seek) {
+  PRNG rnd;
+  rnd.SetSeed(constant_seeds[1]);
+  std::unique_ptr<uint8_t[]> stream(std::make_unique<uint8_t[]>(5000));
+  rnd.GenRnd(stream.get(), 5000);
+
+  uint8_t res[200];
+  int offsets[] = {0, 1, 127, 128, 2049, 4800};
+  for (int offset : offsets) {
+    rnd.Seek(offset);
+    rnd.GenRnd(res, 200);
+    ASSERT_TRUE(std::equal(res, res + 200, stream.get() + offset));
+  }
+
+  //A seek must leave the buffer where reading offset bytes from the seed does
+  PRNG rnd_read;
+  rnd_read.SetSeed(constant_seeds[1]);
+  rnd_read.GenRnd(res, 126);
+  rnd.Seek(126);
+  ASSERT_EQ(rnd_read.get_uint(), rnd.get_uint());
+  ASSERT_EQ(rnd_read.get_uint(), rnd.get_uint());
+
+  rnd.GenRndBlocks(res, 3, 12);
+  ASSERT_TRUE(std::equal(res, res + 12 * AES_BYTES, stream.get() + 3 * AES_BYTES));
+}
+
+TEST(PRNG, SeekableRows) {
+  uint8_t seeds[2 * CSEC_BYTES];
+  std::copy(constant_seeds[0], constant_seeds[0] + CSEC_BYTES, seeds);
+  std::copy(constant_seeds[1], constant_seeds[1] + CSEC_BYTES, seeds + CSEC_BYTES);
+  uint128_t seed_offset = 12345;
+  SeekablePRNG rows(seeds, 2, seed_offset);
+
+  //Row 1 should be the stream of the offset seed, readable from any block
+  uint128_t seed;
+  std::copy(seeds + CSEC_BYTES, seeds + 2 * CSEC_BYTES, (uint8_t*) &seed);
+  seed += seed_offset;
+  PRNG rnd;
+  rnd.SetSeed((uint8_t*) &seed);
+  uint8_t stream[64 * AES_BYTES];
+  rnd.GenRnd(stream, 64 * AES_BYTES);
+
+  uint8_t res[10 * AES_BYTES];
+  rows.GenRndBlocks(res, 1, 40, 10);
+  ASSERT_TRUE(std::equal(res, res + 10 * AES_BYTES, stream + 40 * AES_BYTES));
+}
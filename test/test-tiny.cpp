@@ -228,4 +228,191 @@ TEST(Protocol, DISABLED_SHA_256) {
   tiny_const_thread.join();
   tiny_eval_thread.join();
   mr_end_threading();
-}
\ No newline at end of file
+}
+
+//Reads the inputs and expected output of test/data/aes_input_0.bin and test/data/aes_expected_0.bin as the AES test does
+void ReadAESData(Circuit& circuit, std::unique_ptr<uint8_t[]>& const_input, std::unique_ptr<uint8_t[]>& eval_input, std::unique_ptr<uint8_t[]>& expected_output) {
+  FILE* input_file = fopen("test/data/aes_input_0.bin", "rb");
+  FILE* expected_file = fopen("test/data/aes_expected_0.bin", "rb");
+  std::unique_ptr<uint8_t[]> input_bytes(std::make_unique<uint8_t[]>(BITS_TO_BYTES(circuit.num_inp_wires) + 1));
+  expected_output = std::make_unique<uint8_t[]>(BITS_TO_BYTES(circuit.num_out_wires) + 1);
+  fread(input_bytes.get(), BITS_TO_BYTES(circuit.num_const_inp_wires) + BITS_TO_BYTES(circuit.num_eval_inp_wires), 1, input_file);
+  fread(expected_output.get(), BITS_TO_BYTES(circuit.num_out_wires), 1, expected_file);
+  fclose(input_file);
+  fclose(expected_file);
+
+  //Read input the right way!
+  const_input = std::make_unique<uint8_t[]>(BITS_TO_BYTES(circuit.num_const_inp_wires));
+  for (int i = 0; i < circuit.num_const_inp_wires; ++i) {
+    SetBit(i, GetBitReversed(i, input_bytes.get()), const_input.get());
+  }
+  eval_input = std::make_unique<uint8_t[]>(BITS_TO_BYTES(circuit.num_eval_inp_wires));
+  for (int i = 0; i < circuit.num_eval_inp_wires; ++i) {
+    SetBit(i, GetBitReversed(i, input_bytes.get() + BITS_TO_BYTES(circuit.num_const_inp_wires)), eval_input.get());
+  }
+}
+
+//Runs num_rounds rounds of Offline and Online on the same instance after fill_pool. When each round uses up a whole batch, every round after the first has to activate the next one. With offline_online the odd rounds run OfflineOnline instead
+void RunConstRounds(TinyConstructor& tiny_const, std::vector<Circuit*>& circuits, std::vector<uint8_t*>& inputs, int num_rounds, std::function<void(Tiny&)> fill_pool, bool offline_online) {
+
+  fill_pool(tiny_const);
+  for (int r = 0; r < num_rounds; ++r) {
+    if (offline_online && r % 2 == 1) {
+      tiny_const.OfflineOnline(circuits, inputs, tiny_const.params.num_execs);
+      continue;
+    }
+    tiny_const.Offline(circuits, tiny_const.params.num_execs);
+    tiny_const.Online(circuits, inputs, tiny_const.params.num_execs);
+  }
+}
+
+void RunEvalRounds(TinyEvaluator& tiny_eval, std::vector<Circuit*>& circuits, std::vector<uint8_t*>& inputs, std::vector<std::unique_ptr<uint8_t[]>>& outputs, uint8_t* expected_output, int num_rounds, std::function<void(Tiny&)> fill_pool, bool offline_online) {
+
+  std::vector<uint8_t*> outputs_raw;
+  for(std::unique_ptr<uint8_t[]>& ptr: outputs) {
+    outputs_raw.emplace_back(ptr.get());
+  }
+
+  fill_pool(tiny_eval);
+  for (int r = 0; r < num_rounds; ++r) {
+    //Outputs of the previous round must not pass for this one
+    for (int i = 0; i < circuits.size(); ++i) {
+      std::fill(outputs[i].get(), outputs[i].get() + BITS_TO_BYTES(circuits[i]->num_out_wires), 0);
+    }
+    if (offline_online && r % 2 == 1) {
+      std::atomic<int> num_done(0);
+      tiny_eval.OfflineOnline(circuits, inputs, outputs_raw, tiny_eval.params.num_execs, [&num_done](int c) {
+        ++num_done;
+      });
+      ASSERT_EQ((int) circuits.size(), num_done.load());
+    } else {
+      tiny_eval.Offline(circuits, tiny_eval.params.num_execs);
+      tiny_eval.Online(circuits, inputs, outputs_raw, tiny_eval.params.num_execs);
+    }
+
+    for (int i = 0; i < circuits.size(); ++i) {
+      for (int j = 0; j < circuits[i]->num_out_wires; ++j) {
+        ASSERT_TRUE(GetBitReversed(j, expected_output) == GetBit(j, outputs[i].get())) << "round " << r;
+      }
+    }
+  }
+}
+
+//Evaluates num_iters AES instances in each of num_rounds rounds, with a pool of batches holding rounds_pr_batch rounds each
+void RunAESRounds(uint16_t port, int num_rounds, std::function<void(Tiny&)> fill_pool, bool offline_online = false, int rounds_pr_batch = 1) {
+  zmq::context_t context0(1);
+  zmq::context_t context1(1);
+  int batch_iters = rounds_pr_batch * num_iters;
+  Params params_const(constant_seeds[0], batch_iters * 7000, batch_iters * 256, batch_iters * 128, default_ip_address, port, 0, context0, 2, GLOBAL_PARAMS_CHAN);
+  Params params_eval(constant_seeds[1],  batch_iters * 7000, batch_iters * 256, batch_iters * 128, default_ip_address, port, 1, context1, 2, GLOBAL_PARAMS_CHAN);
+
+  TinyConstructor tiny_const(params_const);
+  TinyEvaluator tiny_eval(params_eval);
+  Circuit circuit = read_text_circuit("test/data/AES-non-expanded.txt");
+
+  std::unique_ptr<uint8_t[]> const_input, eval_input, expected_output;
+  ReadAESData(circuit, const_input, eval_input, expected_output);
+
+  std::vector<Circuit*> circuits;
+  std::vector<uint8_t*> eval_inputs;
+  std::vector<uint8_t*> const_inputs;
+  std::vector<std::unique_ptr<uint8_t[]>> outputs;
+  for (int i = 0; i < num_iters; ++i) {
+    circuits.emplace_back(&circuit);
+    const_inputs.emplace_back(const_input.get());
+    eval_inputs.emplace_back(eval_input.get());
+    outputs.emplace_back(new uint8_t[BITS_TO_BYTES(circuit.num_out_wires)]);
+  }
+
+  mr_init_threading();
+  thread tiny_const_thread(RunConstRounds, std::ref(tiny_const), std::ref(circuits), std::ref(const_inputs), num_rounds, fill_pool, offline_online);
+  thread tiny_eval_thread(RunEvalRounds, std::ref(tiny_eval), std::ref(circuits), std::ref(eval_inputs), std::ref(outputs), expected_output.get(), num_rounds, fill_pool, offline_online);
+
+  tiny_const_thread.join();
+  tiny_eval_thread.join();
+  //The producers must be done before Miracl threading is ended
+  tiny_const.StopBackground();
+  tiny_eval.StopBackground();
+  mr_end_threading();
+}
+
+TEST(Protocol, AESPreprocessTwice) {
+  num_iters = 2;
+  //The second round runs on the second batch, which reuses the base OTs and global delta of the first
+  RunAESRounds(default_port + 100, 2, [](Tiny& tiny) {
+    tiny.Setup();
+    tiny.Preprocess();
+    tiny.Preprocess();
+  });
+}
+
+TEST(Protocol, AESBackground) {
+  num_iters = 2;
+  //With watermarks 1 and 2 the producer makes two batches up front and a third once the first has been activated, so the third round waits for a refill. The paced rate makes the background channels go through PaceBackground without slowing the test down
+  RunAESRounds(default_port + 200, 3, [](Tiny& tiny) {
+    tiny.StartBackground(2, 10000, 1, 2);
+  });
+}
+
+TEST(Protocol, AESOfflineOnline) {
+  num_iters = 2;
+  //The first round runs Offline and Online and the second OfflineOnline, and both must give the expected output
+  RunAESRounds(default_port + 300, 2, [](Tiny& tiny) {
+    tiny.Setup();
+    tiny.Preprocess();
+    tiny.Preprocess();
+  }, true);
+}
+
+TEST(Protocol, AESTwiceInBatch) {
+  num_iters = 2;
+  //Both rounds draw from one batch, so every exec reserves its arenas again while the slices of its last circuit from the previous Offline or Online are still handed out
+  RunAESRounds(default_port + 400, 2, [](Tiny& tiny) {
+    tiny.Setup();
+    tiny.Preprocess();
+  }, false, 2);
+}
+
+TEST(PreprocessedFile, Shares) {
+  std::string path = "/tmp/tiny-test-preprocessed.bin";
+  uint64_t block_size = 4 * CSEC_BYTES;
+
+  //Two execs with two blocks each, where the last share of exec 1 points into exec 0 as the delta commitment does
+  std::vector<std::vector<std::unique_ptr<uint8_t[]>>> blocks(2);
+  std::vector<std::vector<uint8_t*>> shares(2);
+  for (int exec_id = 0; exec_id < 2; ++exec_id) {
+    for (int j = 0; j < 2; ++j) {
+      blocks[exec_id].emplace_back(std::make_unique<uint8_t[]>(block_size));
+      for (uint64_t i = 0; i < block_size; ++i) {
+        blocks[exec_id][j][i] = exec_id * 100 + j * 10 + i;
+      }
+      shares[exec_id].emplace_back(blocks[exec_id][j].get() + CSEC_BYTES);
+    }
+  }
+  shares[1].emplace_back(blocks[0][1].get() + 3 * CSEC_BYTES);
+
+  {
+    PreprocessedWriter writer(path);
+    writer.Write<int>(42);
+    for (int exec_id = 0; exec_id < 2; ++exec_id) {
+      writer.WriteBlocks(blocks[exec_id], 2, block_size);
+    }
+    for (int exec_id = 0; exec_id < 2; ++exec_id) {
+      writer.WriteShares(shares[exec_id]);
+    }
+  }
+
+  PreprocessedReader reader(path);
+  ASSERT_EQ(42, reader.Read<int>());
+  reader.SkipBlocks();
+  reader.SkipBlocks();
+  for (int exec_id = 0; exec_id < 2; ++exec_id) {
+    std::vector<uint8_t*> loaded_shares;
+    reader.ReadShares(loaded_shares);
+    ASSERT_EQ(shares[exec_id].size(), loaded_shares.size());
+    for (size_t i = 0; i < loaded_shares.size(); ++i) {
+      ASSERT_TRUE(std::equal(shares[exec_id][i], shares[exec_id][i] + CSEC_BYTES, loaded_shares[i]));
+    }
+  }
+  remove(path.c_str());
+}